@@ -1,19 +1,19 @@
 
 #include <cassert>
 #include <iostream>
-#include <algorithm>
+#include <cmath>
 #include "random.h"
 #include "distribution.h"
 
 Distribution::Distribution()
-	: m_prob_total(0.0), m_sorted(false)
+	: m_prob_total(0.0), m_built(false)
 {
 }
 
 void Distribution::clear()
 {
 	m_val.clear();
-	m_sorted = false;
+	m_built = false;
 }
 
 void Distribution::add(double probability, int value)
@@ -21,61 +21,95 @@ void Distribution::add(double probability, int value)
 	assert(probability > 0.0);
 	Dist_Element e(probability, value);
 	m_val.push_back(e);
-	m_sorted = false;
+	m_built = false;
+}
+
+void Distribution::set_probability(int n, double probability)
+{
+	assert(n >= 0 && n < (int) m_val.size());
+	assert(probability > 0.0);
+	m_val[n].prob = probability;
+	m_built = false;
 }
 
 int Distribution::select()
 {
 	assert(m_val.size() != 0);
 
-	if (!m_sorted)
+	if (!m_built)
+	{
+		build_table();
+	}
+
+	double r = Random::rnd((double) m_val.size());
+	int n = (int) r;
+
+	// (in case of rounding)
+	if (n >= (int) m_val.size())
 	{
-		sort_values();
+		n = (int) m_val.size() - 1;
 	}
 
-	int n = binary_search(Random::rnd(m_prob_total));
-	return m_val[n].val;
+	const Dist_Element &e = m_val[n];
+	return (r - n < e.threshold ? e.val : m_val[e.alias].val);
 }
 
-void Distribution::sort_values()
+void Distribution::build_table()
 {
-	std::sort(m_val.begin(), m_val.end());
+	int num = (int) m_val.size();
 	m_prob_total = 0.0;
 
-	for (unsigned int n = 0;n < m_val.size();n++)
+	int n;
+	for (n = 0;n < num;n++)
 	{
-		m_val[n].sum_to_here = (m_prob_total += m_val[n].prob);
+		m_prob_total += m_val[n].prob;
 	}
 
-	m_sorted = true;
-}
+	// each element's probability scaled so that the average is 1, split
+	// into those below and above 1
+	std::vector<double> scaled(num);
+	std::vector<int> small, large;
 
-int Distribution::binary_search(double val) const
-{
-	int low = -1;
-	int high = (int) m_val.size() - 1;
+	for (n = 0;n < num;n++)
+	{
+		scaled[n] = m_val[n].prob * num / m_prob_total;
+		(scaled[n] < 1.0 ? small : large).push_back(n);
+	}
 
-	while (low < high)
+	// fill up each element below 1 with part of one above 1, which may
+	// then drop below 1 itself
+	while (!small.empty() && !large.empty())
 	{
-		// assert(low >= 0);
-		assert(high < (int) m_val.size());
+		int s = small.back();
+		int l = large.back();
+		small.pop_back();
 
-		int m = (low + high) / 2;
-		assert(m >= 0);
+		m_val[s].threshold = scaled[s];
+		m_val[s].alias = l;
 
-		if (val < m_val[m].sum_to_here)
-		{
-			high = m - 1;
-		}
-		else
+		scaled[l] = (scaled[l] + scaled[s]) - 1.0;
+
+		if (scaled[l] < 1.0)
 		{
-			low = m + 1;
+			large.pop_back();
+			small.push_back(l);
 		}
 	}
 
-	if (low < 0) { return 0; }
-	if (val > m_val[low].sum_to_here) { return low + 1; }
-	return low;
+	// (the rest are 1, apart from rounding errors)
+	for (unsigned int k = 0;k < large.size();k++)
+	{
+		m_val[large[k]].threshold = 1.0;
+		m_val[large[k]].alias = large[k];
+	}
+
+	for (unsigned int k = 0;k < small.size();k++)
+	{
+		m_val[small[k]].threshold = 1.0;
+		m_val[small[k]].alias = small[k];
+	}
+
+	m_built = true;
 }
 
 void Distribution::dump(std::ostream &out /*= std::cout*/)
@@ -86,7 +120,8 @@ void Distribution::dump(std::ostream &out /*= std::cout*/)
 	{
 		out << " (" << m_val[n].val
 			<< ' ' << m_val[n].prob
-			<< ' ' << m_val[n].sum_to_here
+			<< ' ' << m_val[n].threshold
+			<< ' ' << m_val[n].alias
 			<< ')';
 	}
 
@@ -103,20 +138,27 @@ void Distribution::self_test()
 
 		for (int n = 0;n < num;n++)
 		{
-			d.add(1.0, n);
+			d.add(Random::rnd(10.0) + 0.01, n + 100);
 		}
 
-		// need to sort the values, since we are calling binary_search()
-		// not select() (which ensures that they are sorted first)
+		// the alias table must give each element its own probability
 
-		d.sort_values();
+		d.build_table();
 		// d.dump();
 
-		for (double v = 0.5;v < (double) num;v++)
+		std::vector<double> share(num, 0.0);
+
+		for (int n = 0;n < num;n++)
 		{
-			int i = d.binary_search(v);
-			
-			if (i != (int) v)
+			share[n] += d.m_val[n].threshold;
+			share[d.m_val[n].alias] += 1.0 - d.m_val[n].threshold;
+		}
+
+		for (int n = 0;n < num;n++)
+		{
+			double expected = d.m_val[n].prob * num / d.m_prob_total;
+
+			if (std::fabs(share[n] - expected) > 1e-9)
 			{
 				std::cout << "Error!\n";
 				assert(false);
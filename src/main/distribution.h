@@ -18,6 +18,10 @@
 /// This example will assign x a value of 0 just under 1/3 of the time
 /// (0.5 / (0.5 + 1.0 + 0.001)), 1 just under 2/3 of the time,
 /// and 2 a very small amount of the time.
+///
+/// select() takes the same time however many elements there are, using
+/// an alias table (Vose's method) that is built the first time it is
+/// called after the elements or their probabilities change.
 
 class Distribution
 {
@@ -37,24 +41,30 @@ public:
 	int num() const
 	{ return (int) m_val.size(); }
 
+	/// @brief Get the probability of element \a n (in the order the
+	/// elements were added).
+	double probability(int n) const
+	{ return m_val[n].prob; }
+
+	/// @brief Change the probability of element \a n (in the order the
+	/// elements were added).
+	void set_probability(int n, double probability);
+
 	/// @brief Select a random element from the distribution.
 	/// @return The value of the element (as specified in add()).
 	int select();
 
 	/// @brief Print the distribution (for debugging).
-	/// Note that sum_to_here values will be undefined until the
-	/// probability values are sorted (after select() is called).
+	/// Note that the threshold and alias values will be undefined until
+	/// the alias table is built (after select() is called).
 	void dump(std::ostream &out = std::cout);
 
 	static void self_test();
 
 private:
-	/// @brief Sort m_val by ascending probability, and calculate
-	/// m_prob_total and the intermediate prob_sum values.
-	void sort_values();
-
-	/// @brief Called by select() to do the actual work.
-	int binary_search(double val) const;
+	/// @brief Calculate m_prob_total and the threshold and alias values
+	/// of each element.
+	void build_table();
 
 private:
 	/// A single element in the distribution.
@@ -63,8 +73,11 @@ private:
 		/// relative probability
 		double prob;
 
-		/// sum of probabilities in m_val up to & including this one
-		double sum_to_here;
+		/// select() picks an element evenly, then keeps it if a random
+		/// number from 0 to 1 is below its threshold, and otherwise
+		/// uses its alias (index in m_val) instead
+		double threshold;
+		int alias;
 
 		/// value returned by select() for this element
 		int val;
@@ -73,25 +86,20 @@ private:
 		{ }
 
 		Dist_Element(double p, int v)
-			: prob(p), val(v)
+			: prob(p), threshold(1.0), alias(0), val(v)
 		{ }
-
-		// (required for sorting)
-		bool operator < (const Dist_Element &other) const
-		{ return prob < other.prob; }
 	};
 
 	typedef std::vector<Dist_Element> Element_Vec;
 
-	/// Values and their probabilities. After select() is called,
-	/// the values are sorted.
+	/// Values and their probabilities (in the order they were added).
 	Element_Vec m_val;
 
 	/// Total of all probabilities in m_val.
 	double m_prob_total;
 
-	/// Whether m_val is currently sorted.
-	bool m_sorted;
+	/// Whether the alias table is up to date.
+	bool m_built;
 };
 
 typedef std::vector<Distribution> Distribution_Vec;
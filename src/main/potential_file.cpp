@@ -0,0 +1,377 @@
+
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "c_file.h"
+#include "potential_file.h"
+
+const unsigned Potential_File::Version = 1;
+
+namespace
+{
+	const char Magic[8] = { 'S', 'A', 'I', 'N', 'T', '2', 'P', 'T' };
+
+	// written as 0x01020304 in the native byte order
+	const uint32_t Byte_Order = 0x01020304;
+
+	// maximum number of dimensions and parameters of a table
+	const int Max_Dims = 8;
+	const int Max_Params = 8;
+
+	// maximum length of a table name (including the terminating 0)
+	const int Max_Name = 32;
+
+	// alignment of the values of each table
+	const size_t Align = 64;
+
+	struct File_Header
+	{
+		char magic[8];
+		uint32_t version;
+		uint32_t byte_order;
+		uint32_t num_tables;
+		uint32_t unused;
+		uint64_t file_size;
+	};
+
+	struct Table_Header
+	{
+		char name[Max_Name];
+		uint32_t num_dims;
+		uint32_t num_params;
+		uint32_t dims[Max_Dims];
+		double params[Max_Params];
+		uint64_t offset;		// (from the start of the file)
+		uint64_t num_values;
+		uint64_t checksum;
+	};
+
+	// 64 bit FNV-1a hash of the values
+	uint64_t checksum(const double *values, size_t num)
+	{
+		const unsigned char *c = (const unsigned char *) values;
+		const unsigned char *end = c + num * sizeof(double);
+		uint64_t h = 14695981039346656037ULL;
+
+		for ( ;c != end;c++)
+		{
+			h ^= *c;
+			h *= 1099511628211ULL;
+		}
+
+		return h;
+	}
+
+	size_t align(size_t n)
+	{
+		return (n + Align - 1) / Align * Align;
+	}
+
+	// files mapped by Potential_File::get() (never unmapped, since
+	// score terms keep pointers to the values)
+	std::map<std::string, Potential_File*> mapped_files;
+}
+
+size_t Potential_Table::num_values() const
+{
+	size_t num = (dims.empty() ? 0 : 1);
+
+	for (size_t n = 0;n < dims.size();n++)
+	{
+		num *= dims[n];
+	}
+
+	return num;
+}
+
+void Potential_Table::allocate(const std::vector<int> &dim_sizes)
+{
+	dims = dim_sizes;
+	own_values.assign(num_values(), 0.0);
+	values = (own_values.empty() ? NULL : &own_values[0]);
+}
+
+void Potential_Table::check(const std::string &filename, const char *kind,
+	const std::vector<int> &dim_sizes, int num_params) const
+{
+	if (dims != dim_sizes || (int) params.size() != num_params)
+	{
+		std::cerr << "Error: the " << kind << " table in "
+			<< filename
+			<< " does not have the expected size\n";
+		exit(1);
+	}
+}
+
+Potential_File::Potential_File(const std::string &filename)
+	: m_filename(filename), m_data(NULL), m_size(0)
+{
+	int fd = open(filename.c_str(), O_RDONLY);
+	struct stat st;
+
+	if (fd == -1 || fstat(fd, &st) != 0)
+	{
+		std::cerr << "Error: cannot open potential file "
+			<< filename << "\n";
+		exit(1);
+	}
+
+	m_size = (size_t) st.st_size;
+	void *p = mmap(NULL, m_size, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+
+	if (p == MAP_FAILED)
+	{
+		std::cerr << "Error: cannot map potential file "
+			<< filename << "\n";
+		exit(1);
+	}
+
+	m_data = (const char *) p;
+
+	const File_Header *h = (const File_Header *) m_data;
+
+	if (m_size < sizeof(File_Header) ||
+		memcmp(h->magic, Magic, sizeof(Magic)) != 0)
+	{
+		std::cerr << "Error: " << filename
+			<< " is not a potential file\n";
+		exit(1);
+	}
+
+	if (h->byte_order != Byte_Order)
+	{
+		std::cerr << "Error: potential file " << filename
+			<< " was written on a machine with a different byte order\n";
+		exit(1);
+	}
+
+	if (h->version != Version)
+	{
+		std::cerr << "Error: potential file " << filename
+			<< " has version " << h->version
+			<< " (expected " << Version << ")\n";
+		exit(1);
+	}
+
+	if (h->file_size != m_size ||
+		sizeof(File_Header) + h->num_tables * sizeof(Table_Header) > m_size)
+	{
+		std::cerr << "Error: potential file " << filename
+			<< " is incomplete\n";
+		exit(1);
+	}
+
+	m_checked.resize(h->num_tables, false);
+}
+
+Potential_File::~Potential_File()
+{
+	munmap((void *) m_data, m_size);
+}
+
+Potential_File *Potential_File::get(const std::string &filename)
+{
+	std::map<std::string, Potential_File*>::iterator i =
+		mapped_files.find(filename);
+
+	if (i != mapped_files.end())
+	{
+		return i->second;
+	}
+
+	Potential_File *f = new Potential_File(filename);
+	mapped_files[filename] = f;
+	return f;
+}
+
+bool Potential_File::is_potential_file(const std::string &filename)
+{
+	if (mapped_files.find(filename) != mapped_files.end())
+	{
+		return true;
+	}
+
+	FILE *f = fopen(filename.c_str(), "rb");
+
+	if (f == NULL)
+	{
+		return false;
+	}
+
+	char magic[sizeof(Magic)];
+	bool result = (fread(magic, 1, sizeof(magic), f) == sizeof(magic) &&
+		memcmp(magic, Magic, sizeof(Magic)) == 0);
+
+	fclose(f);
+	return result;
+}
+
+bool Potential_File::read_table(const std::string &filename,
+	const char *kind, Potential_Table *table)
+{
+	std::string path = filename;
+	std::string name = kind;
+	size_t colon = filename.rfind(':');
+
+	if (colon != std::string::npos && !file_exists(filename.c_str()))
+	{
+		path = filename.substr(0, colon);
+		name = filename.substr(colon + 1);
+	}
+
+	if (!is_potential_file(path))
+	{
+		return false;
+	}
+
+	get(path)->find(name, table);
+	return true;
+}
+
+void Potential_File::find(const std::string &name, Potential_Table *table)
+{
+	const File_Header *h = (const File_Header *) m_data;
+	const Table_Header *t = (const Table_Header *) (h + 1);
+
+	for (uint32_t n = 0;n < h->num_tables;n++, t++)
+	{
+		if (strncmp(t->name, name.c_str(), Max_Name) != 0)
+		{
+			continue;
+		}
+
+		// (the header is checked before anything is copied out of it;
+		// the values must lie within the file, written so that a corrupt
+		// offset or count cannot overflow)
+		bool valid = (t->num_dims <= (uint32_t) Max_Dims &&
+			t->num_params <= (uint32_t) Max_Params &&
+			t->offset <= m_size &&
+			t->offset % sizeof(double) == 0 &&
+			t->num_values <= (m_size - t->offset) / sizeof(double));
+
+		if (valid)
+		{
+			table->dims.assign(t->dims, t->dims + t->num_dims);
+			table->params.assign(t->params, t->params + t->num_params);
+			valid = (table->num_values() == t->num_values);
+		}
+
+		if (!valid)
+		{
+			std::cerr << "Error: table \"" << name
+				<< "\" in potential file " << m_filename
+				<< " is not valid\n";
+			exit(1);
+		}
+
+		table->own_values.clear();
+		table->values = (const double *) (m_data + t->offset);
+
+		if (!m_checked[n])
+		{
+			if (checksum(table->values, t->num_values) != t->checksum)
+			{
+				std::cerr << "Error: checksum of table \"" << name
+					<< "\" in potential file " << m_filename
+					<< " is incorrect\n";
+				exit(1);
+			}
+
+			m_checked[n] = true;
+		}
+
+		return;
+	}
+
+	std::cerr << "Error: there is no table \"" << name
+		<< "\" in potential file " << m_filename << "\n";
+	exit(1);
+}
+
+void Potential_File::write(const std::string &filename,
+	const std::vector<std::string> &names,
+	const std::vector<const Potential_Table*> &tables)
+{
+	File_Header h;
+	std::vector<Table_Header> t(tables.size());
+
+	memset(&h, 0, sizeof(h));
+	memcpy(h.magic, Magic, sizeof(Magic));
+	h.version = Version;
+	h.byte_order = Byte_Order;
+	h.num_tables = (uint32_t) tables.size();
+
+	size_t offset = align(sizeof(h) + t.size() * sizeof(Table_Header));
+
+	for (size_t n = 0;n < tables.size();n++)
+	{
+		const Potential_Table *table = tables[n];
+
+		if (names[n].empty() || (int) names[n].size() >= Max_Name ||
+			(int) table->dims.size() > Max_Dims ||
+			(int) table->params.size() > Max_Params)
+		{
+			std::cerr << "Error: cannot write table \"" << names[n]
+				<< "\" to a potential file\n";
+			exit(1);
+		}
+
+		memset(&t[n], 0, sizeof(Table_Header));
+		strcpy(t[n].name, names[n].c_str());
+		t[n].num_dims = (uint32_t) table->dims.size();
+		t[n].num_params = (uint32_t) table->params.size();
+
+		for (size_t d = 0;d < table->dims.size();d++)
+		{
+			t[n].dims[d] = table->dims[d];
+		}
+
+		for (size_t d = 0;d < table->params.size();d++)
+		{
+			t[n].params[d] = table->params[d];
+		}
+
+		t[n].offset = offset;
+		t[n].num_values = table->num_values();
+		t[n].checksum = checksum(table->values, table->num_values());
+		offset = align(offset + t[n].num_values * sizeof(double));
+	}
+
+	h.file_size = offset;
+
+	C_File file(filename, "wb", "potential file");
+	static const char zero[Align] = { 0 };
+	size_t written = 0;
+	bool ok = true;
+
+	ok = ok && fwrite(&h, sizeof(h), 1, file) == 1;
+	ok = ok && (t.empty() ||
+		fwrite(&t[0], sizeof(Table_Header), t.size(), file) == t.size());
+	written = sizeof(h) + t.size() * sizeof(Table_Header);
+
+	for (size_t n = 0;n < tables.size();n++)
+	{
+		size_t pad = t[n].offset - written;
+		ok = ok && fwrite(zero, 1, pad, file) == pad;
+		ok = ok && fwrite(tables[n]->values, sizeof(double),
+			t[n].num_values, file) == t[n].num_values;
+		written = t[n].offset + t[n].num_values * sizeof(double);
+	}
+
+	size_t pad = h.file_size - written;
+	ok = ok && fwrite(zero, 1, pad, file) == pad;
+
+	if (!ok)
+	{
+		std::cerr << "Error: could not write potential file "
+			<< filename << "\n";
+		exit(1);
+	}
+}
@@ -0,0 +1,116 @@
+#ifndef POTENTIAL_FILE_H_INCLUDED
+#define POTENTIAL_FILE_H_INCLUDED
+
+#include <string>
+#include <vector>
+#include <cstddef>
+
+/// @brief A table of values used by a score term (eg. the orientation
+/// potential), read from a text data file or a potential file.
+///
+/// The layout of the values, and the meaning of the dimensions and
+/// parameters, depend on the score term (see the read_text() function of
+/// each one).
+
+struct Potential_Table
+{
+	/// Size of each dimension (the values are in row-major order).
+	std::vector<int> dims;
+
+	/// Other numbers needed to use the values (eg. the first bin).
+	std::vector<double> params;
+
+	/// The values (either in own_values, or in a mapped potential file).
+	const double *values;
+
+	/// Values read from a text data file.
+	std::vector<double> own_values;
+
+	Potential_Table() : values(NULL)
+	{
+	}
+
+	/// @brief Number of values (the product of the dimensions).
+	size_t num_values() const;
+
+	/// @brief Set the dimensions and allocate own_values (set to 0).
+	void allocate(const std::vector<int> &dim_sizes);
+
+	/// @brief Check that the table has the expected dimensions and
+	/// number of parameters (exits with an error message if not).
+	void check(const std::string &filename, const char *kind,
+		const std::vector<int> &dim_sizes, int num_params) const;
+};
+
+/// @brief Binary file containing the tables used by the score terms, which
+/// is much faster to load than the text data files.
+///
+/// A potential file is created from text data files by convert_data, and
+/// can contain any number of tables, each with a name. Where the name of a
+/// text data file can be used in a configuration file, a potential file
+/// can be used instead, optionally followed by ":" and the name of a table
+/// in it (the default is the kind of data, eg. "orientation").
+///
+/// The file is mapped into memory (each file only once per process), and
+/// the values are used directly from the mapped pages, so processes on the
+/// same machine that use the same file share one copy. Each table has a
+/// checksum, which is checked the first time the table is used.
+///
+/// The values are stored in the native byte order; a file written on a
+/// machine with a different byte order is rejected.
+
+class Potential_File
+{
+public:
+	/// @brief Version of the file format written by write().
+	static const unsigned Version;
+
+	/// @brief Find a table in a potential file.
+	///
+	/// @param filename Name of a potential file, optionally followed by
+	/// ":" and a table name
+	/// @param kind Kind of data, used as the table name if none is given
+	/// @param table Set to the table found
+	/// @return False if filename is not a potential file (so it should be
+	/// read as a text data file). Exits with an error message if the file
+	/// or the table is not valid.
+	static bool read_table(const std::string &filename, const char *kind,
+		Potential_Table *table);
+
+	/// @brief Write a potential file (exits with an error message if the
+	/// file cannot be written).
+	static void write(const std::string &filename,
+		const std::vector<std::string> &names,
+		const std::vector<const Potential_Table*> &tables);
+
+private:
+	/// Only created by read_table().
+	Potential_File(const std::string &filename);
+	~Potential_File();
+
+	// disallow copy and assignment by making them private.
+	Potential_File(const Potential_File &);
+	Potential_File &operator = (const Potential_File &);
+
+	/// Find the (already mapped) file with the given name, or map it.
+	static Potential_File *get(const std::string &filename);
+
+	/// Whether a file starts with the potential file header.
+	static bool is_potential_file(const std::string &filename);
+
+	/// Find a table in the file (exits with an error message if it
+	/// does not exist or is not valid).
+	void find(const std::string &name, Potential_Table *table);
+
+private:
+	std::string m_filename;
+
+	/// The mapped file.
+	const char *m_data;
+	size_t m_size;
+
+	/// Whether the checksum of each table has been checked.
+	std::vector<bool> m_checked;
+};
+
+#endif // POTENTIAL_FILE_H_INCLUDED
@@ -55,7 +55,7 @@ void Reporter::end_run(Runner *r)
 	r->peptide().write_pdb(m_config.outfilename(r->run_number()).c_str());
 }
 
-void Reporter::after_move(Runner *r, const Conf_Vec &candidate,
+void Reporter::after_move(Runner *r, const Conf_Delta_Vec &candidate,
 	const Double_Vec &score, int choice, bool best_so_far, double full_score)
 {
 #ifdef PRINT_ALL
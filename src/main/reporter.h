@@ -43,7 +43,7 @@ public:
 	/// @param score Score for each candidate.
 	/// @param choice Which candidate was chosen (-1 means none).
 	/// @param best_so_far Whether candidate chosen has the best score so far
-	virtual void after_move(Runner *r, const Conf_Vec &candidate,
+	virtual void after_move(Runner *r, const Conf_Delta_Vec &candidate,
 		const Double_Vec &score, int choice, bool best_so_far,
 		double full_score);
 
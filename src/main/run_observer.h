@@ -64,12 +64,13 @@ public:
 
 	/// Called after every move (whether it succeeded or failed).
 	/// @param r The Runner object.
-	/// @param candidate Set of potential structures.
+	/// @param candidate Set of potential structures (as changes to
+	/// the structure before the move).
 	/// @param score Score for each \a candidate structure.
 	/// @param choice Which candidate was chosen (index in \a candidate;
 	/// -1 means none).
 	/// @param best_so_far Whether candidate chosen has the best score so far
-	virtual void after_move(Runner *r, const Conf_Vec &candidate,
+	virtual void after_move(Runner *r, const Conf_Delta_Vec &candidate,
 		const Double_Vec &score, int choice, bool best_so_far,
 		double full_score)
 	{ }
@@ -1,6 +1,9 @@
 
 #include <cstdlib>
 #include <stdio.h>
+#include <cmath>
+#include <algorithm>
+#include <utility>
 #include "runner.h"
 #include "run_observer.h"
 #include "config.h"
@@ -11,6 +14,73 @@
 #include "peptide.h"
 #include "conformation.h"
 #include "mover.h"
+#include "move_range.h"
+
+namespace
+{
+
+// lets the scorer stop scoring a candidate as soon as the strategy is
+// certain to reject it
+class Strategy_Limit : public Score_Limit
+{
+public:
+	Strategy_Limit(Strategy *strategy, double old_score)
+		: m_strategy(strategy), m_old_score(old_score)
+	{ }
+
+	virtual double threshold(double min_score)
+	{ return m_strategy->reject_threshold(m_old_score, min_score); }
+
+	virtual bool known_threshold(double min_score, double *t)
+	{ return m_strategy->known_reject_threshold(m_old_score, min_score, t); }
+
+private:
+	Strategy *m_strategy;
+	double m_old_score;
+};
+
+// Spearman's rank correlation between two lists of values
+// (tied values are given the average of their ranks)
+double rank_correlation(const Double_Vec &a, const Double_Vec &b)
+{
+	int num = (int) a.size();
+	Double_Vec rank_a(num), rank_b(num);
+
+	for (int i = 0;i < num;i++)
+	{
+		double below_a = 0.0, below_b = 0.0;
+
+		for (int j = 0;j < num;j++)
+		{
+			below_a += (a[j] < a[i] ? 1.0 : (a[j] == a[i] ? 0.5 : 0.0));
+			below_b += (b[j] < b[i] ? 1.0 : (b[j] == b[i] ? 0.5 : 0.0));
+		}
+
+		rank_a[i] = below_a;
+		rank_b[i] = below_b;
+	}
+
+	// (the ranks are 0.5, 1.5, ... num - 0.5 if there are no ties)
+	double mean = num / 2.0;
+	double sab = 0.0, saa = 0.0, sbb = 0.0;
+
+	for (int i = 0;i < num;i++)
+	{
+		sab += (rank_a[i] - mean) * (rank_b[i] - mean);
+		saa += square(rank_a[i] - mean);
+		sbb += square(rank_b[i] - mean);
+	}
+
+	// (if all of either list are the same, there is no correlation)
+	if (saa == 0.0 || sbb == 0.0)
+	{
+		return 0.0;
+	}
+
+	return sab / sqrt(saa * sbb);
+}
+
+} // namespace
 
 const char *Runner::m_config_section =		"general";
 //int template_count = 0;
@@ -23,6 +93,9 @@ const char *Runner::c_param_no_sel_limit =	"none selected";
 const char *Runner::c_param_reverse =		"reverse";
 const char *Runner::c_param_start_struct =	"start_structure";
 const char *Runner::c_param_native_struct =	"native_structure";
+const char *Runner::c_param_prefilter =		"prefilter";
+const char *Runner::c_param_prefilter_margin = "prefilter_margin";
+const char *Runner::c_param_prefilter_check = "prefilter_check";
 
 // default parameter values
 const bool Runner::c_default_sequential		= true;
@@ -30,6 +103,9 @@ const bool Runner::c_default_print_intermediates = false;
 //const bool Runner::c_default_coil			= false;
 const long Runner::c_default_move_limit		= 10000;
 const long Runner::c_default_no_sel_limit	= 0;
+const long Runner::c_default_prefilter		= 0;
+const double Runner::c_default_prefilter_margin = 0.0;
+const long Runner::c_default_prefilter_check	= 100;
 
 Runner::Runner(Config &config) :
 	m_num_runs(0),
@@ -42,6 +118,9 @@ Runner::Runner(Config &config) :
 	//m_coil(c_default_coil),
 	m_move_limit(c_default_move_limit),
 	m_no_sel_limit(c_default_no_sel_limit),
+	m_prefilter(c_default_prefilter),
+	m_prefilter_margin(c_default_prefilter_margin),
+	m_prefilter_check(c_default_prefilter_check),
 	m_native_known(false)
 {
 	// create the scorer, strategy, etc.
@@ -147,6 +226,21 @@ void Runner::parse_params(const Param_List &params)
 			m_native_struct = i->value;
 		}
 		else
+		if (i->name == c_param_prefilter)
+		{
+			m_prefilter = parse_integer(i->value, full_name, 0);
+		}
+		else
+		if (i->name == c_param_prefilter_margin)
+		{
+			m_prefilter_margin = parse_double(i->value, full_name);
+		}
+		else
+		if (i->name == c_param_prefilter_check)
+		{
+			m_prefilter_check = parse_integer(i->value, full_name, 0);
+		}
+		else
 		{
 			std::cerr << Config::cmd()
 				<< ": unknown " << m_config_section << " parameter \""
@@ -178,13 +272,24 @@ void Runner::do_runs(Sequence &seq, Run_Observer &observer)
 
 	// set up the candidate vectors
 
+	m_strategy->set_prefilter(m_prefilter > 0);
 	const int num_candidates = m_strategy->num_candidates();
-	Conf_Vec candidate;
+	Conf_Delta_Vec candidate;
 	Double_Vec candidate_score, candidate_progress1_score;
 	candidate.resize(num_candidates);
 	candidate_score.resize(num_candidates);
 	candidate_progress1_score.resize(num_candidates);
 
+	// if there are more candidates than m_prefilter, only some of them
+	// are scored in full (chosen using the scorer's coarse score)
+	const bool prefilter = (m_prefilter > 0 && m_prefilter < num_candidates);
+	Double_Vec coarse_score(num_candidates);
+	std::vector<char> score_full(num_candidates, 1);
+
+	// a copy of the current conformation, which the candidates are
+	// recorded against
+	Conformation base;
+
 	observer.before_start(this);
 
 	if (!m_native_struct.empty())
@@ -237,6 +342,7 @@ void Runner::do_runs(Sequence &seq, Run_Observer &observer)
 		}
 
 		m_curr_score = m_scorer->score(m_peptide, 0.0);
+		m_scorer->accept_last_scored();
         
 		m_prev_score = m_curr_score;
 		m_move_failed = false;
@@ -244,9 +350,19 @@ void Runner::do_runs(Sequence &seq, Run_Observer &observer)
 		double best_score = 9e99;	// best score found (after full grown)
 		Conformation best_conf;		// best scoring conformation
 
+		// residues that may differ between best_conf and the current
+		// conformation
+		int best_first = 0;
+		int best_last = -1;
+
+		base = m_peptide.conf();
+		best_conf = base;
+
 		m_curr_length_moves = 0;
 		m_no_sel_count = 0;
 
+		m_prefilter_stats = Prefilter_Stats();
+
 		m_strategy->start_run(this);
 		m_extender->start_run(seq);
 		observer.start_run(this);
@@ -304,6 +420,7 @@ void Runner::do_runs(Sequence &seq, Run_Observer &observer)
 
 				m_prev_score = m_curr_score;
 				m_curr_score = m_scorer->score(m_peptide, 1.0);
+				m_scorer->accept_last_scored();
 
 
 				m_move_failed = false;
@@ -315,7 +432,10 @@ void Runner::do_runs(Sequence &seq, Run_Observer &observer)
 				m_no_sel_count = 0;
 
 				best_score = m_curr_score;
-				best_conf = m_peptide.conf();
+				base = m_peptide.conf();
+				best_conf = base;
+				best_first = 0;
+				best_last = -1;
 			}
 
             
@@ -333,19 +453,52 @@ void Runner::do_runs(Sequence &seq, Run_Observer &observer)
 
 			bool exhaustive_for_pos = false;
 
-			m_mover->do_random_move(m_peptide, num_candidates,
+			m_mover->do_random_move(m_peptide, base, num_candidates,
 				exhaustive_for_pos, candidate, &observer);
 
 			double progress = m_curr_length_moves /
 				(double) (m_peptide.full_grown() ? m_move_limit :
 					m_extender->curr_length_move_limit(m_peptide));
 
+			// (every so often all of the candidates are scored in full,
+			// to see how well the coarse score predicts the full score)
+			bool check = (prefilter && m_prefilter_check > 0 &&
+				m_curr_length_moves % m_prefilter_check == 0);
+
+			if (prefilter)
+			{
+				choose_candidates(candidate, base, check, &coarse_score,
+					&score_full);
+			}
+
+			// (scoring can only stop early if there is one candidate,
+			// since otherwise select() compares their scores)
+			Strategy_Limit limit(m_strategy, m_curr_score);
+			int last_scored = -1;
+
 			for (int m = 0;m < num_candidates;m++)
 			{
-				m_peptide.conf().swap(candidate[m]);
-				candidate_score[m] = m_scorer->score(m_peptide, progress,
-					&candidate_progress1_score[m]);
-				m_peptide.conf().swap(candidate[m]);
+				// (a candidate that is not scored is never selected)
+				if (!score_full[m])
+				{
+					candidate_score[m] = HUGE_VAL;
+					candidate_progress1_score[m] = HUGE_VAL;
+					continue;
+				}
+
+				candidate[m].apply(m_peptide.conf());
+				candidate_score[m] = score_candidate(m, progress,
+					&candidate_progress1_score[m],
+					(num_candidates == 1 ? &limit : NULL));
+				candidate[m].rollback(m_peptide.conf(), base);
+				last_scored = m;
+			}
+
+			if (check)
+			{
+				m_prefilter_stats.correlation_total +=
+					rank_correlation(coarse_score, candidate_score);
+				m_prefilter_stats.checks++;
 			}
 
 			m_prev_score = m_curr_score;
@@ -354,9 +507,45 @@ void Runner::do_runs(Sequence &seq, Run_Observer &observer)
 			int choice = m_strategy->select(m_curr_score, candidate_score);
 			bool is_best = false;
 
+			// (some strategies can choose a candidate with a score of
+			// HUGE_VAL, eg. Strategy_Boltz if all of the others have too)
+			if (choice != -1 && !score_full[choice])
+			{
+				choice = -1;
+			}
+
+			m_mover->after_select(choice, m_curr_score, candidate_score,
+				score_full);
+
 			if (choice != -1)
 			{
-				m_peptide.conf().swap(candidate[choice]);
+				const Conformation_Delta &chosen = candidate[choice];
+				chosen.apply(m_peptide.conf());
+				chosen.apply(base);
+
+				if (!chosen.empty())
+				{
+					if (best_last < best_first)
+					{
+						best_first = chosen.first();
+						best_last = chosen.last();
+					}
+					else
+					{
+						best_first = std::min(best_first, chosen.first());
+						best_last = std::max(best_last, chosen.last());
+					}
+				}
+
+				// the scorer keeps values for the last candidate scored,
+				// so if another one was chosen it needs to be rescored
+				// before it can become the current conformation
+				if (choice != last_scored)
+				{
+					score_candidate(choice, progress, NULL, NULL);
+				}
+
+				m_scorer->accept_last_scored();
 				m_curr_score = candidate_score[choice];
 				m_move_failed = false;
 				m_no_sel_count = 0;
@@ -367,7 +556,10 @@ void Runner::do_runs(Sequence &seq, Run_Observer &observer)
 				if (p1_score < best_score)
 				{
 					best_score = p1_score;
-					best_conf = m_peptide.conf();
+					best_conf.copy_residues(m_peptide.conf(), best_first,
+						best_last);
+					best_first = 0;
+					best_last = -1;
 					is_best = true;
 				}
 			}
@@ -388,12 +580,101 @@ void Runner::do_runs(Sequence &seq, Run_Observer &observer)
 			m_curr_score = best_score;
 		}
 
+		if (prefilter)
+		{
+			report_prefilter(std::cout);
+		}
+
+		m_scorer->print_run_stats(std::cout);
+
+#ifdef CONFORMATION_POOL_STATS
+		Conformation::print_pool_stats(std::cout);
+#endif // CONFORMATION_POOL_STATS
+
 		m_strategy->end_run(this);
 		observer.end_run(this);
 	}
 	observer.after_end(this);
 }
 
+double Runner::score_candidate(int n, double progress,
+	double *progress1_score, Score_Limit *limit)
+{
+	Move_Range range;
+
+	if (m_mover->move_range(n, &range))
+	{
+		return m_scorer->score_delta(m_peptide, range, progress,
+			progress1_score, limit);
+	}
+	else
+	{
+		return m_scorer->score(m_peptide, progress, progress1_score, limit);
+	}
+}
+
+void Runner::choose_candidates(const Conf_Delta_Vec &candidate,
+	const Conformation &base, bool all, Double_Vec *coarse_score,
+	std::vector<char> *score_full)
+{
+	int num = (int) candidate.size();
+	int m;
+
+	m_scorer->coarse_begin(m_peptide);
+
+	for (m = 0;m < num;m++)
+	{
+		Move_Range range;
+		bool have_range = m_mover->move_range(m, &range);
+
+		candidate[m].apply(m_peptide.conf());
+		(*coarse_score)[m] = m_scorer->coarse_score(m_peptide,
+			(have_range ? &range : NULL));
+		candidate[m].rollback(m_peptide.conf(), base);
+	}
+
+	// the m_prefilter candidates with the lowest coarse scores, and any
+	// others below the margin
+	std::vector< std::pair<double, int> > order(num);
+
+	for (m = 0;m < num;m++)
+	{
+		order[m] = std::make_pair((*coarse_score)[m], m);
+	}
+
+	std::sort(order.begin(), order.end());
+
+	for (m = 0;m < num;m++)
+	{
+		(*score_full)[order[m].second] = (all || m < m_prefilter ||
+			order[m].first < m_prefilter_margin);
+	}
+
+	for (m = 0;m < num;m++)
+	{
+		m_prefilter_stats.scored += (*score_full)[m];
+	}
+
+	m_prefilter_stats.candidates += num;
+}
+
+void Runner::report_prefilter(std::ostream &out) const
+{
+	const Prefilter_Stats &s = m_prefilter_stats;
+
+	out << "Prefilter: " << s.scored << " of " << s.candidates
+		<< " candidates scored in full";
+
+	if (s.checks > 0)
+	{
+		out << ", coarse/full rank correlation "
+			<< s.correlation_total / s.checks
+			<< " (average of " << s.checks << " moves)";
+	}
+
+	out << "\n";
+}
+
 const char *Runner::config_section()
 {
 	return m_config_section;
@@ -420,6 +701,17 @@ void Runner::print_template(std::ostream &out)
 			<< " = ...\t\t# Starting structure (PDB file)\n"
 		<< "#" << c_param_native_struct
 			<< " = ...\t\t# Native structure (PDB file)\n"
+		<< "#" << c_param_prefilter << " = " << c_default_prefilter
+			<< "\t\t# number of candidates to score in full, chosen\n"
+		<< "\t\t\t\t# using a coarse score (0 = all)\n"
+		<< "#" << c_param_prefilter_margin << " = "
+			<< c_default_prefilter_margin
+			<< "\t# also score candidates with a coarse score\n"
+		<< "\t\t\t\t# change below this\n"
+		<< "#" << c_param_prefilter_check << " = "
+			<< c_default_prefilter_check
+			<< "\t# score all candidates every this many moves\n"
+		<< "\t\t\t\t# to measure the coarse/full rank correlation\n"
 		<< "\n";
 }
 
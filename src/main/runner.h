@@ -2,6 +2,8 @@
 #define RUNNER_H_INCLUDED
 
 #include <string>
+#include <vector>
+#include <iostream>
 #include "param_list.h"
 #include "peptide.h"
 
@@ -9,6 +11,7 @@
 class Config;
 class Sequence;
 class Scorer;
+class Score_Limit;
 class Strategy;
 class Extender;
 class Mover;
@@ -129,6 +132,25 @@ private:
 	Runner(const Runner&);
 	Runner &operator = (const Runner&);
 
+	/// @brief Score candidate n from the last call to
+	/// m_mover->do_random_move() (which must currently be applied to
+	/// m_peptide), only rescoring what the move changed if possible.
+	/// If limit is not NULL, scoring may stop early (see Scorer::score()).
+	double score_candidate(int n, double progress, double *progress1_score,
+		Score_Limit *limit);
+
+	/// @brief Find the coarse score of each candidate from the last call
+	/// to m_mover->do_random_move(), and decide which ones to score in
+	/// full: the m_prefilter with the lowest coarse scores, those below
+	/// m_prefilter_margin, or all of them if \a all is true.
+	/// \a base is the conformation the candidates were recorded against.
+	void choose_candidates(const Conf_Delta_Vec &candidate,
+		const Conformation &base, bool all, Double_Vec *coarse_score,
+		std::vector<char> *score_full);
+
+	/// @brief Print the prefilter statistics for the current run.
+	void report_prefilter(std::ostream &out) const;
+
 private:
 	/// name of config file section corresponding to the Runner class.
 	static const char *m_config_section;
@@ -147,6 +169,9 @@ private:
 	static const char *c_param_reverse;	// for global variable reverseSaint
 	static const char *c_param_start_struct;
 	static const char *c_param_native_struct;
+	static const char *c_param_prefilter;
+	static const char *c_param_prefilter_margin;
+	static const char *c_param_prefilter_check;
 
 	// default parameter values
 
@@ -156,6 +181,9 @@ private:
     static const int c_default_initial_res;
 	static const long c_default_move_limit;
 	static const long c_default_no_sel_limit;
+	static const long c_default_prefilter;
+	static const double c_default_prefilter_margin;
+	static const long c_default_prefilter_check;
 
 	/// number of runs to perform
 	int m_num_runs;
@@ -222,6 +250,31 @@ private:
 	/// native structure filename
 	std::string m_native_struct;
 
+	/// number of candidates to score in full (0 = all)
+	long m_prefilter;
+
+	/// also score in full any candidate whose coarse score (an estimate
+	/// of the change in score) is below this
+	double m_prefilter_margin;
+
+	/// score every candidate in full every this many moves (0 = never)
+	long m_prefilter_check;
+
+	/// @brief how well prefiltering worked in the current run
+	struct Prefilter_Stats
+	{
+		long candidates;			///< number of candidates
+		long scored;				///< number scored in full
+		long checks;				///< moves with all candidates scored
+		double correlation_total;	///< sum of rank correlations
+
+		Prefilter_Stats() :
+			candidates(0), scored(0), checks(0), correlation_total(0.0)
+		{ }
+	};
+
+	Prefilter_Stats m_prefilter_stats;
+
 	//// native structure (if known)
 	Peptide m_native_peptide;
 
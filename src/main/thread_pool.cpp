@@ -0,0 +1,132 @@
+
+#include <cstdlib>
+#include <iostream>
+#include "thread_pool.h"
+
+Thread_Pool::Thread_Pool(int num_threads) :
+	m_task(NULL), m_num_parts(0), m_next_part(0), m_parts_left(0),
+	m_task_count(0), m_stop(false)
+{
+	pthread_mutex_init(&m_mutex, NULL);
+	pthread_cond_init(&m_start, NULL);
+	pthread_cond_init(&m_done, NULL);
+
+	// (the size must not change once the threads have started, since
+	// each thread is given a pointer to its own element)
+	m_workers.resize(num_threads > 1 ? num_threads - 1 : 0);
+
+	for (size_t n = 0;n < m_workers.size();n++)
+	{
+		m_workers[n].pool = this;
+		m_workers[n].thread = (int) n + 1;
+
+		if (pthread_create(&m_workers[n].id, NULL, thread_main,
+			&m_workers[n]) != 0)
+		{
+			std::cerr << "Error: cannot create thread " << n + 1 << "\n";
+			exit(1);
+		}
+	}
+}
+
+Thread_Pool::~Thread_Pool()
+{
+	pthread_mutex_lock(&m_mutex);
+	m_stop = true;
+	pthread_cond_broadcast(&m_start);
+	pthread_mutex_unlock(&m_mutex);
+
+	for (size_t n = 0;n < m_workers.size();n++)
+	{
+		pthread_join(m_workers[n].id, NULL);
+	}
+
+	pthread_cond_destroy(&m_done);
+	pthread_cond_destroy(&m_start);
+	pthread_mutex_destroy(&m_mutex);
+}
+
+void *Thread_Pool::thread_main(void *arg)
+{
+	Worker *w = (Worker *) arg;
+	w->pool->work(w->thread);
+	return NULL;
+}
+
+void Thread_Pool::run(Thread_Task *task, int num)
+{
+	// (not worth waking the other threads for)
+	if (m_workers.empty() || num <= 1)
+	{
+		for (int k = 0;k < num;k++)
+		{
+			task->run(k, 0);
+		}
+
+		return;
+	}
+
+	pthread_mutex_lock(&m_mutex);
+	m_task = task;
+	m_num_parts = num;
+	m_next_part = 0;
+	m_parts_left = num;
+	m_task_count++;
+	pthread_cond_broadcast(&m_start);
+
+	do_parts(0);
+
+	while (m_parts_left > 0)
+	{
+		pthread_cond_wait(&m_done, &m_mutex);
+	}
+
+	m_task = NULL;
+	pthread_mutex_unlock(&m_mutex);
+}
+
+void Thread_Pool::work(int thread)
+{
+	long seen = 0;		// the last task this thread looked at
+
+	pthread_mutex_lock(&m_mutex);
+
+	for ( ; ; )
+	{
+		while (!m_stop && m_task_count == seen)
+		{
+			pthread_cond_wait(&m_start, &m_mutex);
+		}
+
+		if (m_stop)
+		{
+			break;
+		}
+
+		seen = m_task_count;
+
+		// (there may be nothing left to do if the other threads have
+		// already finished the task)
+		do_parts(thread);
+	}
+
+	pthread_mutex_unlock(&m_mutex);
+}
+
+void Thread_Pool::do_parts(int thread)
+{
+	while (m_task != NULL && m_next_part < m_num_parts)
+	{
+		Thread_Task *task = m_task;
+		int k = m_next_part++;
+
+		pthread_mutex_unlock(&m_mutex);
+		task->run(k, thread);
+		pthread_mutex_lock(&m_mutex);
+
+		if (--m_parts_left == 0)
+		{
+			pthread_cond_signal(&m_done);
+		}
+	}
+}
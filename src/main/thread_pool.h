@@ -0,0 +1,110 @@
+#ifndef THREAD_POOL_H_INCLUDED
+#define THREAD_POOL_H_INCLUDED
+
+#include <vector>
+#include <pthread.h>
+
+/// @brief A task that is divided into parts which can be done at the
+/// same time (see Thread_Pool::run()).
+
+class Thread_Task
+{
+public:
+	/// Destructor.
+	virtual ~Thread_Task()
+	{ }
+
+	/// @brief Do part \a k of the task.
+	///
+	/// \a thread is the number of the thread doing it (0 is the thread
+	/// that called Thread_Pool::run()), so that each thread can have its
+	/// own working storage.
+	virtual void run(int k, int thread) = 0;
+};
+
+/// @brief A fixed set of threads that do the parts of a Thread_Task.
+///
+/// The threads are started by the constructor and wait until run() is
+/// called, so the cost of starting them is only paid once.
+
+class Thread_Pool
+{
+public:
+	/// @brief Constructor.
+	///
+	/// \a num_threads includes the thread that calls run(), so
+	/// \a num_threads - 1 other threads are started.
+	Thread_Pool(int num_threads);
+
+	/// Destructor (stops the threads).
+	~Thread_Pool();
+
+	/// Number of threads, including the one that calls run().
+	int num_threads() const
+	{ return (int) m_workers.size() + 1; }
+
+	/// @brief Call task->run(k, thread) for k = 0 .. num - 1, and return
+	/// once they have all finished.
+	///
+	/// The parts are handed out in order to whichever thread is free
+	/// (including the calling thread), so which thread does each part
+	/// varies from one call to the next.
+	void run(Thread_Task *task, int num);
+
+private:
+	// disable copy and assignment by making them private
+	Thread_Pool(const Thread_Pool&);
+	Thread_Pool &operator = (const Thread_Pool&);
+
+	/// Argument passed to thread_main().
+	struct Worker
+	{
+		Thread_Pool *pool;
+		int thread;
+		pthread_t id;
+	};
+
+	/// Start function of each worker thread.
+	static void *thread_main(void *arg);
+
+	/// Wait for tasks and do parts of them until the pool is destroyed.
+	void work(int thread);
+
+	/// @brief Do parts of the current task until none are left.
+	///
+	/// (m_mutex must be locked, and is locked again on return.)
+	void do_parts(int thread);
+
+private:
+	/// The worker threads.
+	std::vector<Worker> m_workers;
+
+	/// Protects the following members.
+	pthread_mutex_t m_mutex;
+
+	/// Signalled when a task starts, or the pool is being destroyed.
+	pthread_cond_t m_start;
+
+	/// Signalled when the last part of a task has finished.
+	pthread_cond_t m_done;
+
+	/// The current task (NULL if none).
+	Thread_Task *m_task;
+
+	/// Number of parts of the current task.
+	int m_num_parts;
+
+	/// Next part to hand out.
+	int m_next_part;
+
+	/// Number of parts that have not finished yet.
+	int m_parts_left;
+
+	/// Incremented each time a task starts.
+	long m_task_count;
+
+	/// Whether the threads should stop.
+	bool m_stop;
+};
+
+#endif // THREAD_POOL_H_INCLUDED
@@ -0,0 +1,119 @@
+// Convert text data files used by the score terms into a single binary
+// potential file (see Potential_File), which is much faster to load.
+//
+// Usage: convert_data output_file kind=data_file[:name] ...
+//
+// where kind is one of "orientation", "solvation", "torsion" or "rapdf",
+// and name is the name of the table in the potential file (the default is
+// the kind). A configuration file can then use "output_file:name" instead
+// of the name of the data file.
+
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "potential_file.h"
+#include "orientation.h"
+#include "orientation_impl.h"
+#include "solvation.h"
+#include "solvation_impl.h"
+#include "torsion_impl.h"
+#include "rapdf_table.h"
+
+void usage(const char *prog)
+{
+	std::cerr << "Usage: " << prog
+		<< " output_file kind=data_file[:name] ...\n\n"
+		<< "where kind is orientation, solvation, torsion or rapdf\n"
+		<< "(the table name defaults to the kind)\n";
+	exit(1);
+}
+
+int main(int argc, char **argv)
+{
+	if (argc < 3)
+	{
+		usage(argv[0]);
+	}
+
+	std::vector<std::string> names;
+	std::vector<Potential_Table*> tables;
+
+	for (int n = 2;n < argc;n++)
+	{
+		std::string arg = argv[n];
+		size_t eq = arg.find('=');
+
+		if (eq == std::string::npos)
+		{
+			usage(argv[0]);
+		}
+
+		std::string kind = arg.substr(0, eq);
+		std::string filename = arg.substr(eq + 1);
+		std::string name = kind;
+		size_t colon = filename.rfind(':');
+
+		if (colon != std::string::npos)
+		{
+			name = filename.substr(colon + 1);
+			filename = filename.substr(0, colon);
+		}
+
+		for (size_t i = 0;i < names.size();i++)
+		{
+			if (names[i] == name)
+			{
+				std::cerr << "Error: table name \"" << name
+					<< "\" used more than once\n";
+				exit(1);
+			}
+		}
+
+		Potential_Table *table = new Potential_Table;
+
+		if (kind == "orientation")
+		{
+			Orientation_impl::read_text(filename, table);
+		}
+		else
+		if (kind == "solvation")
+		{
+			Solvation_impl::read_text(filename, table);
+		}
+		else
+		if (kind == "torsion")
+		{
+			Torsion_impl::read_text(filename, table);
+		}
+		else
+		if (kind == "rapdf")
+		{
+			RAPDF_Table::read_text(filename, table);
+		}
+		else
+		{
+			std::cerr << "Error: unknown kind of data \"" << kind << "\"\n";
+			usage(argv[0]);
+		}
+
+		std::cout << name << ": " << filename
+			<< " (" << table->num_values() << " values)\n";
+
+		names.push_back(name);
+		tables.push_back(table);
+	}
+
+	Potential_File::write(argv[1], names,
+		std::vector<const Potential_Table*>(tables.begin(), tables.end()));
+
+	std::cout << "Wrote " << argv[1] << "\n";
+
+	for (size_t n = 0;n < tables.size();n++)
+	{
+		delete tables[n];
+	}
+
+	return 0;
+}
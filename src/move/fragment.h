@@ -4,6 +4,8 @@
 
 #include <vector>
 #include <assert.h> // PG added this
+#include "atom_id.h"
+#include "point.h"
 // Torsion and bond angles for a single residue
 
 struct Residue_Angles
@@ -28,6 +30,9 @@ class Fragment
 public:
 	static const double Min_Score;
 
+	Fragment() : m_tried(0), m_accepted(0)
+	{ }
+
 	// add a residue to the fragment (angles are in radians)
 	void add(double phi_val, double psi_val, double omega_val,
 		double n_val, double ca_val, double c_val)
@@ -50,6 +55,23 @@ public:
 	double score() const
 	{ return m_score; }
 
+	// count a candidate move that used the fragment
+	void record_try(bool accepted)
+	{
+		m_tried++;
+
+		if (accepted)
+		{
+			m_accepted++;
+		}
+	}
+
+	// the score scaled by the fraction of candidate moves using the
+	// fragment that were accepted (starting from 1 in 2, so that a
+	// fragment that has not been tried is not ruled out)
+	double adaptive_score() const
+	{ return m_score * (m_accepted + 1.0) / (m_tried + 2.0); }
+
 	// get the phi angle for the nth residue (first index is 0)
 	// Angle is in radians
 	double phi(int n) const
@@ -92,9 +114,37 @@ public:
 		return m_angle[n].c_angle;
 	}
 
+	// Backbone atom positions built from the angles in a local frame,
+	// so that the fragment can be placed in a peptide with a single
+	// Transform (set by the Mover that owns the fragment when the
+	// library is loaded). Residue -1 is the residue before the fragment
+	// and residue length() the one after it; only the atoms that the
+	// fragment is attached to are used for those residues.
+	void set_pos(int n, Atom_Id atom, const Point &p)
+	{
+		assert(n >= -1 && n <= length() && atom < Num_Backbone);
+
+		if (m_pos.empty())
+		{
+			m_pos.resize((length() + 2) * Num_Backbone);
+		}
+
+		m_pos[(n + 1) * Num_Backbone + atom] = p;
+	}
+
+	const Point &pos(int n, Atom_Id atom) const
+	{
+		assert(n >= -1 && n <= length() && atom < Num_Backbone);
+		assert(!m_pos.empty());
+		return m_pos[(n + 1) * Num_Backbone + atom];
+	}
+
 private:
 	double m_score;
+	int m_tried;		// (see record_try())
+	int m_accepted;
 	std::vector<Residue_Angles> m_angle;
+	std::vector<Point> m_pos;		// (see set_pos())
 };
 
 typedef std::vector<Fragment> Fragment_Vec;
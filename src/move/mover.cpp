@@ -30,6 +30,16 @@ Mover::~Mover()
 {
 }
 
+bool Mover::move_range(int /*n*/, Move_Range * /*range*/) const
+{
+	return false;
+}
+
+void Mover::after_select(int /*choice*/, double /*old_score*/,
+	const Double_Vec & /*score*/, const std::vector<char> & /*scored*/)
+{
+}
+
 Mover *Mover::create(const Param_List &params)
 {
 	std::string type = find(params, c_param_type, c_default_type);
@@ -13,9 +13,12 @@
 
 #include <string>
 #include <iostream>
+#include <vector>
+#include "common.h"
 #include "peptide.h"
 #include "param_list.h"
 #include "conformation.h"
+#include "move_range.h"
 
 // forward declarations
 class Peptide;
@@ -55,9 +58,24 @@ public:
 	virtual void init_from_peptide(Peptide &p, Run_Observer *observer) = 0;
 
 	// create a set of structures from a peptide; each one is a random
-	// move away from the original structure
-	virtual void do_random_move(Peptide &p, int num, bool exhaustive_for_pos,
-		Conf_Vec &result, Run_Observer *observer) = 0;
+	// move away from the original structure, recorded in result as a
+	// change to base (which must be a copy of p.conf()). p.conf() is
+	// left as it was.
+	virtual void do_random_move(Peptide &p, const Conformation &base,
+		int num, bool exhaustive_for_pos, Conf_Delta_Vec &result,
+		Run_Observer *observer) = 0;
+
+	// get the residues affected by the move that created result[n] in
+	// the last call to do_random_move() (see move_range.h). Returns
+	// false if this is not known.
+	virtual bool move_range(int n, Move_Range *range) const;
+
+	// called after one of the structures from the last call to
+	// do_random_move() has been chosen (-1 if none was). score[n] is the
+	// score of structure n, if scored[n] is true (otherwise it was left
+	// out by the prefilter), and old_score is the score before the move.
+	virtual void after_select(int choice, double old_score,
+		const Double_Vec &score, const std::vector<char> &scored);
 
 	// extend the peptide by the requested number of residues
 	virtual void extend(Peptide &s, int num_res,
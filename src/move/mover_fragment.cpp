@@ -25,9 +25,11 @@ const char *Mover_Fragment::c_type = "fragment";
 const char *Mover_Fragment::c_param_lib = "lib";
 const char *Mover_Fragment::c_param_double_replacement_prob =
 	"double_replacement_prob";
+const char *Mover_Fragment::c_param_reweight_interval = "reweight_interval";
 
 Mover_Fragment::Mover_Fragment()
-	: m_double_replacement_prob(0.0), m_fragments_loaded(false)
+	: m_double_replacement_prob(0.0), m_fragments_loaded(false),
+	  m_reweight_interval(0), m_moves_since_reweight(0)
 {
 }
 
@@ -35,6 +37,53 @@ Mover_Fragment::~Mover_Fragment()
 {
 }
 
+bool Mover_Fragment::move_range(int n, Move_Range *range) const
+{
+	if (n < 0 || n >= (int) m_move_range.size())
+	{
+		return false;
+	}
+
+	*range = m_move_range[n];
+	return true;
+}
+
+void Mover_Fragment::after_select(int choice, double old_score,
+	const Double_Vec &score, const std::vector<char> &scored)
+{
+	if (m_reweight_interval == 0)
+	{
+		return;
+	}
+
+	// Only the candidates that were scored in full are counted (not the
+	// ones the prefilter left out, which are judged by the coarse score).
+	// A candidate that did not make the score worse counts as accepted
+	// even if another one was chosen (the Monte Carlo criterion would
+	// have accepted it on its own), so the counts depend less on how many
+	// candidates there are.
+	for (int n = 0;n < (int) m_move_fragments.size();n++)
+	{
+		if (!scored[n])
+		{
+			continue;
+		}
+
+		bool accepted = (n == choice || score[n] <= old_score);
+
+		for (size_t k = 0;k < m_move_fragments[n].size();k++)
+		{
+			m_move_fragments[n][k]->record_try(accepted);
+		}
+	}
+
+	if (++m_moves_since_reweight >= m_reweight_interval)
+	{
+		reweight_fragments();
+		m_moves_since_reweight = 0;
+	}
+}
+
 void Mover_Fragment::set_library(const std::string &lib)
 {
 	if (lib != m_lib)
@@ -66,6 +115,18 @@ bool Mover_Fragment::parse_parameter(const std::string &name,
 		return true;
 	}
 
+	if (name == c_param_reweight_interval)
+	{
+		std::string full_name = Mover_Fragment::config_section();
+		full_name += " ";
+		full_name += c_type;
+		full_name += " ";
+		full_name += name;
+
+		m_reweight_interval = parse_integer(value, full_name, 0);
+		return true;
+	}
+
 	return false;
 }
 
@@ -156,6 +217,16 @@ void Mover_Fragment::init_from_peptide(Peptide &p, Run_Observer *observer)
 	//p.verify_ideal_bond_lengths();
 }
 
+bool Mover_Fragment::move_before(const Peptide &p, int first, int last)
+{
+	if (!p.full_grown())
+	{
+		return !reverseSaint;
+	}
+
+	return (first - p.start() <= p.end() - last);
+}
+
 void Mover_Fragment::reorient_for_ribosome(Peptide &p)
 {
 	Point zero(0.0, 0.0, 0.0);
@@ -232,6 +303,9 @@ void Mover_Fragment::print_template(std::ostream &out,
 
     out << c << "type = " << c_type << "\n"
         << c << c_param_lib << " = ...\t\t\t# fragment library location\n"
+        << "#" << c_param_reweight_interval << " = 0"
+			<< "\t\t# reweight fragments by acceptance rate every\n"
+		<< "\t\t\t\t# this many moves (0 = never)\n"
         << "\n";
 }
 
@@ -39,6 +39,16 @@ public:
 	// initialise the Mover from an existing peptide
 	virtual void init_from_peptide(Peptide &p, Run_Observer *observer);
 
+	// get the residues affected by the move that created result[n] in
+	// the last call to do_random_move()
+	virtual bool move_range(int n, Move_Range *range) const;
+
+	// count which of the fragments used by the last call to
+	// do_random_move() were accepted, and reweight the fragments every
+	// m_reweight_interval moves
+	virtual void after_select(int choice, double old_score,
+		const Double_Vec &score, const std::vector<char> &scored);
+
 	// print sample config file parameters
 	static void print_template(std::ostream &out, bool commented /*= true*/);
 
@@ -64,11 +74,24 @@ protected:
 	// called at end of load_fragments()
 	virtual void after_fragments_loaded(int c_terminus) = 0;
 
+	// set the probability of choosing each fragment to its
+	// Fragment::adaptive_score()
+	virtual void reweight_fragments() = 0;
+
 	// transform the chain so that the centre of gravity of the CA atoms is
 	// on the -x axis (assumes the most recently extruded residue is at
 	// (0, 0, 0))
 	void reorient_for_ribosome(Peptide &p);
 
+	// Whether replacing residues first .. last should move the residues
+	// before them as a rigid body, rather than the residues after them.
+	// While the peptide is growing, the most recently extruded residue
+	// must stay where it is (see reorient_for_ribosome()), so the other
+	// end is moved. Once it is full grown, the side with fewer residues
+	// is moved, since no score term depends on where the whole peptide
+	// is (the Ribosome term is zero for a full grown peptide).
+	static bool move_before(const Peptide &p, int first, int last);
+
 protected:
 	typedef std::vector<Fragment_Vec> Fragment_Vec_Vec;
 	typedef std::vector<Fragment*> Fragment_Ptr_Vec;
@@ -77,10 +100,32 @@ protected:
 	static const char *c_type;
 	static const char *c_param_lib;
 	static const char *c_param_double_replacement_prob;
+	static const char *c_param_reweight_interval;
 
 	std::string m_lib;			// fragment library
 	double m_double_replacement_prob;	// probability of doing two in a row
 	bool m_fragments_loaded;	// whether fragment library has been read
+
+	// number of moves between reweighting the fragments using their
+	// acceptance rates (0 = never)
+	int m_reweight_interval;
+
+	// number of moves since the fragments were last reweighted
+	int m_moves_since_reweight;
+
+	// residues affected by each move made in the last call to
+	// do_random_move()
+	std::vector<Move_Range> m_move_range;
+
+	// residues affected by the last single random move
+	Move_Range m_last_move;
+
+	// fragments used by each move made in the last call to
+	// do_random_move() (only kept if m_reweight_interval != 0)
+	std::vector<Fragment_Ptr_Vec> m_move_fragments;
+
+	// fragments used by the last single random move
+	Fragment_Ptr_Vec m_last_fragments;
 };
 
 #endif // MOVER_FRAGMENT_H_INCLUDED
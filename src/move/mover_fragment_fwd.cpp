@@ -31,8 +31,6 @@ Mover_Fragment_Fwd::~Mover_Fragment_Fwd()
 Fragment *Mover_Fragment_Fwd::random_fragment(int max_end_pos, int *end_pos)
 {
 	assert(max_end_pos > 0);
-	int num;
-	int count = 0;
 	int max_frag = (int) m_fragment.size() - 1;
 
 	if (max_end_pos > max_frag)
@@ -40,25 +38,21 @@ Fragment *Mover_Fragment_Fwd::random_fragment(int max_end_pos, int *end_pos)
 		max_end_pos = max_frag;
 	}
 
-	int num_possible = max_end_pos - m_first_end_pos + 1;
+	// pick one of the positions with at least one fragment in it
 
-	// find a position with at least one fragment in it
+	int num_possible = m_num_end_pos[max_end_pos];
 
-	do
+	if (num_possible == 0)
 	{
-		// avoid infinite loop
-		if (++count > 100000)
-		{
-			std::cerr << "Infinite loop: no fragments found in "
-				"Mover_Fragment_Fwd::random_fragment()\n";
-			exit(1);
-		}
+		std::cerr << "Error: no fragments found in "
+			"Mover_Fragment_Fwd::random_fragment()\n";
+		exit(1);
+	}
 
-		*end_pos = rand() % num_possible + m_first_end_pos;
-		num = (int) m_fragment[*end_pos].size();
-	} while (num == 0);
+	*end_pos = m_end_pos[Random::rnd(num_possible)];
 
 	int n = m_frag_distrib[*end_pos].select();
+	m_last_fragments.push_back(&m_fragment[*end_pos][n]);
 	return &(m_fragment[*end_pos][n]);
 }
 
@@ -120,7 +114,7 @@ void Mover_Fragment_Fwd::init_sequential(Peptide &p, int initial_length,
 
 	Fragment *f = get_starting_fragment(initial_length);
 	p.set_length(f->length());
-	change_angles(p, 0, f);
+	change_angles(p, 0, f, true);
 
 	if (p.length() < initial_length)
 	{
@@ -130,18 +124,32 @@ void Mover_Fragment_Fwd::init_sequential(Peptide &p, int initial_length,
 	}
 }
 
-void Mover_Fragment_Fwd::do_random_move(Peptide &p, int num,
-	bool exhaustive_for_pos, Conf_Vec &result, Run_Observer *observer)
+void Mover_Fragment_Fwd::do_random_move(Peptide &p, const Conformation &base,
+	int num, bool exhaustive_for_pos, Conf_Delta_Vec &result,
+	Run_Observer *observer)
 {
-	result.clear();
+	result.resize(num);
+	m_move_range.clear();
 
-	for (int n = 0;n < num;n++)
+	if (m_reweight_interval != 0)
 	{
-		result.push_back(p.conf());
+		m_move_fragments.resize(num);
+	}
 
-		p.conf().swap(result.back());
+	for (int n = 0;n < num;n++)
+	{
+		// (the move is made in place, and only the residues it changed
+		// are recorded and then restored)
 		do_random_move(p, observer);
-		p.conf().swap(result.back());
+		result[n].save(p.conf(), m_last_move, p.start(), p.end());
+		result[n].rollback(p.conf(), base);
+
+		m_move_range.push_back(m_last_move);
+
+		if (m_reweight_interval != 0)
+		{
+			m_move_fragments[n] = m_last_fragments;
+		}
 	}
 }
 
@@ -149,11 +157,17 @@ void Mover_Fragment_Fwd::do_random_move(Peptide &p,
 	Run_Observer *observer)
 {
 	assert(m_fragments_loaded);
+	m_last_fragments.clear();
 
 	int start, end;
 	Fragment *f = random_fragment(p.length() - 1, &end);
 	start = end - f->length() + 1;
-	change_angles(p, start, f);
+
+	// (a second replacement moves the same side, so that the two ranges
+	// can be combined)
+	bool before_moved = move_before(p, start, end);
+	change_angles(p, start, f, before_moved);
+	m_last_move = changed_range(p, start, end, before_moved);
 
 	if (m_double_replacement_prob != 0.0)
 	{
@@ -162,7 +176,8 @@ void Mover_Fragment_Fwd::do_random_move(Peptide &p,
 		{
 			f = random_fragment(p.length() - 1, &end);
 			start = end - f->length() + 1;
-			change_angles(p, start, f);
+			change_angles(p, start, f, before_moved);
+			m_last_move.add(changed_range(p, start, end, before_moved));
 		}
 	}
 }
@@ -252,7 +267,7 @@ void Mover_Fragment_Fwd::extend(Peptide &p, int num_res,
 	assert(p_start_index + f->length() - 1 == new_end);
 
 	p.add_length(num_res);
-	change_angles(p, p_start_index, f);
+	change_angles(p, p_start_index, f, true);
 
 	if (ribosome_wall && !p.full_grown())
 	{
@@ -260,8 +275,20 @@ void Mover_Fragment_Fwd::extend(Peptide &p, int num_res,
 	}
 }
 
+Move_Range Mover_Fragment_Fwd::changed_range(const Peptide &p, int start,
+	int end, bool before_moved)
+{
+	// change_angles() rebuilds the fragment backwards from its end, which
+	// also changes the C, CB and O atoms of the residue before it, and then
+	// moves all earlier residues (or the fragment and all later residues)
+	// as a rigid body. The residues on the other side do not move.
+
+	return Move_Range((start > p.start() ? start - 1 : start), end,
+		before_moved);
+}
+
 void Mover_Fragment_Fwd::change_angles(Peptide &p, int p_start_index,
-	const Fragment *f)
+	const Fragment *f, bool before_moved)
 {
 	assert(p_start_index >= 0);
 
@@ -278,75 +305,90 @@ void Mover_Fragment_Fwd::change_angles(Peptide &p, int p_start_index,
 		old_CA = p.atom_pos(p_start_index, Atom_CA);
 	}
 
-	int n = f->length() - 1;		// position in fragment
-	int i = p_start_index + n;		// position in p
-
-	if (i == p.length() - 1)
-	{
-		Point n_pos, ca_pos, c_pos, pos;
-		get_initial_ideal(&n_pos, &ca_pos, &c_pos, f->ca_angle(n));
-		p.set_atom_pos(i, Atom_N, n_pos),
-		p.set_atom_pos(i, Atom_CA, ca_pos),
-		p.set_atom_pos(i, Atom_C, c_pos);
-
-		if (!p.is_glycine(i))
-		{
-			p.set_atom_pos(i, Atom_CB, estimate_CB_pos(ca_pos, n_pos, c_pos));
-		}
-
-		// calculate where next N would be to get position for O
+	int last = f->length() - 1;			// last position in fragment
+	int p_end_index = p_start_index + last;
 
-		Point est_n_pos = torsion_to_coord(n_pos, ca_pos, c_pos,
-			BOND_LENGTH_C_N,
-			BOND_ANGLE_CA_C_N,  // (or f->c_angle(n), but is just an estimate)
-			f->psi(n), BOND_LENGTH_C_C);
-		p.set_atom_pos(i, Atom_O, estimate_O_pos(ca_pos, c_pos, est_n_pos));
+	// The fragment's atoms were built relative to the C atom of its last
+	// residue and the N and CA atoms of the residue after it (see
+	// build_local_pos()), so they are placed by aligning those atoms. At
+	// the end of the peptide, the last residue is put in the initial ideal
+	// position instead.
 
-		// also need to find C position for previous residue
+	bool at_end = (p_end_index == p.length() - 1);
+	Transform t;
 
-		assert(i > 0);
-		p.set_atom_pos(i - 1, Atom_C,
-			torsion_to_coord(p.atom_pos(i, Atom_C), p.atom_pos(i, Atom_CA),
-				p.atom_pos(i, Atom_N), BOND_LENGTH_C_N,
-				f->n_angle(n), f->phi(n), BOND_LENGTH_N_CA));
-		p.conf().set_phi(i, f->phi(n));
+	if (at_end)
+	{
+		Point n_pos, ca_pos, c_pos;
+		get_initial_ideal(&n_pos, &ca_pos, &c_pos, f->ca_angle(last));
+		t.find_alignment(
+			f->pos(last, Atom_C), f->pos(last, Atom_N), f->pos(last, Atom_CA),
+			c_pos, n_pos, ca_pos);
+	}
+	else
+	{
+		t.find_alignment(
+			f->pos(last, Atom_C), f->pos(last + 1, Atom_N),
+			f->pos(last + 1, Atom_CA),
+			p.atom_pos(p_end_index, Atom_C), p.atom_pos(p_end_index + 1, Atom_N),
+			p.atom_pos(p_end_index + 1, Atom_CA));
+	}
 
-		n--;
-		i--;
+	if (p_start_index > 0)
+	{
+		p.set_atom_pos(p_start_index - 1, Atom_C, t.times(f->pos(-1, Atom_C)));
 	}
 
-	Point ca_pos = p.atom_pos(i + 1, Atom_CA);
-	Point n_pos = p.atom_pos(i + 1, Atom_N);
-	Point c_pos = p.atom_pos(i, Atom_C);
+	int n;		// position in fragment
+	int i;		// position in p
 
-	for ( ;n >= 0;n--, i--)
+	for (n = 0, i = p_start_index;n <= last;n++, i++)
 	{
-		ca_pos = torsion_to_coord(ca_pos, n_pos, c_pos, BOND_LENGTH_C_C,
-			f->c_angle(n), f->omega(n), BOND_LENGTH_C_N);
-		p.set_atom_pos(i, Atom_CA, ca_pos);
-		p.conf().set_omega(i, f->omega(n));
+		p.set_atom_pos(i, Atom_N, t.times(f->pos(n, Atom_N)));
+		p.set_atom_pos(i, Atom_CA, t.times(f->pos(n, Atom_CA)));
+		p.set_atom_pos(i, Atom_O, t.times(f->pos(n, Atom_O)));
 
-		p.set_atom_pos(i, Atom_O, estimate_O_pos(ca_pos, c_pos, n_pos));
-
-		n_pos = torsion_to_coord(n_pos, c_pos, ca_pos, BOND_LENGTH_N_CA,
-			f->ca_angle(n), f->psi(n), BOND_LENGTH_C_C);
-		p.set_atom_pos(i, Atom_N, n_pos);
-		p.conf().set_psi(i, f->psi(n));
+		// (otherwise the fragment is attached to the last C atom)
+		if (n < last || at_end)
+		{
+			p.set_atom_pos(i, Atom_C, t.times(f->pos(n, Atom_C)));
+		}
 
 		if (!p.is_glycine(i))
 		{
-			p.set_atom_pos(i, Atom_CB, estimate_CB_pos(ca_pos, n_pos, c_pos));
+			p.set_atom_pos(i, Atom_CB, t.times(f->pos(n, Atom_CB)));
+		}
+
+		// (at the end of the peptide, the last residue has no omega or
+		// psi angle)
+		if (n < last || !at_end)
+		{
+			p.conf().set_omega(i, f->omega(n));
+			p.conf().set_psi(i, f->psi(n));
 		}
 
 		if (i > 0)
 		{
-			c_pos = torsion_to_coord(c_pos, ca_pos, n_pos, BOND_LENGTH_C_N,
-				f->n_angle(n), f->phi(n), BOND_LENGTH_N_CA);
-			p.set_atom_pos(i - 1, Atom_C, c_pos);
 			p.conf().set_phi(i, f->phi(n));
 		}
 	}
 
+	if (at_end)
+	{
+		// calculate where next N would be to get position for O
+
+		i = p_end_index;
+		Point n_pos = p.atom_pos(i, Atom_N);
+		Point ca_pos = p.atom_pos(i, Atom_CA);
+		Point c_pos = p.atom_pos(i, Atom_C);
+
+		Point est_n_pos = torsion_to_coord(n_pos, ca_pos, c_pos,
+			BOND_LENGTH_C_N,
+			BOND_ANGLE_CA_C_N,  // (or f->c_angle(n), but is just an estimate)
+			f->psi(last), BOND_LENGTH_C_C);
+		p.set_atom_pos(i, Atom_O, estimate_O_pos(ca_pos, c_pos, est_n_pos));
+	}
+
 	if (realign_before)
 	{
 		Point new_C = p.atom_pos(p_start_index - 1, Atom_C);
@@ -366,25 +408,51 @@ void Mover_Fragment_Fwd::change_angles(Peptide &p, int p_start_index,
 		// The torsion and bond angles for residue (p_start_index)
 		// come from the fragment.
 
-		Transform t;
-		t.find_alignment(old_C, old_N, old_CA, new_C, new_N, new_CA);
-
-		for (i = 0;i < p_start_index - 1;i++)
+		if (before_moved)
 		{
-			for (int a = 0;a < Num_Backbone;a++)
+			t.find_alignment(old_C, old_N, old_CA, new_C, new_N, new_CA);
+
+			for (i = 0;i < p_start_index - 1;i++)
 			{
-				if (!(p.is_glycine(i) && (Atom_Id) a == Atom_CB))
+				for (int a = 0;a < Num_Backbone;a++)
 				{
-					p.transform_pos(i, (Atom_Id) a, t);
+					if (!(p.is_glycine(i) && (Atom_Id) a == Atom_CB))
+					{
+						p.transform_pos(i, (Atom_Id) a, t);
+					}
 				}
 			}
+
+			// i equals (p_start_index - 1)
+
+			p.transform_pos(i, Atom_N, t);
+			p.transform_pos(i, Atom_CA, t);
+			// Atom_C has already been changed
 		}
+		else
+		{
+			// The inverse transformation, applied to the fragment and
+			// everything after it (which were built relative to the
+			// residues after the fragment) instead, so that the residues
+			// before the fragment stay where they are.
 
-		// i equals (p_start_index - 1)
+			t.find_alignment(new_C, new_N, new_CA, old_C, old_N, old_CA);
+
+			for (i = p_start_index;i <= p.end();i++)
+			{
+				for (int a = 0;a < Num_Backbone;a++)
+				{
+					if (!(p.is_glycine(i) && (Atom_Id) a == Atom_CB))
+					{
+						p.transform_pos(i, (Atom_Id) a, t);
+					}
+				}
+			}
 
-		p.transform_pos(i, Atom_N, t);
-		p.transform_pos(i, Atom_CA, t);
-		// Atom_C has already been changed
+			i = p_start_index - 1;
+			p.transform_pos(i, Atom_C, t);
+			// Atom_N and Atom_CA have not moved
+		}
 
 		if (!p.is_glycine(i))
 		{
@@ -420,10 +488,55 @@ Fragment *Mover_Fragment_Fwd::add_fragment(int start_pos, int length)
 
 void Mover_Fragment_Fwd::after_fragments_loaded(int /*c_terminus*/)
 {
+	for (size_t pos = 0;pos < m_fragment.size();pos++)
+	{
+		for (size_t n = 0;n < m_fragment[pos].size();n++)
+		{
+			build_local_pos(&m_fragment[pos][n]);
+		}
+	}
+
 	init_start_fragments();
 	init_distributions();
 }
 
+void Mover_Fragment_Fwd::build_local_pos(Fragment *f)
+{
+	// The same calculation change_angles() used to do in the peptide:
+	// build the fragment backwards from the C atom of its last residue
+	// and the N and CA atoms of the residue after it (which are put in
+	// an arbitrary position with ideal bond lengths and angle).
+
+	int last = f->length() - 1;
+	Point c_pos(-BOND_LENGTH_C_N, 0.0, 0.0);
+	Point n_pos(0.0, 0.0, 0.0);
+	Point ca_pos(-BOND_LENGTH_N_CA * cos(BOND_ANGLE_C_N_CA),
+		BOND_LENGTH_N_CA * sin(BOND_ANGLE_C_N_CA), 0.0);
+
+	f->set_pos(last, Atom_C, c_pos);
+	f->set_pos(last + 1, Atom_N, n_pos);
+	f->set_pos(last + 1, Atom_CA, ca_pos);
+
+	for (int n = last;n >= 0;n--)
+	{
+		ca_pos = torsion_to_coord(ca_pos, n_pos, c_pos, BOND_LENGTH_C_C,
+			f->c_angle(n), f->omega(n), BOND_LENGTH_C_N);
+		f->set_pos(n, Atom_CA, ca_pos);
+		f->set_pos(n, Atom_O, estimate_O_pos(ca_pos, c_pos, n_pos));
+
+		n_pos = torsion_to_coord(n_pos, c_pos, ca_pos, BOND_LENGTH_N_CA,
+			f->ca_angle(n), f->psi(n), BOND_LENGTH_C_C);
+		f->set_pos(n, Atom_N, n_pos);
+
+		// (not used for glycine)
+		f->set_pos(n, Atom_CB, estimate_CB_pos(ca_pos, n_pos, c_pos));
+
+		c_pos = torsion_to_coord(c_pos, ca_pos, n_pos, BOND_LENGTH_C_N,
+			f->n_angle(n), f->phi(n), BOND_LENGTH_N_CA);
+		f->set_pos(n - 1, Atom_C, c_pos);
+	}
+}
+
 void Mover_Fragment_Fwd::init_start_fragments()
 {
 	m_start_fragment.clear();
@@ -464,6 +577,19 @@ void Mover_Fragment_Fwd::init_distributions()
 {
 	unsigned int n, pos;
 
+	m_end_pos.clear();
+	m_num_end_pos.resize(m_fragment.size());
+
+	for (pos = 0;pos < m_fragment.size();pos++)
+	{
+		if (m_fragment[pos].size() != 0)
+		{
+			m_end_pos.push_back(pos);
+		}
+
+		m_num_end_pos[pos] = (int) m_end_pos.size();
+	}
+
 	m_frag_distrib.resize(m_fragment.size());
 
 	for (pos = m_first_end_pos;pos < m_fragment.size();pos++)
@@ -484,6 +610,24 @@ void Mover_Fragment_Fwd::init_distributions()
 	}
 }
 
+void Mover_Fragment_Fwd::reweight_fragments()
+{
+	for (unsigned int pos = m_first_end_pos;pos < m_fragment.size();pos++)
+	{
+		for (unsigned int n = 0;n < m_fragment[pos].size();n++)
+		{
+			m_frag_distrib[pos].set_probability(n,
+				m_fragment[pos][n].adaptive_score());
+		}
+	}
+
+	for (unsigned int n = 0;n < m_start_fragment.size();n++)
+	{
+		m_start_frag_distrib.set_probability(n,
+			m_start_fragment[n]->adaptive_score());
+	}
+}
+
 void Mover_Fragment_Fwd::dump()
 {
 	std::cout << "Dumping fragments:\n\n";
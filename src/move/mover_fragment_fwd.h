@@ -34,8 +34,8 @@ public:
 
 	// create a set of structures from a peptide; each one is a random
 	// move away from the original structure
-	virtual void do_random_move(Peptide &p, int num,
-		bool exhaustive_for_pos, Conf_Vec &result,
+	virtual void do_random_move(Peptide &p, const Conformation &base,
+		int num, bool exhaustive_for_pos, Conf_Delta_Vec &result,
 		Run_Observer *observer);
 
 	// replace a random fragment in the peptide (may be still growing
@@ -72,7 +72,16 @@ private:
 
 	// set the torsion and bond angles in the peptide to the angles in the
 	// fragment (starting from p_start_index)
-	void change_angles(Peptide &p, int p_start_index, const Fragment *f);
+	// (the residues on one side of the fragment are moved as a rigid
+	// body so that they stay attached to it: the ones before it if
+	// before_moved is true, otherwise the ones after it)
+	void change_angles(Peptide &p, int p_start_index, const Fragment *f,
+		bool before_moved);
+
+	// residues affected by replacing the fragment start .. end
+	// using change_angles()
+	Move_Range changed_range(const Peptide &p, int start, int end,
+		bool before_moved);
 
 	// add a new fragment
 	virtual Fragment *add_fragment(int start_pos, int length);
@@ -80,6 +89,13 @@ private:
 	// called at end of load_fragments()
 	virtual void after_fragments_loaded(int c_terminus);
 
+	// set the probability of choosing each fragment to its
+	// Fragment::adaptive_score()
+	virtual void reweight_fragments();
+
+	// calculate the atom positions of a fragment (see Fragment::set_pos())
+	static void build_local_pos(Fragment *f);
+
 private:
 	// list of fragments ending at each ending position
 	Fragment_Vec_Vec m_fragment;
@@ -96,6 +112,12 @@ private:
 	// first available ending position in m_fragment (ie. first index
 	// in m_fragment for which m_fragment[index].size() != 0)
 	int m_first_end_pos;
+
+	// all of the available ending positions, in order
+	std::vector<int> m_end_pos;
+
+	// number of available ending positions <= each position
+	std::vector<int> m_num_end_pos;
 };
 
 #endif // MOVER_FRAGMENT_FWD_H_INCLUDED
@@ -33,33 +33,28 @@ Mover_Fragment_Rev::~Mover_Fragment_Rev()
 Fragment *Mover_Fragment_Rev::random_fragment(int min_start_pos, int *start_pos)
 {
 	assert(min_start_pos <= m_last_start_pos);
-	int num;
-	int count = 0;
 
 	if (min_start_pos < 0)
 	{
 		min_start_pos = 0;
 	}
 
-	int num_possible = m_last_start_pos - min_start_pos + 1;
+	// pick one of the positions with at least one fragment in it
 
-	// find a position with at least one fragment in it
+	int first = m_num_start_pos_before[min_start_pos];
+	int num_possible = (int) m_start_pos.size() - first;
 
-	do
+	if (num_possible == 0)
 	{
-		// avoid infinite loop
-		if (++count > 100000)
-		{
-			std::cerr << "Infinite loop: no fragments found in "
-				"Mover_Fragment_Rev::random_fragment()\n";
-			exit(1);
-		}
+		std::cerr << "Error: no fragments found in "
+			"Mover_Fragment_Rev::random_fragment()\n";
+		exit(1);
+	}
 
-		*start_pos = rand() % num_possible + min_start_pos;
-		num = (int) m_fragment[*start_pos].size();
-	} while (num == 0);
+	*start_pos = m_start_pos[first + Random::rnd(num_possible)];
 
 	int n = m_frag_distrib[*start_pos].select();
+	m_last_fragments.push_back(&m_fragment[*start_pos][n]);
 	return &(m_fragment[*start_pos][n]);
 }
 
@@ -135,7 +130,7 @@ void Mover_Fragment_Rev::init_sequential(Peptide &p, int initial_length,
 
 	Fragment *f = get_starting_fragment(initial_length);
 	p.set_length(f->length());
-	change_angles(p, p.end(), f);
+	change_angles(p, p.end(), f, false);
 
 	if (p.length() < initial_length)
 	{
@@ -146,18 +141,32 @@ void Mover_Fragment_Rev::init_sequential(Peptide &p, int initial_length,
 }
 
 // DONE
-void Mover_Fragment_Rev::do_random_move(Peptide &p, int num,
-	bool /*exhaustive_for_pos*/, Conf_Vec &result, Run_Observer *observer)
+void Mover_Fragment_Rev::do_random_move(Peptide &p, const Conformation &base,
+	int num, bool /*exhaustive_for_pos*/, Conf_Delta_Vec &result,
+	Run_Observer *observer)
 {
-	result.clear();
+	result.resize(num);
+	m_move_range.clear();
 
-	for (int n = 0;n < num;n++)
+	if (m_reweight_interval != 0)
 	{
-		result.push_back(p.conf());
+		m_move_fragments.resize(num);
+	}
 
-		p.conf().swap(result.back());
+	for (int n = 0;n < num;n++)
+	{
+		// (the move is made in place, and only the residues it changed
+		// are recorded and then restored)
 		do_random_move(p, observer);
-		p.conf().swap(result.back());
+		result[n].save(p.conf(), m_last_move, p.start(), p.end());
+		result[n].rollback(p.conf(), base);
+
+		m_move_range.push_back(m_last_move);
+
+		if (m_reweight_interval != 0)
+		{
+			m_move_fragments[n] = m_last_fragments;
+		}
 	}
 }
 
@@ -166,11 +175,17 @@ void Mover_Fragment_Rev::do_random_move(Peptide &p,
 	Run_Observer *observer)
 {
 	assert(m_fragments_loaded);
+	m_last_fragments.clear();
 
 	int start, end;
 	Fragment *f = random_fragment(p.start(), &start);
 	end = start + f->length() - 1;
-	change_angles(p, end, f);
+
+	// (a second replacement moves the same side, so that the two ranges
+	// can be combined)
+	bool before_moved = move_before(p, start, end);
+	change_angles(p, end, f, before_moved);
+	m_last_move = changed_range(p, start, end, before_moved);
 
 	if (m_double_replacement_prob != 0.0)
 	{
@@ -179,7 +194,8 @@ void Mover_Fragment_Rev::do_random_move(Peptide &p,
 		{
 			f = random_fragment(p.start(), &start);
 			end = start + f->length() - 1;
-			change_angles(p, end, f);
+			change_angles(p, end, f, before_moved);
+			m_last_move.add(changed_range(p, start, end, before_moved));
 		}
 	}
 }
@@ -270,7 +286,7 @@ void Mover_Fragment_Rev::extend(Peptide &p, int num_res,
 	assert(p_end_index - f->length() + 1 == new_start);
 
 	p.add_length(num_res);
-	change_angles(p, p_end_index, f);
+	change_angles(p, p_end_index, f, false);
 
 	if (ribosome_wall && !p.full_grown())
 	{
@@ -280,8 +296,19 @@ void Mover_Fragment_Rev::extend(Peptide &p, int num_res,
 	//p.conf().verify_torsion_angles();
 }
 
+Move_Range Mover_Fragment_Rev::changed_range(const Peptide &p, int start,
+	int end, bool before_moved)
+{
+	// change_angles() rebuilds the fragment forwards from its start, which
+	// also changes the residue after it, and then moves all later residues
+	// (or the fragment and all earlier residues) as a rigid body. The
+	// residues on the other side do not move.
+
+	return Move_Range(start, (end < p.end() ? end + 1 : end), before_moved);
+}
+
 void Mover_Fragment_Rev::change_angles(Peptide &p, int p_end_index,
-	const Fragment *f)
+	const Fragment *f, bool before_moved)
 {
 	assert(p_end_index < p.full_length());
 	assert(p_end_index - f->length() + 1 >= p.start());
@@ -309,92 +336,102 @@ assert(true && approx_equal_angle(curr_phi, p.conf().phi(p_end_index + 1)));
 
 	}
 
-	int n = 0;								// position in fragment
-	int i = p_end_index - f->length() + 1;	// position in p
+	int last = f->length() - 1;					// last position in fragment
+	int p_start_index = p_end_index - last;
+
+	// The fragment's atoms were built relative to the C atom of the
+	// residue before it and the N and CA atoms of its first residue (see
+	// build_local_pos()), so they are placed by aligning those atoms. At
+	// the start of the peptide, the first residue is put in the initial
+	// ideal position instead.
 
-//std::cout << "CHANGE_ANGLES: i = " << i << ", p.start() = " << p.start() << ", p.end() = " << p.end() << ", realign_after = " << (realign_after ? "true" : "false") << "\n";
+	bool at_start = (p_start_index == p.start());
+	Transform t;
 
-	if (i == p.start())
+	if (at_start)
 	{
-		Point n_pos, ca_pos, c_pos, pos;
+		Point n_pos, ca_pos, c_pos;
 		get_initial_ideal(&n_pos, &ca_pos, &c_pos, f->ca_angle(0));
-		p.set_atom_pos(i, Atom_N, n_pos),
-		p.set_atom_pos(i, Atom_CA, ca_pos),
-		p.set_atom_pos(i, Atom_C, c_pos);
-
-//std::cout << "INITIAL IDEAL:" << " N = " << n_pos
-//<< " CA= " << ca_pos << " C = " << c_pos << "\n";
-
-		if (!p.is_glycine(i))
-		{
-			p.set_atom_pos(i, Atom_CB, estimate_CB_pos(ca_pos, n_pos, c_pos));
-		}
-
-		Point next_n_pos = torsion_to_coord(n_pos, ca_pos, c_pos,
-			BOND_LENGTH_C_N, f->c_angle(0), f->psi(0), BOND_LENGTH_C_C);
-		p.set_atom_pos(i, Atom_O, estimate_O_pos(ca_pos, c_pos, next_n_pos));
-
-		p.set_atom_pos(i + 1, Atom_N, next_n_pos);
-		p.conf().set_phi(i, f->phi(0));
-		p.conf().set_psi(i, f->psi(0));
+		t.find_alignment(
+			f->pos(0, Atom_N), f->pos(0, Atom_CA), f->pos(0, Atom_C),
+			n_pos, ca_pos, c_pos);
 
-		n++;
-		i++;
+		p.conf().set_phi(p_start_index, f->phi(0));
+		p.conf().set_psi(p_start_index, f->psi(0));
+	}
+	else
+	{
+		// (the first CA atom depends on the existing omega angle)
+		Point c_pos = p.atom_pos(p_start_index - 1, Atom_C);
+		Point n_pos = p.atom_pos(p_start_index, Atom_N);
+		Point ca_pos = torsion_to_coord(
+			p.atom_pos(p_start_index - 1, Atom_CA), c_pos, n_pos,
+			BOND_LENGTH_N_CA, f->n_angle(0), p.conf().omega(p_start_index - 1),
+			BOND_LENGTH_C_N);
+
+		t.find_alignment(
+			f->pos(0, Atom_N), f->pos(0, Atom_CA), f->pos(-1, Atom_C),
+			n_pos, ca_pos, c_pos);
 	}
 
-	Point ca_pos = p.atom_pos(i - 1, Atom_CA);
-	Point c_pos = p.atom_pos(i - 1, Atom_C);
-	Point n_pos = p.atom_pos(i, Atom_N);
+	int n;		// position in fragment
+	int i;		// position in p
 
-	for ( ;n < f->length();n++, i++)
+	for (n = 0, i = p_start_index;n <= last;n++, i++)
 	{
-//std::cout << "@ n = " << n << " i = " << i << "\n";
-		double omega_val;
-
-		if (n > 0)
-		{
-			omega_val = f->omega(n - 1);
-			p.conf().set_omega(i - 1, f->omega(n - 1));
-		}
-		else
+		// (otherwise the fragment is attached to the first N atom)
+		if (n > 0 || at_start)
 		{
-			omega_val = p.conf().omega(i - 1);
+			p.set_atom_pos(i, Atom_N, t.times(f->pos(n, Atom_N)));
 		}
 
-		ca_pos = torsion_to_coord(ca_pos, c_pos, n_pos, BOND_LENGTH_N_CA,
-			f->n_angle(n), omega_val, BOND_LENGTH_C_N);
-		p.set_atom_pos(i, Atom_CA, ca_pos);
-
-		c_pos = torsion_to_coord(c_pos, n_pos, ca_pos, BOND_LENGTH_C_C,
-			f->ca_angle(n), f->phi(n), BOND_LENGTH_N_CA);
-		p.set_atom_pos(i, Atom_C, c_pos);
-		p.conf().set_phi(i, f->phi(n));
+		p.set_atom_pos(i, Atom_CA, t.times(f->pos(n, Atom_CA)));
+		p.set_atom_pos(i, Atom_C, t.times(f->pos(n, Atom_C)));
+		p.set_atom_pos(i, Atom_O, t.times(f->pos(n, Atom_O)));
 
 		if (!p.is_glycine(i))
 		{
-			p.set_atom_pos(i, Atom_CB, estimate_CB_pos(ca_pos, n_pos, c_pos));
+			p.set_atom_pos(i, Atom_CB, t.times(f->pos(n, Atom_CB)));
 		}
 
-		if (i < p.end())
+		// (the angles of the first residue at the start of the peptide
+		// have been set above)
+		if (n > 0 || !at_start)
 		{
-			n_pos = torsion_to_coord(n_pos, ca_pos, c_pos, BOND_LENGTH_C_N,
-				f->c_angle(n), f->psi(n), BOND_LENGTH_C_C);
-			p.set_atom_pos(i + 1, Atom_N, n_pos);
-			p.conf().set_psi(i, f->psi(n));
+			if (n > 0)
+			{
+				p.conf().set_omega(i - 1, f->omega(n - 1));
+			}
 
-			p.set_atom_pos(i, Atom_O, estimate_O_pos(ca_pos, c_pos, n_pos));
-		}
-		else
-		{
-			Point est_n_pos = torsion_to_coord(n_pos, ca_pos, c_pos,
-				BOND_LENGTH_C_N, BOND_ANGLE_CA_C_N,
-				deg2rad(180.0), BOND_LENGTH_C_C);
+			p.conf().set_phi(i, f->phi(n));
 
-			 p.set_atom_pos(i, Atom_O,
-			 	estimate_O_pos(ca_pos, c_pos, est_n_pos));
+			if (i < p.end())
+			{
+				p.conf().set_psi(i, f->psi(n));
+			}
 		}
 	}
 
+	Point ca_pos = p.atom_pos(p_end_index, Atom_CA);
+	Point c_pos = p.atom_pos(p_end_index, Atom_C);
+	Point n_pos;
+
+	if (p_end_index < p.end())
+	{
+		n_pos = t.times(f->pos(last + 1, Atom_N));
+		p.set_atom_pos(p_end_index + 1, Atom_N, n_pos);
+	}
+	else
+	if (last > 0 || !at_start)
+	{
+		Point est_n_pos = torsion_to_coord(p.atom_pos(p_end_index, Atom_N),
+			ca_pos, c_pos, BOND_LENGTH_C_N, BOND_ANGLE_CA_C_N,
+			deg2rad(180.0), BOND_LENGTH_C_C);
+
+		p.set_atom_pos(p_end_index, Atom_O,
+			estimate_O_pos(ca_pos, c_pos, est_n_pos));
+	}
+
 	if (realign_after)
 	{
 //std::cout << "## realign_after: p_end_index = " << p_end_index
@@ -422,23 +459,51 @@ assert(true && approx_equal_angle(curr_phi, p.conf().phi(p_end_index + 1)));
 		// The torsion and bond angles for residue (p_end_index)
 		// come from the fragment.
 
-		Transform t;
-		t.find_alignment(old_CA, old_N, old_C, new_CA, new_N, new_C);
-		//t.find_alignment(old_C, old_N, old_CA, new_C, new_N, new_CA);
-
-		for (i = p_end_index + 2;i <= p.end();i++)
+		if (!before_moved)
 		{
-			for (int a = 0;a < Num_Backbone;a++)
+			t.find_alignment(old_CA, old_N, old_C, new_CA, new_N, new_C);
+			//t.find_alignment(old_C, old_N, old_CA, new_C, new_N, new_CA);
+
+			for (i = p_end_index + 2;i <= p.end();i++)
 			{
-				if (!(p.is_glycine(i) && (Atom_Id) a == Atom_CB))
+				for (int a = 0;a < Num_Backbone;a++)
 				{
-					p.transform_pos(i, (Atom_Id) a, t);
+					if (!(p.is_glycine(i) && (Atom_Id) a == Atom_CB))
+					{
+						p.transform_pos(i, (Atom_Id) a, t);
+					}
 				}
 			}
+
+			i = p_end_index + 1;
+			p.transform_pos(i, Atom_C, t);
+			// Atom_N and Atom_CA have already been changed
 		}
+		else
+		{
+			// The inverse transformation, applied to the fragment and
+			// everything before it (which were built relative to the
+			// residues before the fragment) instead, so that the residues
+			// after the fragment stay where they are.
+
+			t.find_alignment(new_CA, new_N, new_C, old_CA, old_N, old_C);
 
-		i = p_end_index + 1;
-		p.transform_pos(i, Atom_C, t);
+			for (i = p.start();i <= p_end_index;i++)
+			{
+				for (int a = 0;a < Num_Backbone;a++)
+				{
+					if (!(p.is_glycine(i) && (Atom_Id) a == Atom_CB))
+					{
+						p.transform_pos(i, (Atom_Id) a, t);
+					}
+				}
+			}
+
+			i = p_end_index + 1;
+			p.transform_pos(i, Atom_N, t);
+			p.transform_pos(i, Atom_CA, t);
+			// Atom_C has not moved
+		}
 
 /*
 double curr_phi = torsion_angle(
@@ -450,8 +515,6 @@ std::cout << "phi: " << curr_phi << "  " << p.conf().phi(p_end_index + 1) << "\n
 assert(approx_equal_angle(curr_phi, p.conf().phi(p_end_index + 1)));
 */
 
-		// Atom_N and Atom_CA have already been changed
-
 		if (!p.is_glycine(i))
 		{
 			p.set_atom_pos(i, Atom_CB,
@@ -494,6 +557,46 @@ assert(approx_equal_angle(curr_phi, p.conf().phi(p_end_index + 1)));
 */
 }
 
+void Mover_Fragment_Rev::build_local_pos(Fragment *f)
+{
+	// The same calculation change_angles() used to do in the peptide:
+	// build the fragment forwards from the C atom of the residue before
+	// it and the N and CA atoms of its first residue (which are put in
+	// an arbitrary position with ideal bond lengths and angle).
+
+	Point c_pos(BOND_LENGTH_C_N * cos(BOND_ANGLE_C_N_CA),
+		BOND_LENGTH_C_N * sin(BOND_ANGLE_C_N_CA), 0.0);
+	Point n_pos(0.0, 0.0, 0.0);
+	Point ca_pos(BOND_LENGTH_N_CA, 0.0, 0.0);
+
+	f->set_pos(-1, Atom_C, c_pos);
+	f->set_pos(0, Atom_N, n_pos);
+	f->set_pos(0, Atom_CA, ca_pos);
+
+	for (int n = 0;n < f->length();n++)
+	{
+		if (n > 0)
+		{
+			ca_pos = torsion_to_coord(ca_pos, c_pos, n_pos, BOND_LENGTH_N_CA,
+				f->n_angle(n), f->omega(n - 1), BOND_LENGTH_C_N);
+			f->set_pos(n, Atom_CA, ca_pos);
+		}
+
+		c_pos = torsion_to_coord(c_pos, n_pos, ca_pos, BOND_LENGTH_C_C,
+			f->ca_angle(n), f->phi(n), BOND_LENGTH_N_CA);
+		f->set_pos(n, Atom_C, c_pos);
+
+		// (not used for glycine)
+		f->set_pos(n, Atom_CB, estimate_CB_pos(ca_pos, n_pos, c_pos));
+
+		n_pos = torsion_to_coord(n_pos, ca_pos, c_pos, BOND_LENGTH_C_N,
+			f->c_angle(n), f->psi(n), BOND_LENGTH_C_C);
+		f->set_pos(n + 1, Atom_N, n_pos);
+
+		f->set_pos(n, Atom_O, estimate_O_pos(ca_pos, c_pos, n_pos));
+	}
+}
+
 // DONE
 Fragment *Mover_Fragment_Rev::add_fragment(int start_pos, int length)
 {
@@ -513,6 +616,14 @@ void Mover_Fragment_Rev::after_fragments_loaded(int c_terminus)
 {
 	assert(c_terminus != -1);
 	m_c_terminus = c_terminus;
+
+	for (size_t pos = 0;pos < m_fragment.size();pos++)
+	{
+		for (size_t n = 0;n < m_fragment[pos].size();n++)
+		{
+			build_local_pos(&m_fragment[pos][n]);
+		}
+	}
 	init_end_fragments();
 	init_distributions();
 }
@@ -554,6 +665,19 @@ void Mover_Fragment_Rev::init_distributions()
 {
 	unsigned int n, pos;
 
+	m_start_pos.clear();
+	m_num_start_pos_before.resize(m_fragment.size());
+
+	for (pos = 0;pos < m_fragment.size();pos++)
+	{
+		m_num_start_pos_before[pos] = (int) m_start_pos.size();
+
+		if (m_fragment[pos].size() != 0)
+		{
+			m_start_pos.push_back(pos);
+		}
+	}
+
 	m_frag_distrib.resize(m_fragment.size());
 
 	for (pos = 0;pos <= (unsigned) m_last_start_pos;pos++)
@@ -574,6 +698,24 @@ void Mover_Fragment_Rev::init_distributions()
 	}
 }
 
+void Mover_Fragment_Rev::reweight_fragments()
+{
+	for (unsigned int pos = 0;pos <= (unsigned) m_last_start_pos;pos++)
+	{
+		for (unsigned int n = 0;n < m_fragment[pos].size();n++)
+		{
+			m_frag_distrib[pos].set_probability(n,
+				m_fragment[pos][n].adaptive_score());
+		}
+	}
+
+	for (unsigned int n = 0;n < m_end_fragment.size();n++)
+	{
+		m_end_frag_distrib.set_probability(n,
+			m_end_fragment[n]->adaptive_score());
+	}
+}
+
 // DONE
 void Mover_Fragment_Rev::dump()
 {
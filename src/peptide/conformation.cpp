@@ -1,12 +1,203 @@
 
 #include <cassert>
 #include <cmath>
+#include <algorithm>
+#include <pthread.h>
 #include "peptide.h"
 #include "geom.h"
 #include "common.h"
 #include "transform.h"
 #include "conformation.h"
 
+namespace
+{
+
+// Vectors that are no longer used by any conformation. They keep their
+// capacity, so handing one out again does not allocate any memory.
+
+template <class V>
+class Free_List
+{
+public:
+	// maximum number of vectors kept (any more are freed)
+	enum { Max_Free = 32 };
+
+	Free_List()
+#ifdef CONFORMATION_POOL_STATS
+		: m_reused(0), m_allocated(0), m_freed(0)
+#endif
+	{
+		// (so that adding to the list never copies the vectors in it)
+		m_free.reserve(Max_Free);
+	}
+
+	// add v to the list, leaving it empty
+	void put(V &v)
+	{
+		if (v.capacity() == 0)
+		{
+			return;
+		}
+
+		if (m_free.size() < Max_Free)
+		{
+			m_free.push_back(V());
+			m_free.back().swap(v);
+			m_free.back().clear();
+		}
+		else
+		{
+			V().swap(v);
+#ifdef CONFORMATION_POOL_STATS
+			m_freed++;
+#endif
+		}
+	}
+
+	// exchange v for a vector with space for at least n elements
+	// (n must be at least v.size()), keeping its contents
+	void take(V &v, size_t n)
+	{
+		assert(n >= v.size());
+
+		for (size_t i = 0;i < m_free.size();i++)
+		{
+			V &w = m_free[i];
+
+			if (w.capacity() >= n)
+			{
+				w.assign(v.begin(), v.end());
+				v.swap(w);
+				w.clear();
+
+				// (keep the vector given in exchange if it has any space)
+				if (w.capacity() == 0)
+				{
+					w.swap(m_free.back());
+					m_free.pop_back();
+				}
+
+#ifdef CONFORMATION_POOL_STATS
+				m_reused++;
+#endif
+				return;
+			}
+		}
+
+		// (at least double the space, in case v is growing a little at
+		// a time)
+		V w;
+		w.reserve(std::max(n, 2 * v.capacity()));
+		w.assign(v.begin(), v.end());
+		v.swap(w);
+		put(w);
+#ifdef CONFORMATION_POOL_STATS
+		m_allocated++;
+#endif
+	}
+
+#ifdef CONFORMATION_POOL_STATS
+	void print_stats(std::ostream &out, const char *name) const
+	{
+		out << "  " << name << ": " << m_allocated << " allocated, "
+			<< m_reused << " reused, " << m_freed << " freed, "
+			<< m_free.size() << " free\n";
+	}
+#endif // CONFORMATION_POOL_STATS
+
+private:
+	std::vector<V> m_free;
+
+#ifdef CONFORMATION_POOL_STATS
+	long m_reused;		// number of times a vector was handed out again
+	long m_allocated;	// number of times new space was allocated
+	long m_freed;		// number of vectors freed because the list was full
+#endif
+};
+
+pthread_key_t pool_key;
+pthread_once_t pool_key_once = PTHREAD_ONCE_INIT;
+
+} // namespace
+
+struct Conformation::Pool
+{
+	Free_List<Point_Vec> backbone;
+	Free_List<Point_Vec> non_backbone;
+	Free_List<ResData_Vec> res_data;
+};
+
+void Conformation::make_pool_key()
+{
+	if (pthread_key_create(&pool_key, delete_pool) != 0)
+	{
+		std::cerr << "Error: cannot create conformation pool key\n";
+		exit(1);
+	}
+}
+
+void Conformation::delete_pool(void *p)
+{
+	delete (Pool *) p;
+}
+
+Conformation::Pool &Conformation::pool()
+{
+	pthread_once(&pool_key_once, make_pool_key);
+	Pool *p = (Pool *) pthread_getspecific(pool_key);
+
+	if (p == NULL)
+	{
+		p = new Pool;
+		pthread_setspecific(pool_key, p);
+	}
+
+	return *p;
+}
+
+void Conformation::print_pool_stats(std::ostream &out)
+{
+#ifdef CONFORMATION_POOL_STATS
+	const Pool &p = pool();
+	out << "Conformation pool:\n";
+	p.backbone.print_stats(out, "backbone");
+	p.non_backbone.print_stats(out, "non-backbone");
+	p.res_data.print_stats(out, "residue data");
+#endif // CONFORMATION_POOL_STATS
+}
+
+void Conformation::reserve_backbone(size_t n)
+{
+	if (m_backbone.capacity() < n)
+	{
+		pool().backbone.take(m_backbone, n);
+	}
+}
+
+void Conformation::reserve_non_backbone(size_t n)
+{
+	if (m_non_backbone.capacity() < n)
+	{
+		pool().non_backbone.take(m_non_backbone, n);
+	}
+}
+
+void Conformation::reserve_res_data(size_t n)
+{
+	if (m_res_data.capacity() < n)
+	{
+		pool().res_data.take(m_res_data, n);
+	}
+}
+
+void Conformation::release()
+{
+	Pool &p = pool();
+	p.backbone.put(m_backbone);
+	p.non_backbone.put(m_non_backbone);
+	p.res_data.put(m_res_data);
+}
+
 Conformation::Conformation()
 	: m_peptide(NULL)
 {
@@ -20,18 +211,21 @@ Conformation::Conformation(const Peptide *p)
 
 Conformation::~Conformation()
 {
+	release();
 }
 
 Conformation::Conformation(const Conformation &other)
-	: m_peptide(other.m_peptide),
-	  m_backbone(other.m_backbone),
-	  m_non_backbone(other.m_non_backbone),
-	  m_res_data(other.m_res_data)
+	: m_peptide(NULL)
 {
+	*this = other;
 }
 
 Conformation& Conformation::operator = (const Conformation &other)
 {
+	reserve_backbone(other.m_backbone.size());
+	reserve_non_backbone(other.m_non_backbone.size());
+	reserve_res_data(other.m_res_data.size());
+
 	m_peptide = other.m_peptide;
 	m_backbone = other.m_backbone;
 	m_non_backbone = other.m_non_backbone;
@@ -51,25 +245,58 @@ void Conformation::swap(Conformation &other)
 	other.m_peptide = p;
 }
 
+void Conformation::copy_residues(const Conformation &other, int first,
+	int last)
+{
+	assert(m_backbone.size() == other.m_backbone.size());
+
+	if (last < first)
+	{
+		return;
+	}
+
+	std::copy(other.m_backbone.begin() + first * Num_Backbone,
+		other.m_backbone.begin() + (last + 1) * Num_Backbone,
+		m_backbone.begin() + first * Num_Backbone);
+
+	if (m_non_backbone.size() != other.m_non_backbone.size())
+	{
+		reserve_non_backbone(other.m_non_backbone.size());
+		m_non_backbone = other.m_non_backbone;
+	}
+	else
+	if (m_non_backbone.size() != 0)
+	{
+		std::copy(other.m_non_backbone.begin() + first * Num_NonBackbone,
+			other.m_non_backbone.begin() + (last + 1) * Num_NonBackbone,
+			m_non_backbone.begin() + first * Num_NonBackbone);
+	}
+
+	std::copy(other.m_res_data.begin() + first,
+		other.m_res_data.begin() + last + 1,
+		m_res_data.begin() + first);
+}
+
 void Conformation::set_num_res(int n)
 {
+	reserve_backbone(n * Num_Backbone);
 	m_backbone.resize(n * Num_Backbone);
 
 	if (m_non_backbone.size() != 0)
 	{
+		reserve_non_backbone(n * Num_NonBackbone);
 		m_non_backbone.resize(n * Num_NonBackbone);
 	}
 
+	reserve_res_data(n);
 	m_res_data.resize(n);
 }
 
 void Conformation::clear()
 {
-    // (using a temporary variable like this reduces the vector's
-    // capacity to 0; just using erase() would not deallocate any memory)
-
-   	Point_Vec empty_vec;
-   	m_backbone.swap(empty_vec);
+	// (the space goes back to the pool, to be used by the next
+	// conformation that needs it)
+	pool().backbone.put(m_backbone);
 	remove_non_backbone_atoms();
 
 	// TO DO: clear m_res_data as well
@@ -79,11 +306,7 @@ void Conformation::remove_non_backbone_atoms()
 {
 	if (m_non_backbone.size() != 0)
 	{
-    	// (using a temporary variable like this reduces the vector's
-    	// capacity to 0; just using erase() would not deallocate any memory)
-
-    	Point_Vec empty_vec;
-    	m_non_backbone.swap(empty_vec);
+		pool().non_backbone.put(m_non_backbone);
 	}
 }
 
@@ -114,8 +337,9 @@ void Conformation::set_pos(int n, Atom_Id atom, const Point &p)
 	{
 		if (m_non_backbone.size() == 0)
 		{
-			m_non_backbone.resize(
-				(m_backbone.size() / Num_Backbone) * Num_NonBackbone);
+			size_t size = (m_backbone.size() / Num_Backbone) * Num_NonBackbone;
+			reserve_non_backbone(size);
+			m_non_backbone.resize(size);
 		}
 
 		int i = (n * Num_NonBackbone) + atom - Num_Backbone;
@@ -136,8 +360,9 @@ void Conformation::transform_pos(int n, Atom_Id atom, const Transform &t)
 	{
 		if (m_non_backbone.size() == 0)
 		{
-			m_non_backbone.resize(
-				(m_backbone.size() / Num_Backbone) * Num_NonBackbone);
+			size_t size = (m_backbone.size() / Num_Backbone) * Num_NonBackbone;
+			reserve_non_backbone(size);
+			m_non_backbone.resize(size);
 		}
 
 		int i = (n * Num_NonBackbone) + atom - Num_Backbone;
@@ -449,3 +674,85 @@ bool Conformation::in_helix(int n) const
 	return true;
 }
 
+
+Conformation_Delta::Conformation_Delta()
+	: m_first(0), m_last(-1)
+{
+}
+
+void Conformation_Delta::save(const Conformation &conf, int first, int last)
+{
+	m_first = first;
+	m_last = last;
+
+	if (last < first)
+	{
+		m_backbone.clear();
+		m_non_backbone.clear();
+		m_res_data.clear();
+		return;
+	}
+
+	m_backbone.assign(conf.m_backbone.begin() + first * Num_Backbone,
+		conf.m_backbone.begin() + (last + 1) * Num_Backbone);
+
+	if (conf.m_non_backbone.size() != 0)
+	{
+		m_non_backbone.assign(
+			conf.m_non_backbone.begin() + first * Num_NonBackbone,
+			conf.m_non_backbone.begin() + (last + 1) * Num_NonBackbone);
+	}
+	else
+	{
+		m_non_backbone.clear();
+	}
+
+	m_res_data.assign(conf.m_res_data.begin() + first,
+		conf.m_res_data.begin() + last + 1);
+}
+
+void Conformation_Delta::save(const Conformation &conf,
+	const Move_Range &range, int start, int end)
+{
+	if (range.empty())
+	{
+		save(conf, 0, -1);
+	}
+	else
+	if (range.before_moved)
+	{
+		save(conf, start, std::min(range.last + 1, end));
+	}
+	else
+	{
+		save(conf, std::max(range.first - 1, start), end);
+	}
+}
+
+void Conformation_Delta::apply(Conformation &conf) const
+{
+	if (empty())
+	{
+		return;
+	}
+
+	std::copy(m_backbone.begin(), m_backbone.end(),
+		conf.m_backbone.begin() + m_first * Num_Backbone);
+
+	if (m_non_backbone.size() != 0)
+	{
+		if (conf.m_non_backbone.size() == 0)
+		{
+			size_t size =
+				(conf.m_backbone.size() / Num_Backbone) * Num_NonBackbone;
+			conf.reserve_non_backbone(size);
+			conf.m_non_backbone.resize(size);
+		}
+
+		std::copy(m_non_backbone.begin(), m_non_backbone.end(),
+			conf.m_non_backbone.begin() + m_first * Num_NonBackbone);
+	}
+
+	std::copy(m_res_data.begin(), m_res_data.end(),
+		conf.m_res_data.begin() + m_first);
+}
@@ -7,20 +7,31 @@
 // Space is always allocated for backbone atoms;
 // if set_pos() is called with a non-backbone atom, space is
 // also allocated for side chain atoms.
+//
+// The space is taken from (and given back to) a pool kept by each
+// thread, so that conformations that are created and destroyed over and
+// over again (eg. once per run) reuse the same memory.
 
 #include <cassert>
 #include <vector>
+#include <iostream>
 #include "atom_id.h"
 #include "point.h"
+#include "move_range.h"
 
 #define TORSION_UNKNOWN 999.0
 
+// count how often conformation storage is taken from the pool and how
+// often it has to be allocated (see Conformation::print_pool_stats())
+//#define CONFORMATION_POOL_STATS
+
 class Peptide;
 class Transform;
 
 class Conformation
 {
 	friend class CORE_impl;
+	friend class Conformation_Delta;
 public:
 	Conformation();
 	~Conformation();
@@ -35,6 +46,10 @@ public:
 	// swap all values with another conformation
 	void swap(Conformation &other);
 
+	// copy the values for residues first .. last from another
+	// conformation with the same number of residues
+	void copy_residues(const Conformation &other, int first, int last);
+
 	// set the number of residues in the conformation
 	void set_num_res(int n);
 
@@ -86,6 +101,10 @@ public:
 	void set_peptide(const Peptide *p)
 	{ m_peptide = p; }
 
+	// print the calling thread's pool statistics (only counted if
+	// CONFORMATION_POOL_STATS is defined)
+	static void print_pool_stats(std::ostream &out);
+
 private:
 
 	struct ResData
@@ -101,6 +120,26 @@ private:
 
 	typedef std::vector<ResData> ResData_Vec;
 
+	struct Pool;
+
+	// the calling thread's pool
+	static Pool &pool();
+
+	// create the key used to find each thread's pool (called once)
+	static void make_pool_key();
+
+	// destroy a thread's pool when the thread exits
+	static void delete_pool(void *p);
+
+	// make sure each vector has space for at least the given number of
+	// elements, exchanging it for one from the pool if it does not
+	void reserve_backbone(size_t n);
+	void reserve_non_backbone(size_t n);
+	void reserve_res_data(size_t n);
+
+	// give all of the vectors back to the pool (leaving them empty)
+	void release();
+
 	// peptide associated with this conformation
 	const Peptide *m_peptide;
 
@@ -125,5 +164,58 @@ private:
 
 typedef std::vector<Conformation> Conf_Vec;
 
+// Records how a conformation differs from another one (its "base") when
+// only residues first() .. last() have changed, by keeping the new values
+// for just those residues. Applying it to a copy of the base, and rolling
+// it back again, only copies those residues.
+
+class Conformation_Delta
+{
+public:
+	Conformation_Delta();
+
+	// record residues first .. last of conf
+	void save(const Conformation &conf, int first, int last);
+
+	// record the residues of conf that may have been changed by a move
+	// of the peptide with residues start .. end (the window, the side
+	// that was moved, and the residue next to the window on the other
+	// side, whose torsion angles may have changed)
+	void save(const Conformation &conf, const Move_Range &range,
+		int start, int end);
+
+	// whether no residues are recorded
+	bool empty() const
+	{ return m_last < m_first; }
+
+	int first() const
+	{ return m_first; }
+
+	int last() const
+	{ return m_last; }
+
+	// copy the recorded residues into conf
+	void apply(Conformation &conf) const;
+
+	// undo apply(), where base is the conformation the delta was
+	// recorded against
+	void rollback(Conformation &conf, const Conformation &base) const
+	{
+		conf.copy_residues(base, m_first, m_last);
+	}
+
+private:
+	int m_first, m_last;
+
+	// the values for residues m_first .. m_last, stored in the same way
+	// as in Conformation (the vectors keep their capacity from one
+	// save() to the next)
+	Point_Vec m_backbone;
+	Point_Vec m_non_backbone;
+	Conformation::ResData_Vec m_res_data;
+};
+
+typedef std::vector<Conformation_Delta> Conf_Delta_Vec;
+
 #endif // CONFORMATION_H_INCLUDED
 
@@ -0,0 +1,79 @@
+#ifndef MOVE_RANGE_H_INCLUDED
+#define MOVE_RANGE_H_INCLUDED
+
+// Describes how a conformation created by a fragment move differs from
+// the conformation it was created from.
+//
+// The internal geometry of residues first .. last (the "window") has
+// changed. The residues on one side of the window have been moved as a
+// rigid body, and the residues on the other side have not moved at all.
+//
+// So the relative positions of two residues can only have changed if at
+// least one of them is inside the window, or if they are on opposite
+// sides of it. Score terms that are sums over pairs of residues only
+// need to recalculate those pairs.
+
+struct Move_Range
+{
+	int first;			// first residue in the window
+	int last;			// last residue in the window
+	bool before_moved;	// true if residues before the window were moved,
+						// false if residues after the window were moved
+
+	Move_Range() : first(0), last(-1), before_moved(true)
+	{
+	}
+
+	Move_Range(int first_res, int last_res, bool moved_before) :
+		first(first_res), last(last_res), before_moved(moved_before)
+	{
+	}
+
+	// whether nothing has changed
+	bool empty() const
+	{ return last < first; }
+
+	// extend the range to include the changes made by another move
+	// (applied after this one, on the same side)
+	void add(const Move_Range &other)
+	{
+		if (empty())
+		{
+			*this = other;
+		}
+		else
+		if (!other.empty())
+		{
+			if (other.first < first) { first = other.first; }
+			if (other.last > last) { last = other.last; }
+		}
+	}
+
+	// whether the absolute position of residue n may have changed
+	bool moved(int n) const
+	{
+		return !empty() &&
+			(before_moved ? n <= last : n >= first);
+	}
+
+	// whether the torsion angles of residue n may have changed (the
+	// residue on each side of the window is included, since its angles
+	// depend on atoms at the ends of the window)
+	bool angles_changed(int n) const
+	{ return !empty() && n >= first - 1 && n <= last + 1; }
+
+	// whether the relative position of residues n and m may have changed
+	bool pair_changed(int n, int m) const
+	{
+		if (n > m)
+		{
+			return n >= first && m <= last;
+		}
+		else
+		{
+			return m >= first && n <= last;
+		}
+	}
+};
+
+#endif // MOVE_RANGE_H_INCLUDED
@@ -0,0 +1,397 @@
+#include <cmath>
+#include <algorithm>
+#include "peptide.h"
+#include "residue.h"
+#include "atom.h"
+#include "move_range.h"
+#include "neighbour_grid.h"
+
+const double Neighbour_Grid::Margin = 0.001;
+const double Neighbour_Grid::Cell_Size = 10.0;
+
+Neighbour_Grid::Neighbour_Grid() :
+	m_start(0), m_end(-1), m_max_radius(0.0), m_cell_size(Cell_Size),
+	m_skin(0.0), m_list_cutoff(0.0), m_max_cutoff(0.0), m_max_moved(0.0),
+	m_lists_valid(false), m_accepted_valid(false)
+{
+	m_dim[0] = m_dim[1] = m_dim[2] = 0;
+}
+
+void Neighbour_Grid::calc_res_data(const Peptide &p, int n, Res_Data *r) const
+{
+	r->radius = 0.0;
+	r->placed = p.atom_exists(n, Atom_CA);
+
+	if (!r->placed)
+	{
+		return;
+	}
+
+	r->centre = p.atom_pos(n, Atom_CA);
+
+	const Residue &res = p.res(n);
+
+	for (int a = 0;a < res.num_atoms();a++)
+	{
+		double d = r->centre.distance(p.atom_pos2(n, res.atom(a).id()));
+
+		if (d > r->radius)
+		{
+			r->radius = d;
+		}
+	}
+}
+
+void Neighbour_Grid::build(const Peptide &p)
+{
+	m_start = p.start();
+	m_end = p.end();
+	m_res.resize(m_end - m_start + 1);
+	m_unplaced.clear();
+	m_max_radius = 0.0;
+	m_max_moved = 0.0;
+	m_min = Point();
+
+	Point max_pos;
+	bool any_placed = false;
+	int n;
+
+	for (n = m_start;n <= m_end;n++)
+	{
+		Res_Data &r = m_res[n - m_start];
+		calc_res_data(p, n, &r);
+		r.moved = 0.0;
+
+		if (!r.placed)
+		{
+			m_unplaced.push_back(n);
+			continue;
+		}
+
+		if (r.radius > m_max_radius)
+		{
+			m_max_radius = r.radius;
+		}
+
+		if (!any_placed)
+		{
+			m_min = max_pos = r.centre;
+			any_placed = true;
+		}
+		else
+		{
+			m_min.x = std::min(m_min.x, r.centre.x);
+			m_min.y = std::min(m_min.y, r.centre.y);
+			m_min.z = std::min(m_min.z, r.centre.z);
+			max_pos.x = std::max(max_pos.x, r.centre.x);
+			max_pos.y = std::max(max_pos.y, r.centre.y);
+			max_pos.z = std::max(max_pos.z, r.centre.z);
+		}
+	}
+
+	// use bigger cells if the conformation is very spread out
+	// (so that the number of cells stays proportional to the
+	// number of residues)
+
+	int max_cells = std::max(64, 4 * (int) m_res.size());
+	int num_cells;
+	m_cell_size = Cell_Size;
+
+	for (;;)
+	{
+		m_dim[0] = (int) ((max_pos.x - m_min.x) / m_cell_size) + 1;
+		m_dim[1] = (int) ((max_pos.y - m_min.y) / m_cell_size) + 1;
+		m_dim[2] = (int) ((max_pos.z - m_min.z) / m_cell_size) + 1;
+		num_cells = m_dim[0] * m_dim[1] * m_dim[2];
+
+		if (num_cells <= max_cells)
+		{
+			break;
+		}
+
+		m_cell_size *= 2.0;
+	}
+
+	// sort the residues into cells (counting sort, so the residues in
+	// each cell stay in increasing order)
+
+	std::vector<int> res_cell(m_res.size(), -1);
+	m_cell_first.assign(num_cells + 1, 0);
+
+	for (n = m_start;n <= m_end;n++)
+	{
+		const Res_Data &r = m_res[n - m_start];
+
+		if (r.placed)
+		{
+			int c = (cell_coord(r.centre.z, m_min.z, m_dim[2]) * m_dim[1] +
+				cell_coord(r.centre.y, m_min.y, m_dim[1])) * m_dim[0] +
+				cell_coord(r.centre.x, m_min.x, m_dim[0]);
+
+			res_cell[n - m_start] = c;
+			m_cell_first[c + 1]++;
+		}
+	}
+
+	for (int c = 0;c < num_cells;c++)
+	{
+		m_cell_first[c + 1] += m_cell_first[c];
+	}
+
+	std::vector<int> next(m_cell_first.begin(), m_cell_first.end() - 1);
+	m_cell_res.resize(m_cell_first[num_cells]);
+
+	for (n = m_start;n <= m_end;n++)
+	{
+		int c = res_cell[n - m_start];
+
+		if (c != -1)
+		{
+			m_cell_res[next[c]++] = n;
+		}
+	}
+
+	m_lists_valid = false;
+
+	if (m_skin > 0.0)
+	{
+		// remember where the atoms were, so that it is possible to tell
+		// how far they have moved since the lists were built
+
+		m_ref_first.resize(m_res.size() + 1);
+		m_ref_pos.clear();
+
+		for (n = m_start;n <= m_end;n++)
+		{
+			const Residue &res = p.res(n);
+			m_ref_first[n - m_start] = (int) m_ref_pos.size();
+
+			for (int a = 0;a < res.num_atoms();a++)
+			{
+				m_ref_pos.push_back(p.atom_pos2(n, res.atom(a).id()));
+			}
+		}
+
+		m_ref_first[m_res.size()] = (int) m_ref_pos.size();
+
+		if (m_max_cutoff > 0.0)
+		{
+			build_lists();
+		}
+	}
+}
+
+void Neighbour_Grid::build_lists()
+{
+	m_list_cutoff = m_max_cutoff;
+	m_list.resize(m_res.size());
+
+	for (int n = m_start;n <= m_end;n++)
+	{
+		search_grid(n, m_list_cutoff + m_skin, m_end + 1,
+			&m_list[n - m_start]);
+	}
+
+	m_lists_valid = true;
+}
+
+void Neighbour_Grid::update(const Peptide &p, const Move_Range *range,
+	double skin)
+{
+	if (skin != m_skin)
+	{
+		m_skin = skin;
+		m_accepted_valid = false;
+	}
+
+	if (m_skin <= 0.0 || range == NULL || !m_accepted_valid ||
+		!m_lists_valid || m_max_cutoff > m_list_cutoff ||
+		p.start() != m_start || p.end() != m_end)
+	{
+		build(p);
+
+		// (the new lists are for a conformation that may not be accepted)
+		m_accepted_valid = false;
+		return;
+	}
+
+	// only the residues that the move changed need to be checked
+
+	m_res = m_accepted_res;
+
+	int n;
+	for (n = m_start;n <= m_end;n++)
+	{
+		if (range->moved(n))
+		{
+			Res_Data &r = m_res[n - m_start];
+			calc_res_data(p, n, &r);
+			r.moved = 0.0;
+
+			const Residue &res = p.res(n);
+			const Point *ref = &m_ref_pos[m_ref_first[n - m_start]];
+
+			for (int a = 0;a < res.num_atoms();a++)
+			{
+				double d = ref[a].distance(p.atom_pos2(n, res.atom(a).id()));
+
+				if (d > r.moved)
+				{
+					r.moved = d;
+				}
+			}
+		}
+	}
+
+	// A pair of residues that is not in the lists was at least
+	// m_list_cutoff + m_skin apart, so it is still further apart than
+	// m_list_cutoff unless the two residues have moved a total of more
+	// than m_skin.
+
+	double moved1 = 0.0, moved2 = 0.0;
+	m_max_radius = 0.0;
+
+	for (n = m_start;n <= m_end;n++)
+	{
+		const Res_Data &r = m_res[n - m_start];
+
+		if (r.moved > moved1)
+		{
+			moved2 = moved1;
+			moved1 = r.moved;
+		}
+		else
+		if (r.moved > moved2)
+		{
+			moved2 = r.moved;
+		}
+
+		if (r.placed && r.radius > m_max_radius)
+		{
+			m_max_radius = r.radius;
+		}
+	}
+
+	if (moved1 + moved2 >= m_skin)
+	{
+		build(p);
+		m_accepted_valid = false;
+		return;
+	}
+
+	m_max_moved = moved1;
+}
+
+void Neighbour_Grid::accept()
+{
+	if (m_skin > 0.0)
+	{
+		m_accepted_res = m_res;
+		m_accepted_valid = true;
+	}
+}
+
+int Neighbour_Grid::cell_coord(double val, double min_val, int dim) const
+{
+	double c = floor((val - min_val) / m_cell_size);
+
+	if (c < 0.0) { return 0; }
+	if (c >= (double) dim) { return dim - 1; }
+	return (int) c;
+}
+
+void Neighbour_Grid::use_cutoff(double cutoff)
+{
+	if (cutoff > m_max_cutoff)
+	{
+		m_max_cutoff = cutoff;
+	}
+}
+
+void Neighbour_Grid::find_near(int n, double cutoff, int below,
+	std::vector<int> *result) const
+{
+	if (m_lists_valid && cutoff <= m_list_cutoff)
+	{
+		const std::vector<int> &list = m_list[n - m_start];
+		result->clear();
+
+		for (size_t i = 0;i < list.size() && list[i] < below;i++)
+		{
+			if (may_be_near(n, list[i], cutoff))
+			{
+				result->push_back(list[i]);
+			}
+		}
+
+		return;
+	}
+
+	search_grid(n, cutoff, below, result);
+}
+
+void Neighbour_Grid::search_grid(int n, double cutoff, int below,
+	std::vector<int> *result) const
+{
+	result->clear();
+
+	if (below > m_end + 1)
+	{
+		below = m_end + 1;
+	}
+
+	const Res_Data &r = m_res[n - m_start];
+
+	if (!r.placed)
+	{
+		for (int m = m_start;m < below;m++)
+		{
+			if (m != n)
+			{
+				result->push_back(m);
+			}
+		}
+
+		return;
+	}
+
+	// all residues that may be near n are within this distance of its
+	// CA (the residues were put into cells before they moved by up to
+	// m_max_moved)
+	double reach = cutoff + r.radius + m_max_radius + m_max_moved + Margin;
+
+	int x1 = cell_coord(r.centre.x - reach, m_min.x, m_dim[0]);
+	int x2 = cell_coord(r.centre.x + reach, m_min.x, m_dim[0]);
+	int y1 = cell_coord(r.centre.y - reach, m_min.y, m_dim[1]);
+	int y2 = cell_coord(r.centre.y + reach, m_min.y, m_dim[1]);
+	int z1 = cell_coord(r.centre.z - reach, m_min.z, m_dim[2]);
+	int z2 = cell_coord(r.centre.z + reach, m_min.z, m_dim[2]);
+
+	for (int z = z1;z <= z2;z++)
+	{
+		for (int y = y1;y <= y2;y++)
+		{
+			int c = (z * m_dim[1] + y) * m_dim[0];
+
+			for (int i = m_cell_first[c + x1];i < m_cell_first[c + x2 + 1];i++)
+			{
+				int m = m_cell_res[i];
+
+				if (m < below && m != n && may_be_near(n, m, cutoff))
+				{
+					result->push_back(m);
+				}
+			}
+		}
+	}
+
+	for (size_t i = 0;i < m_unplaced.size() && m_unplaced[i] < below;i++)
+	{
+		if (m_unplaced[i] != n)
+		{
+			result->push_back(m_unplaced[i]);
+		}
+	}
+
+	std::sort(result->begin(), result->end());
+}
@@ -0,0 +1,155 @@
+#ifndef NEIGHBOUR_GRID_H_INCLUDED
+#define NEIGHBOUR_GRID_H_INCLUDED
+
+// Uniform grid (cell list) of the residues in a conformation, used to
+// quickly find the pairs of residues that are close enough together to
+// interact.
+//
+// Each residue is represented by the position of its CA atom and a radius
+// (the largest distance from the CA to any atom in the residue). A query
+// for the residues within a cutoff distance of residue n returns every
+// residue that has any atom within the cutoff of any atom of residue n
+// (plus some residues that are slightly further away), so a score term
+// only needs to check the atoms of those residues.
+//
+// Residues without a CA atom are treated as being close to everything.
+//
+// Optionally, each residue also has a Verlet neighbour list: the residues
+// within the largest cutoff queried so far plus a "skin" distance. If
+// update() is used instead of build(), the lists (and the grid) are kept
+// until some atoms have moved far enough that the skin may have been used
+// up, so conformations that differ only slightly from the one the lists
+// were built for do not need a new neighbour search.
+
+#include <vector>
+#include "point.h"
+
+class Peptide;
+struct Move_Range;
+
+class Neighbour_Grid
+{
+public:
+	Neighbour_Grid();
+
+	// index residues p.start() .. p.end() of a peptide
+	// (the grid must be rebuilt whenever the conformation changes)
+	void build(const Peptide &p);
+
+	// Use the peptide's conformation, which differs from the conformation
+	// last passed to accept() only as described by range (if range is
+	// NULL, it may differ in any way). The neighbour lists are only
+	// rebuilt if atoms may have moved by more than the skin distance
+	// since they were last built. If skin is 0, the same as build().
+	void update(const Peptide &p, const Move_Range *range, double skin);
+
+	// the conformation last passed to update() is now the current
+	// conformation
+	void accept();
+
+	// first and last residues indexed by the last call to build()
+	int start() const
+	{ return m_start; }
+
+	int end() const
+	{ return m_end; }
+
+	// check whether any atom of residue n may be within "cutoff" of any
+	// atom of residue m (if false, they are definitely further apart)
+	bool may_be_near(int n, int m, double cutoff) const
+	{
+		const Res_Data &r1 = m_res[n - m_start];
+		const Res_Data &r2 = m_res[m - m_start];
+
+		if (!r1.placed || !r2.placed)
+		{
+			return true;
+		}
+
+		double d = cutoff + r1.radius + r2.radius + Margin;
+		double dx = r1.centre.x - r2.centre.x;
+		double dy = r1.centre.y - r2.centre.y;
+		double dz = r1.centre.z - r2.centre.z;
+
+		return dx * dx + dy * dy + dz * dz < d * d;
+	}
+
+	// record that find_near() is going to be called with "cutoff", so
+	// that the Verlet lists (if used) are built to cover it
+	void use_cutoff(double cutoff);
+
+	// find the residues m < below (other than n itself) that may have
+	// an atom within "cutoff" of an atom of residue n (as for
+	// may_be_near()). The residue numbers are stored in *result in
+	// increasing order. The Verlet lists are only used if use_cutoff()
+	// has been called with a cutoff at least this large. (Does not
+	// change the grid, so it can be called by several threads at once.)
+	void find_near(int n, double cutoff, int below,
+		std::vector<int> *result) const;
+
+private:
+	// added to cutoff distances so that rounding errors cannot cause
+	// an interacting pair of residues to be missed
+	static const double Margin;
+
+	// preferred width of a grid cell (in Angstroms)
+	static const double Cell_Size;
+
+	struct Res_Data
+	{
+		Point centre;	// CA position
+		double radius;	// maximum distance from the CA to another atom
+		bool placed;	// false if the residue has no CA atom
+		double moved;	// (Verlet lists) maximum distance any atom has
+						// moved since the lists were built
+	};
+
+	// calculate the Res_Data for residue n (apart from "moved")
+	void calc_res_data(const Peptide &p, int n, Res_Data *r) const;
+
+	// build the Verlet lists (the grid must be up to date)
+	void build_lists();
+
+	// find neighbours using the grid
+	void search_grid(int n, double cutoff, int below,
+		std::vector<int> *result) const;
+
+	// get the cell coordinate along one axis (clipped to the grid)
+	int cell_coord(double val, double min_val, int dim) const;
+
+	int m_start, m_end;				// residues indexed
+	std::vector<Res_Data> m_res;	// (indexed by residue number - m_start)
+	std::vector<int> m_unplaced;	// residues with no CA atom
+	double m_max_radius;			// largest radius of any residue
+
+	Point m_min;					// lowest corner of the grid
+	double m_cell_size;				// width of each cell
+	int m_dim[3];					// number of cells along each axis
+
+	// residues in each cell: m_cell_res[m_cell_first[c]] ..
+	// m_cell_res[m_cell_first[c + 1] - 1] (in increasing order)
+	std::vector<int> m_cell_first;
+	std::vector<int> m_cell_res;
+
+	// Verlet lists
+
+	double m_skin;					// skin distance (0 if lists not used)
+	double m_list_cutoff;			// cutoff the lists were built for
+	double m_max_cutoff;			// largest cutoff passed to use_cutoff()
+	double m_max_moved;				// largest Res_Data::moved value
+	bool m_lists_valid;				// whether the lists can be used
+
+	// neighbours of each residue (in increasing order)
+	std::vector< std::vector<int> > m_list;
+
+	// atom positions when the lists were built
+	// (indexed by m_ref_first[n - m_start] + atom number)
+	std::vector<Point> m_ref_pos;
+	std::vector<int> m_ref_first;
+
+	// values from the conformation last passed to accept()
+	std::vector<Res_Data> m_accepted_res;
+	bool m_accepted_valid;
+};
+
+#endif // NEIGHBOUR_GRID_H_INCLUDED
@@ -0,0 +1,109 @@
+#include <cmath>
+#include "peptide.h"
+#include "geom.h"
+#include "move_range.h"
+#include "topology.h"
+#include "residue_geometry.h"
+
+Residue_Geometry::Residue_Geometry() :
+	m_start(0), m_end(-1), m_accepted_valid(false)
+{
+}
+
+void Residue_Geometry::calc_res_data(const Peptide &p,
+	const Topology &topology, int n, Res_Data *r)
+{
+	r->flags = 0;
+
+	if (topology.atom_exists(n, Atom_CA))
+	{
+		r->flags |= Has_CA;
+		r->ca = p.atom_pos(n, Atom_CA);
+	}
+
+	Atom_Id cb_ca = topology.cb_ca(n);
+
+	if (cb_ca != Atom_Undef)
+	{
+		r->flags |= Has_CB_CA;
+		r->cb_ca = p.atom_pos(n, cb_ca);
+	}
+
+	// (the same as Peptide::get_side_chain_pos())
+	if (topology.is_glycine(n))
+	{
+		static const unsigned Needed = Topology::mask(Atom_CA) |
+			Topology::mask(Atom_N) | Topology::mask(Atom_C);
+
+		if (topology.atoms_exist(n, Needed))
+		{
+			r->flags |= Has_Side_Chain;
+			r->side_chain = estimate_CB_pos(r->ca,
+				p.atom_pos(n, Atom_N), p.atom_pos(n, Atom_C));
+		}
+	}
+	else
+	if (cb_ca != Atom_Undef)
+	{
+		r->flags |= Has_Side_Chain;
+		r->side_chain = r->cb_ca;
+	}
+
+	r->side_chain_dir = Point(0.0, 0.0, 0.0);
+
+	if ((r->flags & Has_CA) && (r->flags & Has_Side_Chain))
+	{
+		Point v = r->side_chain.minus(r->ca);
+
+		// (Point::normalise() does not allow a zero length vector)
+		if (v.length() > 0.000000000001)
+		{
+			r->side_chain_dir = v.normalised();
+		}
+	}
+}
+
+void Residue_Geometry::build(const Peptide &p, const Topology &topology)
+{
+	m_start = p.start();
+	m_end = p.end();
+	m_res.resize(p.full_length());
+
+	for (int n = m_start;n <= m_end;n++)
+	{
+		calc_res_data(p, topology, n, &m_res[n]);
+	}
+}
+
+void Residue_Geometry::update(const Peptide &p, const Topology &topology,
+	const Move_Range *range)
+{
+	if (range == NULL || !m_accepted_valid ||
+		p.start() != m_start || p.end() != m_end ||
+		(int) m_accepted_res.size() != p.full_length())
+	{
+		build(p, topology);
+
+		// (the values are for a conformation that may not be accepted)
+		m_accepted_valid = false;
+		return;
+	}
+
+	// only the residues that the move changed need to be recalculated
+
+	m_res = m_accepted_res;
+
+	for (int n = m_start;n <= m_end;n++)
+	{
+		if (range->moved(n))
+		{
+			calc_res_data(p, topology, n, &m_res[n]);
+		}
+	}
+}
+
+void Residue_Geometry::accept()
+{
+	m_accepted_res = m_res;
+	m_accepted_valid = true;
+}
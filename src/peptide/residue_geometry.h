@@ -0,0 +1,98 @@
+#ifndef RESIDUE_GEOMETRY_H_INCLUDED
+#define RESIDUE_GEOMETRY_H_INCLUDED
+
+// Positions and directions derived from the atoms of each residue in a
+// conformation, which several score terms would otherwise each calculate
+// for every pair of residues: the CA position, the CB position (CA for
+// glycine), the side chain position (see Peptide::get_side_chain_pos())
+// and the unit vector from the CA to the side chain.
+//
+// Scorer_Combined updates one of these for each conformation it scores
+// and passes it to the score terms. Like Neighbour_Grid, if update() is
+// given the Move_Range of a fragment move, only the residues that the
+// move changed are recalculated.
+
+#include <vector>
+#include "point.h"
+
+class Peptide;
+class Topology;
+struct Move_Range;
+
+class Residue_Geometry
+{
+public:
+	Residue_Geometry();
+
+	// calculate the values for residues p.start() .. p.end() of a
+	// peptide (topology must have been built for the peptide)
+	void build(const Peptide &p, const Topology &topology);
+
+	// Use the peptide's conformation, which differs from the conformation
+	// last passed to accept() only as described by range (if range is
+	// NULL, it may differ in any way).
+	void update(const Peptide &p, const Topology &topology,
+		const Move_Range *range);
+
+	// the conformation last passed to update() is now the current
+	// conformation
+	void accept();
+
+	// whether residue n has a CA atom, and its position
+	bool has_ca(int n) const
+	{ return (m_res[n].flags & Has_CA) != 0; }
+
+	const Point &ca(int n) const
+	{ return m_res[n].ca; }
+
+	// whether residue n has a CB atom (CA for glycine), and its position
+	bool has_cb_ca(int n) const
+	{ return (m_res[n].flags & Has_CB_CA) != 0; }
+
+	const Point &cb_ca(int n) const
+	{ return m_res[n].cb_ca; }
+
+	// whether the side chain position of residue n is known (it has a CB
+	// atom, or for glycine, the atoms needed to estimate one), and the
+	// position
+	bool has_side_chain(int n) const
+	{ return (m_res[n].flags & Has_Side_Chain) != 0; }
+
+	const Point &side_chain(int n) const
+	{ return m_res[n].side_chain; }
+
+	// unit vector from the CA atom of residue n to its side chain
+	// (only if has_ca(n) and has_side_chain(n))
+	const Point &side_chain_dir(int n) const
+	{ return m_res[n].side_chain_dir; }
+
+private:
+	enum
+	{
+		Has_CA = 1,
+		Has_CB_CA = 2,
+		Has_Side_Chain = 4
+	};
+
+	struct Res_Data
+	{
+		Point ca;
+		Point cb_ca;
+		Point side_chain;
+		Point side_chain_dir;
+		unsigned flags;			// Has_CA etc.
+	};
+
+	// calculate the values for residue n
+	static void calc_res_data(const Peptide &p, const Topology &topology,
+		int n, Res_Data *r);
+
+	int m_start, m_end;				// residues calculated
+	std::vector<Res_Data> m_res;	// (indexed by residue number)
+
+	// values from the conformation last passed to accept()
+	std::vector<Res_Data> m_accepted_res;
+	bool m_accepted_valid;
+};
+
+#endif // RESIDUE_GEOMETRY_H_INCLUDED
@@ -0,0 +1,120 @@
+
+#include <cassert>
+#include "peptide.h"
+#include "residue.h"
+#include "atom.h"
+#include "amino.h"
+#include "atom_type.h"
+#include "topology.h"
+
+Topology::Topology()
+{
+	m_first_atom.push_back(0);
+}
+
+unsigned Topology::find_mask(const Peptide &p, int n)
+{
+	unsigned m = 0;
+
+	for (int a = 0;a < Num_Backbone;a++)
+	{
+		if (p.atom_exists(n, (Atom_Id) a))
+		{
+			m |= mask((Atom_Id) a);
+		}
+	}
+
+	return m;
+}
+
+int Topology::count_side_chain(const Peptide &p, int n)
+{
+	const Residue &res = p.res(n);
+	int count = 0;
+
+	for (int a = Num_Backbone;a < res.num_atoms();a++)
+	{
+		if (!res.atom(a).undefined())
+		{
+			count++;
+		}
+	}
+
+	return count;
+}
+
+void Topology::build(const Peptide &p)
+{
+	int len = p.full_length();
+
+	m_amino.resize(len);
+	m_glycine.resize(len);
+	m_mask.resize(len);
+	m_cb_ca.resize(len);
+	m_first_atom.resize(len + 1);
+	m_end_backbone.resize(len);
+	m_atom_type.clear();
+	m_rapdf_id.clear();
+
+	for (int n = 0;n < len;n++)
+	{
+		const Residue &res = p.res(n);
+		Amino aa = res.amino();
+
+		m_amino[n] = aa.num();
+		m_glycine[n] = aa.is_glycine();
+		m_mask[n] = find_mask(p, n);
+
+		Atom_Id cb_ca = (aa.is_glycine() ? Atom_CA : Atom_CB);
+		m_cb_ca[n] = (atom_exists(n, cb_ca) ? cb_ca : Atom_Undef);
+
+		m_first_atom[n] = (int) m_atom_type.size();
+
+		// (backbone atoms are stored in the residue in Atom_Id order,
+		// followed by the side chain atoms)
+		for (int a = 0;a < res.num_atoms();a++)
+		{
+			if (a == Num_Backbone)
+			{
+				m_end_backbone[n] = (int) m_atom_type.size();
+			}
+
+			Atom_Type t = res.atom(a).type();
+
+			if (!t.undefined())
+			{
+				m_atom_type.push_back(t.type());
+				m_rapdf_id.push_back(aa.rapdf_id(t));
+			}
+		}
+
+		if (res.num_atoms() <= Num_Backbone)
+		{
+			m_end_backbone[n] = (int) m_atom_type.size();
+		}
+	}
+
+	m_first_atom[len] = (int) m_atom_type.size();
+}
+
+bool Topology::update(const Peptide &p)
+{
+	int len = p.full_length();
+	bool same = (len == num_res());
+
+	for (int n = 0;same && n < len;n++)
+	{
+		same = (p.res(n).amino().num() == m_amino[n] &&
+			find_mask(p, n) == m_mask[n] &&
+			count_side_chain(p, n) ==
+				m_first_atom[n + 1] - m_end_backbone[n]);
+	}
+
+	if (same)
+	{
+		return false;
+	}
+
+	build(p);
+	return true;
+}
@@ -0,0 +1,106 @@
+#ifndef TOPOLOGY_H_INCLUDED
+#define TOPOLOGY_H_INCLUDED
+
+// The parts of a peptide that the score terms use and that do not change
+// while it is being folded: the amino acid of each residue and which
+// atoms it has. These are kept in flat arrays, so that the score
+// terms do not need to look them up through each Residue (and its Atom
+// and Amino objects) for every pair of residues.
+//
+// The atoms of all residues are numbered consecutively, in the same order
+// as in each Residue, so the atoms of residue n are numbers first_atom(n)
+// to first_atom(n + 1) - 1. The backbone atoms come first (in Atom_Id
+// order), up to end_backbone(n) - 1.
+//
+// Scorer_Combined builds one topology for the sequence and passes it to
+// each score term. Score terms that are not given one keep their own.
+
+#include <vector>
+#include "atom_id.h"
+
+class Peptide;
+
+class Topology
+{
+public:
+	// constructor
+	Topology();
+
+	// build the topology for a peptide (all residues up to
+	// p.full_length(), not just the extruded ones)
+	void build(const Peptide &p);
+
+	// build the topology for a peptide, unless it was built for a
+	// peptide with the same residues (returns true if it was rebuilt)
+	bool update(const Peptide &p);
+
+	// number of residues
+	int num_res() const
+	{ return (int) m_amino.size(); }
+
+	// amino acid number of residue n
+	int amino(int n) const
+	{ return m_amino[n]; }
+
+	bool is_glycine(int n) const
+	{ return m_glycine[n] != 0; }
+
+	// bitmask of the backbone atoms of residue n
+	// (bit a is set if atom a exists)
+	unsigned atom_mask(int n) const
+	{ return m_mask[n]; }
+
+	// whether residue n has backbone atom a
+	bool atom_exists(int n, Atom_Id a) const
+	{ return ((m_mask[n] >> a) & 1) != 0; }
+
+	// whether residue n has all of the atoms in mask
+	bool atoms_exist(int n, unsigned mask) const
+	{ return (m_mask[n] & mask) == mask; }
+
+	// bit for atom a in an atom mask
+	static unsigned mask(Atom_Id a)
+	{ return 1u << a; }
+
+	// the CB atom of residue n (CA for glycine), or Atom_Undef if the
+	// residue does not have it
+	Atom_Id cb_ca(int n) const
+	{ return m_cb_ca[n]; }
+
+	// number of the first atom of residue n (n may be num_res())
+	int first_atom(int n) const
+	{ return m_first_atom[n]; }
+
+	// number of the first side chain atom of residue n (or
+	// first_atom(n + 1) if it has none)
+	int end_backbone(int n) const
+	{ return m_end_backbone[n]; }
+
+	// type of atom i (for backbone atoms, also the index of its
+	// Lennard-Jones parameters)
+	Atom_Id atom_type(int i) const
+	{ return m_atom_type[i]; }
+
+	// RAPDF id of atom i (see Amino::rapdf_id())
+	int rapdf_id(int i) const
+	{ return m_rapdf_id[i]; }
+
+private:
+	// find the backbone atom mask of residue n of a peptide
+	static unsigned find_mask(const Peptide &p, int n);
+
+	// find the number of side chain atoms of residue n of a peptide
+	static int count_side_chain(const Peptide &p, int n);
+
+private:
+	std::vector<int> m_amino;
+	std::vector<char> m_glycine;
+	std::vector<unsigned> m_mask;
+	std::vector<Atom_Id> m_cb_ca;
+	std::vector<int> m_first_atom;
+	std::vector<int> m_end_backbone;
+	std::vector<Atom_Id> m_atom_type;
+	std::vector<int> m_rapdf_id;
+};
+
+#endif // TOPOLOGY_H_INCLUDED
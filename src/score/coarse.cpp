@@ -0,0 +1,182 @@
+
+#include <cmath>
+#include <algorithm>
+#include "common.h"
+#include "peptide.h"
+#include "topology.h"
+#include "move_range.h"
+#include "restraint_list.h"
+#include "coarse.h"
+
+const double Coarse::Clash_Dist = 4.0;
+const double Coarse::Burial_Dist = 10.0;
+const double Coarse::Contact_Dist = 8.0;
+
+Coarse::Coarse()
+	: m_clash_weight(1.0), m_burial_weight(1.0), m_contact_weight(1.0),
+	  m_map_size(0), m_start(0), m_end(-1), m_curr_total(0.0),
+	  m_curr_total_valid(false)
+{
+}
+
+void Coarse::set_weights(double clash, double burial, double contact)
+{
+	m_clash_weight = clash;
+	m_burial_weight = burial;
+	m_contact_weight = contact;
+	m_curr_total_valid = false;
+}
+
+void Coarse::set_contacts(const Restraint_List *contacts)
+{
+	m_map_size = 0;
+	m_contact_map.clear();
+	m_curr_total_valid = false;
+
+	if (contacts == NULL)
+	{
+		return;
+	}
+
+	int k;
+
+	for (k = 0;k < contacts->size();k++)
+	{
+		m_map_size = std::max(m_map_size, contacts->res1(k) + 1);
+		m_map_size = std::max(m_map_size, contacts->res2(k) + 1);
+	}
+
+	m_contact_map.assign(m_map_size * m_map_size, 0);
+
+	for (k = 0;k < contacts->size();k++)
+	{
+		int n1 = contacts->res1(k);
+		int n2 = contacts->res2(k);
+		m_contact_map[n1 * m_map_size + n2] += contacts->weight(k);
+
+		if (n1 != n2)
+		{
+			m_contact_map[n2 * m_map_size + n1] += contacts->weight(k);
+		}
+	}
+}
+
+void Coarse::get_pos(const Peptide &p, const Topology &topology,
+	std::vector<Res_Pos> *pos)
+{
+	pos->resize(p.full_length());
+
+	for (int n = p.start();n <= p.end();n++)
+	{
+		Res_Pos &r = (*pos)[n];
+		Atom_Id cb_ca = topology.cb_ca(n);
+
+		r.has_ca = topology.atom_exists(n, Atom_CA);
+		r.has_cb = (cb_ca != Atom_Undef);
+
+		if (r.has_ca)
+		{
+			r.ca = p.atom_pos(n, Atom_CA);
+		}
+
+		if (r.has_cb)
+		{
+			r.cb = p.atom_pos(n, cb_ca);
+		}
+	}
+}
+
+double Coarse::pair_value(int n1, int n2, const Res_Pos &r1,
+	const Res_Pos &r2) const
+{
+	double s = 0.0;
+
+	if (r1.has_ca && r2.has_ca)
+	{
+		double d2 = square(r1.ca.x - r2.ca.x) + square(r1.ca.y - r2.ca.y) +
+			square(r1.ca.z - r2.ca.z);
+
+		if (d2 < square(Clash_Dist))
+		{
+			s += m_clash_weight * (square(Clash_Dist) - d2);
+		}
+	}
+
+	if (r1.has_cb && r2.has_cb)
+	{
+		double d2 = square(r1.cb.x - r2.cb.x) + square(r1.cb.y - r2.cb.y) +
+			square(r1.cb.z - r2.cb.z);
+
+		if (d2 < square(Burial_Dist))
+		{
+			s -= m_burial_weight;
+		}
+
+		int w = contact_weight(n1, n2);
+
+		// (the same as in Contact::score())
+		if (w != 0 && d2 > square(Contact_Dist))
+		{
+			s += m_contact_weight * w * (sqrt(d2) - 1.0);
+		}
+	}
+
+	return s;
+}
+
+double Coarse::total(int start, int end,
+	const std::vector<Res_Pos> &pos) const
+{
+	double s = 0.0;
+
+	for (int n1 = start + 2;n1 <= end;n1++)
+	{
+		for (int n2 = start;n2 < n1 - 1;n2++)
+		{
+			s += pair_value(n1, n2, pos[n1], pos[n2]);
+		}
+	}
+
+	return s;
+}
+
+void Coarse::begin(const Peptide &p, const Topology &topology)
+{
+	m_start = p.start();
+	m_end = p.end();
+	get_pos(p, topology, &m_curr);
+	m_curr_total_valid = false;
+}
+
+double Coarse::score_change(const Peptide &p, const Topology &topology,
+	const Move_Range *range)
+{
+	get_pos(p, topology, &m_trial);
+
+	if (range == NULL || p.start() != m_start || p.end() != m_end)
+	{
+		if (!m_curr_total_valid)
+		{
+			m_curr_total = total(m_start, m_end, m_curr);
+			m_curr_total_valid = true;
+		}
+
+		return total(p.start(), p.end(), m_trial) - m_curr_total;
+	}
+
+	// only the pairs for which range->pair_changed() is true
+	double change = 0.0;
+
+	for (int n1 = std::max(range->first, m_start + 2);n1 <= m_end;n1++)
+	{
+		int last = std::min(range->last, n1 - 2);
+
+		for (int n2 = m_start;n2 <= last;n2++)
+		{
+			change += pair_value(n1, n2, m_trial[n1], m_trial[n2]) -
+				pair_value(n1, n2, m_curr[n1], m_curr[n2]);
+		}
+	}
+
+	return change;
+}
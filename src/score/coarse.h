@@ -0,0 +1,105 @@
+#ifndef COARSE_H_INCLUDED
+#define COARSE_H_INCLUDED
+
+// A cheap approximation to the change in score caused by a move, which
+// only looks at the CA and CB atoms of each residue (CA for glycine). It
+// is used to decide which of several candidate conformations are worth
+// scoring in full (see Scorer::coarse_score()).
+//
+// The value is a sum over pairs of residues (at least two apart) of:
+//
+// - a clash penalty if their CA atoms are closer than Clash_Dist;
+// - a burial reward if their CB atoms are closer than Burial_Dist (the
+//   residue level equivalent of the solvation term's atom counts);
+// - for predicted contacts, the same penalty as the Contact term if their
+//   CB atoms are further apart than Contact_Dist.
+//
+// begin() stores the positions in the current conformation, and
+// score_change() then gives the difference between a candidate and the
+// current conformation. For a fragment move described by a Move_Range,
+// only the pairs of residues whose relative positions changed are
+// looked at.
+
+#include <vector>
+#include "point.h"
+
+class Peptide;
+class Topology;
+class Restraint_List;
+struct Move_Range;
+
+class Coarse
+{
+public:
+	// distances used by the three parts of the score
+	static const double Clash_Dist;
+	static const double Burial_Dist;
+	static const double Contact_Dist;
+
+	// constructor
+	Coarse();
+
+	// set the weight of each part of the score
+	void set_weights(double clash, double burial, double contact);
+
+	// use the predicted contacts in *contacts (none if NULL)
+	void set_contacts(const Restraint_List *contacts);
+
+	// store the positions of residues p.start() .. p.end() of the current
+	// conformation (topology must have been built for the peptide)
+	void begin(const Peptide &p, const Topology &topology);
+
+	// Estimate of the change in score between the conformation last
+	// passed to begin() and p, which has the same residues. If range is
+	// not NULL, p differs from it only as described by range.
+	double score_change(const Peptide &p, const Topology &topology,
+		const Move_Range *range);
+
+private:
+	struct Res_Pos
+	{
+		Point ca;
+		Point cb;
+		bool has_ca;
+		bool has_cb;
+	};
+
+	// find the positions of residues p.start() .. p.end()
+	static void get_pos(const Peptide &p, const Topology &topology,
+		std::vector<Res_Pos> *pos);
+
+	// the value for residues n1 and n2 (n1 > n2 + 1)
+	double pair_value(int n1, int n2, const Res_Pos &r1,
+		const Res_Pos &r2) const;
+
+	// the sum of pair_value() over all pairs of residues
+	double total(int start, int end, const std::vector<Res_Pos> &pos) const;
+
+	// whether residues n1 and n2 are predicted to be in contact, and
+	// the weight of the contact
+	int contact_weight(int n1, int n2) const
+	{
+		return (n1 < m_map_size && n2 < m_map_size ?
+			m_contact_map[n1 * m_map_size + n2] : 0);
+	}
+
+private:
+	double m_clash_weight;
+	double m_burial_weight;
+	double m_contact_weight;
+
+	// contact_weight() for each pair of residues (in both orders)
+	std::vector<int> m_contact_map;
+	int m_map_size;
+
+	// values for the conformation last passed to begin()
+	int m_start, m_end;
+	std::vector<Res_Pos> m_curr;
+	double m_curr_total;		// (only calculated when needed)
+	bool m_curr_total_valid;
+
+	// (used by score_change())
+	std::vector<Res_Pos> m_trial;
+};
+
+#endif // COARSE_H_INCLUDED
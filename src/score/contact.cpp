@@ -22,6 +22,7 @@
 #include "atom.h"
 #include "scorer_combined.h"
 #include "contact.h"
+#include "move_range.h"
 
 Contact::Contact()
 {
@@ -33,61 +34,113 @@ Contact::~Contact()
 
 void Contact::set_short_data_file(const std::string &filename)
 {
+	if (filename != m_filename)
+	{
+		m_contacts.clear();
+	}
+
 	m_filename = filename;
 }
 
 void Contact::set_long_data_file(const std::string &filename)
 {
+	if (filename != m_filename)
+	{
+		m_contacts.clear();
+	}
+
 	m_filename  = filename;
 }
 
-double Contact::score(const Peptide& p, bool verbose) const
+bool Contact::load_data()
 {
-	
-	int i,j,total_len, **A;
+	if (m_contacts.loaded())
+	{
+		return true;
+	}
+
+	return m_contacts.read_map(m_filename);
+}
+
+const Restraint_List &Contact::contacts()
+{
+	load_data();
+	return m_contacts;
+}
+
+double Contact::score(const Peptide& p, bool verbose,
+	const Move_Range *range /*= NULL*/, const Topology *topology /*= NULL*/,
+	const Residue_Geometry *geometry /*= NULL*/)
+{
+	int n,m,k;
 	int len = p.length();
 	double dist, total=0.0;
-	FILE *input_file; 
-	
-	input_file = fopen(m_filename.c_str(),"r");
-	if (input_file == NULL)
+
+	if (!load_data())
 	{
 		std::cerr << "Predicted Contacts File not found!\n";
 		return 0.0;
 	}
 
-	fscanf(input_file,"%d",&total_len);
+	int num_con = m_contacts.size();
+
+	if (topology == NULL)
+	{
+		m_topology.update(p);
+		topology = &m_topology;
+	}
+
+	if (geometry == NULL)
+	{
+		m_geometry.build(p, *topology);
+		geometry = &m_geometry;
+	}
 
-	A=(int **)malloc(sizeof(int *) * total_len);	
-	for(i=0;i<total_len;i++)
-		A[i]=(int *)malloc(sizeof(int) * total_len);
+	// if possible, reuse the values for contacts whose residues were not
+	// moved relative to each other
+	bool reuse = m_con_score.begin(p.start(), p.end(), num_con, range);
 
-	for(i=0; i < total_len ; i++)
-		for(j=0; j < total_len ; j++)
-			fscanf(input_file,"%d",&A[i][j]);
+	for (k = 0;k < num_con;k++)
+	{
+		n = m_contacts.res1(k);
+		m = m_contacts.res2(k);
 
-	for (i = p.start();i <= p.end();i++)
-		for (j = p.start();j <= p.end() ;j++)
+		if (n > p.end() || m < p.start())
 		{
-			if (i >= total_len || j>= total_len)
-				break;	
-			if (p.atom_exists(i, Atom_CB) && p.atom_exists(j, Atom_CB))
-			{	
-				Point cb_i = p.atom_pos(i, Atom_CB);
-				Point cb_j = p.atom_pos(j, Atom_CB);
-				dist =  cb_i.distance(cb_j);
+			continue;
+		}
+
+		double &s = m_con_score[k];
 
-				if ( A[i][j] && dist > 8.0) /* They are contacts, but are far away in the model! */
-					total += dist - 1.0; 
+		if (!reuse || range->pair_changed(n, m))
+		{
+			s = 0.0;
+
+			// (only residues other than glycine have a CB atom)
+			if (topology->cb_ca(n) == Atom_CB &&
+				topology->cb_ca(m) == Atom_CB)
+			{
+				dist = geometry->cb_ca(n).distance(geometry->cb_ca(m));
+
+				/* They are contacts, but are far away in the model! */
+				/* (the map is not necessarily symmetric, so the */
+				/* contact is counted once for each direction) */
+				if (dist > 8.0)
+				{
+					s = m_contacts.weight(k) * (dist - 1.0);
+				}
 
 				/* This would be useful when dealing with anti-contacts. A good idea would be to add this to a completely separate function. */
-				/*else						
+				/*else
 				{
-					if ( !A[i][j] && dist < 8.0 && dist > 1.0 && fabs(i-j) > 5) // They are anti-contacts, but are close together in the model! 
+					if ( !A[i][j] && dist < 8.0 && dist > 1.0 && fabs(i-j) > 5) // They are anti-contacts, but are close together in the model!
 						total += 1.0;
 				}*/
 			}
-		}	
+		}
+
+		total += s;
+	}
 
 #ifndef RAW_SCORE
 
@@ -99,11 +152,11 @@ double Contact::score(const Peptide& p, bool verbose) const
 	
 #endif // RAW_SCORE
 
-	fclose(input_file);
-	for(i=0;i<total_len;i++)
-		free(A[i]);
-	free(A);
 //	std::cout << "Total = " << total << " !!\n";	
 	return total;
 }
 
+void Contact::accept()
+{
+	m_con_score.accept();
+}
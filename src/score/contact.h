@@ -9,7 +9,15 @@
 #ifndef CONTACT_INCLUDED
 #define CONTACT_INCLUDED
 
+#include <string>
+#include <vector>
+#include "score_cache.h"
+#include "topology.h"
+#include "residue_geometry.h"
+#include "restraint_list.h"
+
 class Peptide;
+struct Move_Range;
 
 /**
  * 
@@ -28,15 +36,39 @@ public:
 	~Contact();
 
 	/* This method returns the random Score for the Peptide! */
-	double score(const Peptide& peptide, bool verbose = false) const;
+	/* (if range is not NULL, only the contacts affected by the move */
+	/* are recalculated; see Scorer::score_delta()) */
+	/* (if topology is not NULL, it must have been built for the peptide, */
+	/* and if geometry is not NULL, it must be up to date for the */
+	/* peptide's current conformation) */
+	double score(const Peptide& peptide, bool verbose = false,
+		const Move_Range *range = NULL, const Topology *topology = NULL,
+		const Residue_Geometry *geometry = NULL);
+
+	// the peptide last scored is now the current conformation
+	void accept();
 
 	// Set the name of the Contact Map data file
 	void set_short_data_file(const std::string &filename);
 	void set_long_data_file(const std::string &filename);
 
+	// the predicted contacts (none if the file could not be read)
+	const Restraint_List &contacts();
+
 	//
+private:
+	// read the contact map (returns false if the file does not exist)
+	bool load_data();
+
 private:
 	std::string m_filename;
+	Restraint_List m_contacts;		// pairs of residues in the contact map
+
+	// score for each contact
+	Score_Cache<double> m_con_score;
+
+	Topology m_topology;			// used if no topology is passed to score()
+	Residue_Geometry m_geometry;	// used if no geometry is passed to score()
 };
 
 #endif // CONTACT_INCLUDED
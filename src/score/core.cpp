@@ -7,6 +7,7 @@ CORE::CORE()
 {
 	m_short = new CORE_impl;
 	m_long  = new CORE_impl;
+	m_last = NULL;
 }
 
 CORE::~CORE()
@@ -35,15 +36,45 @@ void CORE::set_long_data_file_ori(const std::string &filename)
 	m_long->set_data_file_ori(filename);
 }
 
-double CORE::score(const Peptide &p, double weight1, double weight2, bool verbose, bool continuous)
+void CORE::set_kernel(Core_Pair_Kernel kernel)
+{
+	m_short->set_kernel(kernel);
+	m_long->set_kernel(kernel);
+}
+
+void CORE::set_precision(RAPDF_Precision precision)
+{
+	m_short->set_precision(precision);
+	m_long->set_precision(precision);
+}
+
+void CORE::set_thread_pool(Thread_Pool *pool)
+{
+	m_short->set_thread_pool(pool);
+	m_long->set_thread_pool(pool);
+}
+
+double CORE::score(const Peptide &p, double weight1, double weight2, bool verbose, bool continuous,
+	const Move_Range *range /*= NULL*/, Neighbour_Grid *grid /*= NULL*/,
+	const Topology *topology /*= NULL*/, Score_Limit *limit /*= NULL*/)
 {
 	if (p.length() <= SHORT_PEPTIDE || continuous)
 	{
-		return m_short->score(p,weight1,weight2,verbose,continuous);
+		m_last = m_short;
+		return m_short->score(p,weight1,weight2,verbose,continuous,range,grid,topology,limit);
 	}
 	else
 	{
-		return m_long->score(p,weight1,weight2,verbose);
+		m_last = m_long;
+		return m_long->score(p,weight1,weight2,verbose,false,range,grid,topology,limit);
+	}
+}
+
+void CORE::accept()
+{
+	if (m_last != NULL)
+	{
+		m_last->accept();
 	}
 }
 
@@ -3,6 +3,7 @@
 
 #include "core.h"
 #include "amino.h"
+#include "core_kernel.h"
 #include <string>
 #include <vector>
 #include <iostream>
@@ -15,6 +16,11 @@
 // forward declarations
 class Peptide;
 class CORE_impl;
+class Neighbour_Grid;
+class Topology;
+class Score_Limit;
+class Thread_Pool;
+struct Move_Range;
 
 class CORE
 {
@@ -26,7 +32,14 @@ public:
 	~CORE();
 
 	// score a peptide (low scores ate better)
-	double score(const Peptide &p, double weight1, double weight2, bool verbose = false, bool continuous = false);
+	// (see CORE_impl::score())
+	double score(const Peptide &p, double weight1, double weight2, bool verbose = false, bool continuous = false,
+		const Move_Range *range = NULL, Neighbour_Grid *grid = NULL,
+		const Topology *topology = NULL, Score_Limit *limit = NULL);
+
+	// the peptide last scored is now the current conformation
+	// (see Scorer::accept_last_scored())
+	void accept();
 
 	// set the name of the RAPDF data file
 	void set_short_data_file(const std::string &filename);
@@ -35,6 +48,16 @@ public:
 	void set_short_data_file_ori(const std::string &filename);
 	void set_long_data_file_ori(const std::string &filename);
 
+	// set the kernel used to calculate values for pairs of residues
+	// (see core_kernel.h)
+	void set_kernel(Core_Pair_Kernel kernel);
+
+	// set how the RAPDF values are stored (see rapdf_table.h)
+	void set_precision(RAPDF_Precision precision);
+
+	// use a pool of threads to score residue pairs (see CORE_impl)
+	void set_thread_pool(Thread_Pool *pool);
+
 private:
     // disable copy and assignment by making them private
 	CORE(const CORE&);
@@ -43,6 +66,7 @@ private:
 private:
 	CORE_impl *m_short;	// for short proteins
 	CORE_impl *m_long;	// for long proteins
+	CORE_impl *m_last;	// the one used for the last score() call
 };
 
 #endif // CORE_H_INCLUDED
@@ -3,6 +3,7 @@
 #include <cstdio>
 #include <cassert>
 #include <cmath>
+#include <algorithm>
 
 #include "peptide.h"
 #include "residue.h"
@@ -12,34 +13,39 @@
 #include "scorer_combined.h"
 #include "core.h"
 #include "core_impl.h"
+#include "move_range.h"
+#include "scorer.h"
+#include "thread_pool.h"
 
 
 #ifndef M_SQRT1_2
 #define M_SQRT1_2 0.70710678119
 #endif
 
+// does a CORE_impl tile job for each tile (see CORE_impl::score_tiles())
+class CORE_Tile_Task : public Thread_Task
+{
+public:
+	CORE_Tile_Task(CORE_impl *core) : m_core(core)
+	{ }
+
+	virtual void run(int k, int thread)
+	{ m_core->score_tile(k, thread); }
+
+private:
+	CORE_impl *m_core;
+};
+
 CORE_impl::CORE_impl()
-	: m_data_loaded(false)
+	: m_data_loaded(false), m_precision(RAPDF_Double),
+	  m_amino_class(Amino::Num, -1), m_pool(NULL), m_tile_job(Tile_Near),
+	  m_tile_grid(NULL), m_tile_res_start(0)
 {
-	m_data = NULL;
+	m_kernel = core_pair_kernel("auto");
 }
 
 CORE_impl::~CORE_impl()
 {
-	if (m_data != NULL)
-	{
-		for (int b1 = 0;b1 < NUM_RAPDF_IDS;b1++)
-		{
-			for (int b2 = 0;b2 <= b1;b2++)
-			{
-				delete [] m_data[b1][b2];
-			}
-
-			delete [] m_data[b1];
-		}
-
-		delete [] m_data;
-	}
 }
 
 CORE_impl::CORE_Params CORE_impl::m_lj[Num_Backbone][Num_Backbone];
@@ -192,6 +198,22 @@ void CORE_impl::set_data_file(const std::string &filename)
 	m_filename = filename;
 }
 
+void CORE_impl::set_kernel(Core_Pair_Kernel kernel)
+{
+	m_kernel = kernel;
+}
+
+void CORE_impl::set_precision(RAPDF_Precision precision)
+{
+	m_precision = precision;
+}
+
+void CORE_impl::set_thread_pool(Thread_Pool *pool)
+{
+	m_pool = pool;
+	m_thread_near.resize(pool == NULL ? 0 : pool->num_threads());
+}
+
 void CORE_impl::set_data_file_ori(const std::string &filename)
 {
 	m_filename_ori = filename;
@@ -210,477 +232,687 @@ void CORE_impl::load_data()
 		exit(1);
 	}
 
-//std::cout << "LOADING RAPDF DATA\n";
-
-	// exits with error message if file does not exist
-	C_File file(m_filename, "r", "RAPDF data file");
-
-	// std::cout << "Loading RAPDF data" << std::endl;
+	// Only the values for backbone atoms are needed, so the table
+	// only has ids for the RAPDF ids in m_rapdf_ids (which is changed
+	// to hold the table ids)
 
-	static const int Max_Len = 1000;
-	char buffer[Max_Len];
+	int ids[Amino::Full_Num][Atom_Undef];
+	int b1, b2;
 
-	if (!file.next_line(buffer, Max_Len) ||
-		sscanf(buffer, "%d %d", &m_first_bin, &m_top_bin) != 2)
+	for (b1 = 0;b1 < Amino::Full_Num;b1++)
 	{
-		std::cerr << "Error: expected RAPDF data file "
-			<< m_filename
-			<< " to start with two numbers (first bin, top bin)\n";
-		exit(1);
-	}
-
-	int b1, b2, d;
-
-	m_data = new double** [NUM_RAPDF_IDS];
-
-	for (b1 = 0;b1 < NUM_RAPDF_IDS;b1++)
-	{
-		m_data[b1] = new double* [NUM_RAPDF_IDS];
-
-		for (b2 = 0;b2 < NUM_RAPDF_IDS;b2++)
+		for (b2 = 0;b2 < Atom_Undef;b2++)
 		{
-			m_data[b1][b2] = new double[m_top_bin];
+			ids[b1][b2] = -1;
 		}
 	}
 
-	m_rapdf_ids = new int* [100];
-
-	for (b1 = 0;b1 < 100;b1++)
-		m_rapdf_ids[b1] = new int [NUM_RAPDF_IDS];
+	load_rapdf_ids(ids);
 
-	load_rapdf_ids();
+	std::vector<int> index(NUM_RAPDF_IDS, -1);
+	int num_ids = 0;
 
-	for (b1 = 0;b1 < NUM_RAPDF_IDS;b1++)
+	for (b1 = 0;b1 < Amino::Full_Num;b1++)
 	{
-		std::string b1_aa_str = Amino::rapdf_amino(b1).abbr();
-		std::string b1_a_str = Amino::rapdf_atom(b1).name();
-
-		for (b2 = 0;b2 <= b1;b2++)
+		for (b2 = 0;b2 < Num_Backbone;b2++)
 		{
-			std::string b2_aa_str = Amino::rapdf_amino(b2).abbr();
-			std::string b2_a_str = Amino::rapdf_atom(b2).name();
-
-			char aa1_str[100], a1_str[100];
-			char aa2_str[100], a2_str[100];
-
-			if (!file.next_line(buffer, Max_Len) ||
-				sscanf(buffer, "%s %s %s %s",
-				aa1_str, a1_str, aa2_str, a2_str) != 4 ||
-				std::string(aa1_str) != b1_aa_str ||
-				std::string(a1_str) != b1_a_str ||
-				std::string(aa2_str) != b2_aa_str ||
-				std::string(a2_str) != b2_a_str)
-			{
-				std::cerr << "Error on line " << file.line_num()
-					<< " of " << m_filename
-					<< ": expected \""
-					<< b1_aa_str << " " << b1_a_str << "  "
-					<< b2_aa_str << " " << b2_a_str << "\"\n";
-				exit(1);
-			}
-
-			int dist;
-			double val;
+			int id = ids[b1][b2];
 
-			for (d = m_first_bin;d < m_top_bin;d++)
+			if (id >= 0 && id < NUM_RAPDF_IDS)
 			{
-				if (!file.next_line(buffer, Max_Len) ||
-					sscanf(buffer, "%d %lf", &dist, &val) != 2 ||
-					dist != d)
+				if (index[id] == -1)
 				{
-					std::cerr << "Error on line " << file.line_num()
-						<< " of " << m_filename
-						<< ": expected \""
-						<< d
-						<< "\" followed by value\n";
-					exit(1);
+					index[id] = num_ids++;
 				}
 
-				m_data[b1][b2][d] = m_data[b2][b1][d] = val;
+				m_rapdf_ids[b1][b2] = index[id];
 			}
-			for( d = 0 ; d < m_first_bin; d++)
+			else
 			{
-				m_data[b1][b2][d]=m_data[b1][b2][m_first_bin];
-				m_data[b2][b1][d]=m_data[b2][b1][m_first_bin];
+				m_rapdf_ids[b1][b2] = -1;
 			}
 		}
 	}
 
-	if (file.next_line(buffer, Max_Len))
-	{
-		std::cerr << "Warning: ignoring extra data on line "
-			<< file.line_num()
-			<< " of "
-			<< m_filename
-			<< "\n";
-	}
+	// exits with error message if file is not valid
+	m_table.load(m_filename, m_precision, &index);
 
-	if (m_filename.empty())
-	{
-		std::cerr << "Error: Orientation data file undefined\n";
-		exit(1);
-	}
+	int top_bin = m_table.top_bin();
 
-	//std::cout << "LOADING ORIENTATION DATA\n";
-/*
-	// exits with error message if the file does not exist
-	C_File file_ori(m_filename_ori, "r", "Orientation data file");
+	// atoms at least this far apart have no LJ score, and the RAPDF
+	// value for distances of top_bin - 1 or more is the same as for
+	// the top bin
 
-	double val;
+	m_cutoff = top_bin - 1.0;
 
-	for (int a1 = 0;a1 < Amino::Num;a1++)
+	for (b1 = 0;b1 < Num_Backbone;b1++)
 	{
-		for (int a2 = a1;a2 < Amino::Num;a2++)
+		for (b2 = 0;b2 < Num_Backbone;b2++)
 		{
-			if (!file_ori.next_line(buffer, Max_Len) || std::string(buffer, 3) != Amino(a1).abbr() || std::string(buffer + 4, 3) != Amino(a2).abbr())
+			if (m_lj[b1][b2].max_dist > m_cutoff)
 			{
-				std::cerr << "Error: expected \"" << Amino(a1).abbr() << ' ' << Amino(a2).abbr() << "\" on line " << file_ori.line_num()
-					<< " of orientation data file " << m_filename_ori << "\n"; exit(1);
+				m_cutoff = m_lj[b1][b2].max_dist;
 			}
+		}
+	}
 
-			for (int angle = 0;angle < ORIENT_ANGLES;angle++)
-			{
-				for (int dist = 0;dist < ORIENT_DISTS;dist++)
-				{
-					int d;
+	m_kernel_data.rapdf = m_table.values();
+	m_kernel_data.precision = m_table.precision();
+	m_kernel_data.base = m_table.base();
+	m_kernel_data.scale = m_table.scale();
+	m_kernel_data.top_bin = top_bin;
 
-					if (!file_ori.next_line(buffer, Max_Len) || sscanf(buffer, "%d %lf", &d, &val) != 2 || d != dist + 3)
-					{
-						std::cerr << "Error: expected \"" << dist + 3 << "\" followed by value on line " << file_ori.line_num() << " of orientation data file "
-							<< m_filename_ori << "\n"; exit(1);
-					}
+	// (the same as Point::int_distance())
+	m_r2_bin.resize(top_bin * top_bin);
 
-//					std::cout << ": " << dist << " " << angle << " " << a1 << " " << a2 << " " << " = " << val << "\n";
+	for (b1 = 0, b2 = 0;b1 < top_bin * top_bin;b1++)
+	{
+		if (square(b2 + 1) == b1) { b2++; }
 
-					m_data_ori[dist][angle][a1][a2] = val;
-					m_data_ori[dist][angle][a2][a1] = val;
-				}
+		m_r2_bin[b1] = b2;
+	}
+
+	m_kernel_data.r2_bin = &m_r2_bin[0];
+	m_kernel_data.top_bin_sq = top_bin * top_bin;
+
+	m_lj_table.set_num_types(Num_Backbone);
+
+	for (b1 = 0;b1 < Core_Max_Atoms;b1++)
+	{
+		for (b2 = 0;b2 < Core_Max_Atoms;b2++)
+		{
+			bool used = (b1 < Num_Backbone && b2 < Num_Backbone);
+			m_kernel_data.c12[b1][b2] = (used ? m_lj[b1][b2].c12 : 0.0);
+			m_kernel_data.c6[b1][b2] = (used ? m_lj[b1][b2].c6 : 0.0);
+			m_kernel_data.max_dist[b1][b2] =
+				(used ? m_lj[b1][b2].max_dist : 0.0);
+
+			if (used)
+			{
+				m_lj_table.set(b1, b2, m_lj[b1][b2].c12, m_lj[b1][b2].c6,
+					m_lj[b1][b2].max_dist);
 			}
 		}
 	}
 
-	if (file.next_line(buffer, Max_Len))
-		std::cerr << "Warning: ignoring extra data on line " << file_ori.line_num() << " of orientation data file " << m_filename_ori << "\n";
-*/
+	m_lj_table.build();
+	m_kernel_data.lj_table = &m_lj_table;
+
+	if (m_kernel == core_pair_kernel("table"))
+	{
+		m_lj_table.report(std::cerr, "CORE");
+	}
+
+	if (m_filename.empty())
+	{
+		std::cerr << "Error: Orientation data file undefined\n";
+		exit(1);
+	}
 
 	m_data_loaded = true;
 }
 
 
-void CORE_impl::load_rapdf_ids()
+void CORE_impl::load_rapdf_ids(int ids[][Atom_Undef])
 {
 	// Cysteine
 	
-	m_rapdf_ids[4][Atom_N] = 0;	// 0
-	m_rapdf_ids[4][Atom_CA] = 1;
-	m_rapdf_ids[4][Atom_C] = 2;
-	m_rapdf_ids[4][Atom_O] = 3;
-	m_rapdf_ids[4][Atom_CB] = 4;
-	m_rapdf_ids[4][Atom_SG] = 5;
+	ids[4][Atom_N] = 0;	// 0
+	ids[4][Atom_CA] = 1;
+	ids[4][Atom_C] = 2;
+	ids[4][Atom_O] = 3;
+	ids[4][Atom_CB] = 4;
+	ids[4][Atom_SG] = 5;
 	
 	// Glutamine
 	
-	m_rapdf_ids[6][Atom_N] = 6;	// 6
-	m_rapdf_ids[6][Atom_CA] = 7;
-	m_rapdf_ids[6][Atom_C] = 8;
-	m_rapdf_ids[6][Atom_O] = 9;
-	m_rapdf_ids[6][Atom_CB] = 10;
-	m_rapdf_ids[6][Atom_CG] = 11;
-	m_rapdf_ids[6][Atom_CD] = 12;
-	m_rapdf_ids[6][Atom_OE1] = 13;
-	m_rapdf_ids[6][Atom_NE2] = 14;
+	ids[6][Atom_N] = 6;	// 6
+	ids[6][Atom_CA] = 7;
+	ids[6][Atom_C] = 8;
+	ids[6][Atom_O] = 9;
+	ids[6][Atom_CB] = 10;
+	ids[6][Atom_CG] = 11;
+	ids[6][Atom_CD] = 12;
+	ids[6][Atom_OE1] = 13;
+	ids[6][Atom_NE2] = 14;
 	
 	// Aspartic acid
 	
-	m_rapdf_ids[3][Atom_N] = 15;	// 15
-	m_rapdf_ids[3][Atom_CA] = 16;
-	m_rapdf_ids[3][Atom_C] = 17;
-	m_rapdf_ids[3][Atom_O] = 18;
-	m_rapdf_ids[3][Atom_CB] = 19;
-	m_rapdf_ids[3][Atom_CG] = 20;
-	m_rapdf_ids[3][Atom_OD1] = 21;
-	m_rapdf_ids[3][Atom_OD2] = 22;
+	ids[3][Atom_N] = 15;	// 15
+	ids[3][Atom_CA] = 16;
+	ids[3][Atom_C] = 17;
+	ids[3][Atom_O] = 18;
+	ids[3][Atom_CB] = 19;
+	ids[3][Atom_CG] = 20;
+	ids[3][Atom_OD1] = 21;
+	ids[3][Atom_OD2] = 22;
 	
 	// Serine
 	
-	m_rapdf_ids[15][Atom_N] = 23;	// 23
-	m_rapdf_ids[15][Atom_CA] = 24;
-	m_rapdf_ids[15][Atom_C] = 25;
-	m_rapdf_ids[15][Atom_O] = 26;
-	m_rapdf_ids[15][Atom_CB] = 27;
-	m_rapdf_ids[15][Atom_OG] = 28;
+	ids[15][Atom_N] = 23;	// 23
+	ids[15][Atom_CA] = 24;
+	ids[15][Atom_C] = 25;
+	ids[15][Atom_O] = 26;
+	ids[15][Atom_CB] = 27;
+	ids[15][Atom_OG] = 28;
 	
 	// Valine
 	
-	m_rapdf_ids[19][Atom_N] = 29;	// 29
-	m_rapdf_ids[19][Atom_CA] = 30;
-	m_rapdf_ids[19][Atom_C] = 31;
-	m_rapdf_ids[19][Atom_O] = 32;
-	m_rapdf_ids[19][Atom_CB] = 33;
-	m_rapdf_ids[19][Atom_CG1] = 34;
-	m_rapdf_ids[19][Atom_CG2] = 35;
+	ids[19][Atom_N] = 29;	// 29
+	ids[19][Atom_CA] = 30;
+	ids[19][Atom_C] = 31;
+	ids[19][Atom_O] = 32;
+	ids[19][Atom_CB] = 33;
+	ids[19][Atom_CG1] = 34;
+	ids[19][Atom_CG2] = 35;
 	
 	// Methionine
 	
-	m_rapdf_ids[12][Atom_N] = 36;	// 36
-	m_rapdf_ids[12][Atom_CA] = 37;
-	m_rapdf_ids[12][Atom_C] = 38;
-	m_rapdf_ids[12][Atom_O] = 39;
-	m_rapdf_ids[12][Atom_CB] = 40;
-	m_rapdf_ids[12][Atom_CG] = 41;
-	m_rapdf_ids[12][Atom_SD] = 42;
-	m_rapdf_ids[12][Atom_CE] = 43;
+	ids[12][Atom_N] = 36;	// 36
+	ids[12][Atom_CA] = 37;
+	ids[12][Atom_C] = 38;
+	ids[12][Atom_O] = 39;
+	ids[12][Atom_CB] = 40;
+	ids[12][Atom_CG] = 41;
+	ids[12][Atom_SD] = 42;
+	ids[12][Atom_CE] = 43;
 	
 	// Proline
 	
-	m_rapdf_ids[14][Atom_N] = 44;	// 44
-	m_rapdf_ids[14][Atom_CA] = 45;
-	m_rapdf_ids[14][Atom_C] = 46;
-	m_rapdf_ids[14][Atom_O] = 47;
-	m_rapdf_ids[14][Atom_CB] = 48;
-	m_rapdf_ids[14][Atom_CG] = 49;
-	m_rapdf_ids[14][Atom_CD] = 50;
+	ids[14][Atom_N] = 44;	// 44
+	ids[14][Atom_CA] = 45;
+	ids[14][Atom_C] = 46;
+	ids[14][Atom_O] = 47;
+	ids[14][Atom_CB] = 48;
+	ids[14][Atom_CG] = 49;
+	ids[14][Atom_CD] = 50;
 	
 	// Lysine
 	
-	m_rapdf_ids[11][Atom_N] = 51;	// 51
-	m_rapdf_ids[11][Atom_CA] = 52;
-	m_rapdf_ids[11][Atom_C] = 53;
-	m_rapdf_ids[11][Atom_O] = 54;
-	m_rapdf_ids[11][Atom_CB] = 55;
-	m_rapdf_ids[11][Atom_CG] = 56;
-	m_rapdf_ids[11][Atom_CD] = 57;
-	m_rapdf_ids[11][Atom_CE] = 58;
-	m_rapdf_ids[11][Atom_NZ] = 59;
+	ids[11][Atom_N] = 51;	// 51
+	ids[11][Atom_CA] = 52;
+	ids[11][Atom_C] = 53;
+	ids[11][Atom_O] = 54;
+	ids[11][Atom_CB] = 55;
+	ids[11][Atom_CG] = 56;
+	ids[11][Atom_CD] = 57;
+	ids[11][Atom_CE] = 58;
+	ids[11][Atom_NZ] = 59;
 	
 	// Threonine
 	
-	m_rapdf_ids[16][Atom_N] = 60;	// 60
-	m_rapdf_ids[16][Atom_CA] = 61;
-	m_rapdf_ids[16][Atom_C] = 62;
-	m_rapdf_ids[16][Atom_O] = 63;
-	m_rapdf_ids[16][Atom_CB] = 64;
-	m_rapdf_ids[16][Atom_OG1] = 65;
-	m_rapdf_ids[16][Atom_CG2] = 66;
+	ids[16][Atom_N] = 60;	// 60
+	ids[16][Atom_CA] = 61;
+	ids[16][Atom_C] = 62;
+	ids[16][Atom_O] = 63;
+	ids[16][Atom_CB] = 64;
+	ids[16][Atom_OG1] = 65;
+	ids[16][Atom_CG2] = 66;
 	
 	// Phenylalanine
 	
-	m_rapdf_ids[13][Atom_N] = 67;	// 67
-	m_rapdf_ids[13][Atom_CA] = 68;
-	m_rapdf_ids[13][Atom_C] = 69;
-	m_rapdf_ids[13][Atom_O] = 70;
-	m_rapdf_ids[13][Atom_CB] = 71;
-	m_rapdf_ids[13][Atom_CG] = 72;
-	m_rapdf_ids[13][Atom_CD1] = 73;
-	m_rapdf_ids[13][Atom_CD2] = 74;
-	m_rapdf_ids[13][Atom_CE1] = 75;
-	m_rapdf_ids[13][Atom_CE2] = 76;
-	m_rapdf_ids[13][Atom_CZ] = 77;
+	ids[13][Atom_N] = 67;	// 67
+	ids[13][Atom_CA] = 68;
+	ids[13][Atom_C] = 69;
+	ids[13][Atom_O] = 70;
+	ids[13][Atom_CB] = 71;
+	ids[13][Atom_CG] = 72;
+	ids[13][Atom_CD1] = 73;
+	ids[13][Atom_CD2] = 74;
+	ids[13][Atom_CE1] = 75;
+	ids[13][Atom_CE2] = 76;
+	ids[13][Atom_CZ] = 77;
 	
 	// Alanine
 	
-	m_rapdf_ids[0][Atom_N] = 78;	// 78
-	m_rapdf_ids[0][Atom_CA] = 79;
-	m_rapdf_ids[0][Atom_C] = 80;
-	m_rapdf_ids[0][Atom_O] = 81;
-	m_rapdf_ids[0][Atom_CB] = 82;
+	ids[0][Atom_N] = 78;	// 78
+	ids[0][Atom_CA] = 79;
+	ids[0][Atom_C] = 80;
+	ids[0][Atom_O] = 81;
+	ids[0][Atom_CB] = 82;
 	
       // Histidine
         
-      m_rapdf_ids[8][Atom_N] = 83;        // 83
-      m_rapdf_ids[8][Atom_CA] = 84;
-      m_rapdf_ids[8][Atom_C] = 85;
-      m_rapdf_ids[8][Atom_O] = 86;
-      m_rapdf_ids[8][Atom_CB] = 87;
-      m_rapdf_ids[8][Atom_CG] = 88;
-      m_rapdf_ids[8][Atom_ND1] = 89;
-      m_rapdf_ids[8][Atom_CD2] = 90;
-      m_rapdf_ids[8][Atom_CE1] = 91;
-      m_rapdf_ids[8][Atom_NE2] = 92;
+      ids[8][Atom_N] = 83;        // 83
+      ids[8][Atom_CA] = 84;
+      ids[8][Atom_C] = 85;
+      ids[8][Atom_O] = 86;
+      ids[8][Atom_CB] = 87;
+      ids[8][Atom_CG] = 88;
+      ids[8][Atom_ND1] = 89;
+      ids[8][Atom_CD2] = 90;
+      ids[8][Atom_CE1] = 91;
+      ids[8][Atom_NE2] = 92;
 
 
 	// Glycine
 	
-	m_rapdf_ids[7][Atom_N] = 93;	// 93
-	m_rapdf_ids[7][Atom_CA] = 94;
-	m_rapdf_ids[7][Atom_C] = 95;
-	m_rapdf_ids[7][Atom_O] = 96;
+	ids[7][Atom_N] = 93;	// 93
+	ids[7][Atom_CA] = 94;
+	ids[7][Atom_C] = 95;
+	ids[7][Atom_O] = 96;
 	
 	// Isoleucine
 	
-	m_rapdf_ids[9][Atom_N] = 97;	// 97
-	m_rapdf_ids[9][Atom_CA] = 98;
-	m_rapdf_ids[9][Atom_C] = 99;
-	m_rapdf_ids[9][Atom_O] = 100;
-	m_rapdf_ids[9][Atom_CB] = 101;
-	m_rapdf_ids[9][Atom_CG1] = 102;
-	m_rapdf_ids[9][Atom_CG2] = 103;
-	m_rapdf_ids[9][Atom_CD1] = 104;
+	ids[9][Atom_N] = 97;	// 97
+	ids[9][Atom_CA] = 98;
+	ids[9][Atom_C] = 99;
+	ids[9][Atom_O] = 100;
+	ids[9][Atom_CB] = 101;
+	ids[9][Atom_CG1] = 102;
+	ids[9][Atom_CG2] = 103;
+	ids[9][Atom_CD1] = 104;
 	
 	// Glutamic acid
 	
-	m_rapdf_ids[5][Atom_N] = 105;	// 105
-	m_rapdf_ids[5][Atom_CA] = 106;
-	m_rapdf_ids[5][Atom_C] = 107;
-	m_rapdf_ids[5][Atom_O] = 108;
-	m_rapdf_ids[5][Atom_CB] = 109;
-	m_rapdf_ids[5][Atom_CG] = 110;
-	m_rapdf_ids[5][Atom_CD] = 111;
-	m_rapdf_ids[5][Atom_OE1] = 112;
-	m_rapdf_ids[5][Atom_OE2] = 113;
+	ids[5][Atom_N] = 105;	// 105
+	ids[5][Atom_CA] = 106;
+	ids[5][Atom_C] = 107;
+	ids[5][Atom_O] = 108;
+	ids[5][Atom_CB] = 109;
+	ids[5][Atom_CG] = 110;
+	ids[5][Atom_CD] = 111;
+	ids[5][Atom_OE1] = 112;
+	ids[5][Atom_OE2] = 113;
 	
 	// Leucine
 	
-	m_rapdf_ids[10][Atom_N] = 114;	// 114
-	m_rapdf_ids[10][Atom_CA] = 115;
-	m_rapdf_ids[10][Atom_C] = 116;
-	m_rapdf_ids[10][Atom_O] = 117;
-	m_rapdf_ids[10][Atom_CB] = 118;
-	m_rapdf_ids[10][Atom_CG] = 119;
-	m_rapdf_ids[10][Atom_CD1] = 120;
-	m_rapdf_ids[10][Atom_CD2] = 121;
+	ids[10][Atom_N] = 114;	// 114
+	ids[10][Atom_CA] = 115;
+	ids[10][Atom_C] = 116;
+	ids[10][Atom_O] = 117;
+	ids[10][Atom_CB] = 118;
+	ids[10][Atom_CG] = 119;
+	ids[10][Atom_CD1] = 120;
+	ids[10][Atom_CD2] = 121;
 	
 	// Arginine
 	
-	m_rapdf_ids[1][Atom_N] = 122;	// 122
-	m_rapdf_ids[1][Atom_CA] = 123;
-	m_rapdf_ids[1][Atom_C] = 124;
-	m_rapdf_ids[1][Atom_O] = 125;
-	m_rapdf_ids[1][Atom_CB] = 126;
-	m_rapdf_ids[1][Atom_CG] = 127;
-	m_rapdf_ids[1][Atom_CD] = 128;
-	m_rapdf_ids[1][Atom_NE] = 129;
-	m_rapdf_ids[1][Atom_CZ] = 130;
-	m_rapdf_ids[1][Atom_NH1] = 131;
-	m_rapdf_ids[1][Atom_NH2] = 132;
+	ids[1][Atom_N] = 122;	// 122
+	ids[1][Atom_CA] = 123;
+	ids[1][Atom_C] = 124;
+	ids[1][Atom_O] = 125;
+	ids[1][Atom_CB] = 126;
+	ids[1][Atom_CG] = 127;
+	ids[1][Atom_CD] = 128;
+	ids[1][Atom_NE] = 129;
+	ids[1][Atom_CZ] = 130;
+	ids[1][Atom_NH1] = 131;
+	ids[1][Atom_NH2] = 132;
 	
 	// Tryptophan
 	
-	m_rapdf_ids[17][Atom_N] = 133;	// 133
-	m_rapdf_ids[17][Atom_CA] = 134;
-	m_rapdf_ids[17][Atom_C] = 135;
-	m_rapdf_ids[17][Atom_O] = 136;
-	m_rapdf_ids[17][Atom_CB] = 137;
-	m_rapdf_ids[17][Atom_CG] = 138;
-	m_rapdf_ids[17][Atom_CD1] = 139;
-	m_rapdf_ids[17][Atom_CD2] = 140;
-	m_rapdf_ids[17][Atom_NE1] = 141;
-	m_rapdf_ids[17][Atom_CE2] = 142;
-	m_rapdf_ids[17][Atom_CE3] = 143;
-	m_rapdf_ids[17][Atom_CZ2] = 144;
-	m_rapdf_ids[17][Atom_CZ3] = 145;
-	m_rapdf_ids[17][Atom_CH2] = 146;
+	ids[17][Atom_N] = 133;	// 133
+	ids[17][Atom_CA] = 134;
+	ids[17][Atom_C] = 135;
+	ids[17][Atom_O] = 136;
+	ids[17][Atom_CB] = 137;
+	ids[17][Atom_CG] = 138;
+	ids[17][Atom_CD1] = 139;
+	ids[17][Atom_CD2] = 140;
+	ids[17][Atom_NE1] = 141;
+	ids[17][Atom_CE2] = 142;
+	ids[17][Atom_CE3] = 143;
+	ids[17][Atom_CZ2] = 144;
+	ids[17][Atom_CZ3] = 145;
+	ids[17][Atom_CH2] = 146;
 	
 	// Asparagine
 	
-	m_rapdf_ids[2][Atom_N] = 147;	// 147
-	m_rapdf_ids[2][Atom_CA] = 148;
-	m_rapdf_ids[2][Atom_C] = 149;
-	m_rapdf_ids[2][Atom_O] = 150;
-	m_rapdf_ids[2][Atom_CB] = 151;
-	m_rapdf_ids[2][Atom_CG] = 152;
-	m_rapdf_ids[2][Atom_OD1] = 153;
-	m_rapdf_ids[2][Atom_ND2] = 154;
+	ids[2][Atom_N] = 147;	// 147
+	ids[2][Atom_CA] = 148;
+	ids[2][Atom_C] = 149;
+	ids[2][Atom_O] = 150;
+	ids[2][Atom_CB] = 151;
+	ids[2][Atom_CG] = 152;
+	ids[2][Atom_OD1] = 153;
+	ids[2][Atom_ND2] = 154;
 	
 	// Tyrosine
 	
-	m_rapdf_ids[18][Atom_N] = 155;	// 155
-	m_rapdf_ids[18][Atom_CA] = 156;
-	m_rapdf_ids[18][Atom_C] = 157;
-	m_rapdf_ids[18][Atom_O] = 158;
-	m_rapdf_ids[18][Atom_CB] = 159;
-	m_rapdf_ids[18][Atom_CG] = 160;
-	m_rapdf_ids[18][Atom_CD1] = 161;
-	m_rapdf_ids[18][Atom_CD2] = 162;
-	m_rapdf_ids[18][Atom_CE1] = 163;
-	m_rapdf_ids[18][Atom_CE2] = 164;
-	m_rapdf_ids[18][Atom_CZ] = 165;
-	m_rapdf_ids[18][Atom_OH] = 166;
+	ids[18][Atom_N] = 155;	// 155
+	ids[18][Atom_CA] = 156;
+	ids[18][Atom_C] = 157;
+	ids[18][Atom_O] = 158;
+	ids[18][Atom_CB] = 159;
+	ids[18][Atom_CG] = 160;
+	ids[18][Atom_CD1] = 161;
+	ids[18][Atom_CD2] = 162;
+	ids[18][Atom_CE1] = 163;
+	ids[18][Atom_CE2] = 164;
+	ids[18][Atom_CZ] = 165;
+	ids[18][Atom_OH] = 166;
 
 	// end marker
 
-	m_rapdf_ids[26][Atom_C] = 167;	// 167
+	ids[26][Atom_C] = 167;	// 167
 }
 
-double CORE_impl::score(const Peptide &p,double w_LJ, double w_RAPDF, bool verbose, bool continuous)
+void CORE_impl::set_atoms(const Peptide &p, const Topology *topology, int n)
 {
-	// (does nothing if already loaded)
-	load_data();
+	Core_Atoms &atoms = m_atoms[n];
+	int aa = topology->amino(n);
+	int first = topology->first_atom(n);
+	int end = topology->end_backbone(n);
+	int i = 0;
+
+	for (int a = first;a < end;a++)
+	{
+		assert(i < Core_Max_Atoms);
+		Atom_Id t = topology->atom_type(a);
+		int id = m_rapdf_ids[aa][t];
+		assert(id != -1);
+		const Point &pos = p.m_conf.m_backbone[n * Num_Backbone + t];
+
+		atoms.x[i] = pos.x;
+		atoms.y[i] = pos.y;
+		atoms.z[i] = pos.z;
+		atoms.id[i] = id;
+		atoms.row[i] = m_table.row_offset(id);
+		atoms.col[i] = m_table.col_offset(id);
+		atoms.lj[i] = t;
+		i++;
+	}
+
+	atoms.num = i;
+
+	// (the kernels may read the padding)
+	for ( ;i < Core_Max_Atoms;i++)
+	{
+		atoms.x[i] = atoms.y[i] = atoms.z[i] = 0.0;
+		atoms.id[i] = atoms.row[i] = atoms.col[i] = atoms.lj[i] = 0;
+	}
+}
+
+void CORE_impl::score_residue_pair(int n1, int n2, Pair_Score *s)
+{
+	const Core_Atoms &r1 = m_atoms[n1];
+	const Core_Atoms &r2 = m_atoms[n2];
 
+	double rapdf[Core_Max_Atoms * Core_Max_Atoms];
+	double lj[Core_Max_Atoms * Core_Max_Atoms];
+
+	m_kernel(m_kernel_data, r1, r2, rapdf, lj);
+
+	// (always added up in the same order, whichever kernel is used)
 	double total_RAPDF = 0.0;
-	double total_LJ = 0.0, d6;
-	double d_dist;//, frac, weight;
-	int n1,n2,a1,a2;
-	int id_1,id_2;
-//	int dist, other_bin;
+	double total_LJ = 0.0;
+
+	for (int i1 = 0;i1 < r1.num;i1++)
+	{
+		for (int i2 = 0;i2 < r2.num;i2++)
+		{
+			total_RAPDF += rapdf[i1 * Core_Max_Atoms + i2];
+			total_LJ += lj[i1 * Core_Max_Atoms + i2];
+		}
+	}
+
+	s->rapdf = total_RAPDF;
+	s->lj = total_LJ;
+}
+
+int CORE_impl::residue_class(const Topology *topology, int n)
+{
+	int aa = topology->amino(n);
+	int end = topology->end_backbone(n);
 
-	Atom_Id t1,t2;
-	Point pos1, pos2;
+	// (the same atoms as in set_atoms())
+	std::vector<int> ids;
 
-	for (n1 = p.start() + 2;n1 <= p.end();n1++)
+	for (int a = topology->first_atom(n);a < end;a++)
 	{
-		const Residue &res1 = p.res(n1);
+		ids.push_back(m_rapdf_ids[aa][topology->atom_type(a)]);
+	}
+
+	// (only needed for a new class)
+	std::vector<int> atoms;
+
+	// usually the same as the last residue with this amino acid
+
+	int c = m_amino_class[aa];
 
-		for (a1 = 0;a1 < res1.num_atoms();a1++)
+	if (c != -1 && m_class_ids[c] == ids)
+	{
+		return c;
+	}
+
+	for (c = 0;c < (int) m_class_ids.size();c++)
+	{
+		if (m_class_ids[c] == ids)
 		{
-			if (!p.atom_exists(n1, (Atom_Id) a1)) continue;
+			m_amino_class[aa] = c;
+			return c;
+		}
+	}
 
-			t1 = res1.m_atom[a1].m_type.m_type;
-//			if (t1 == Atom_Undef)				continue;
+	// add a new class, and calculate the far_rapdf() and min_pair_score()
+	// values for it
 
-			id_1 = m_rapdf_ids[res1.m_amino.m_val][t1]; //res1.amino().rapdf_id(t1);
-			pos1 = p.m_conf.m_backbone[n1 * Num_Backbone + t1];//atom_pos(n1, t1);
-			
-			for (n2 = p.start();n2 < n1 - 1; n2++)
-			{
-				const Residue &res2 = p.res(n2);
+	for (int a = topology->first_atom(n);a < end;a++)
+	{
+		atoms.push_back(topology->atom_type(a));
+	}
+
+	int num = (int) m_class_ids.size();
+	m_class_ids.push_back(ids);
+	m_class_atoms.push_back(atoms);
+	m_class_tail.resize(num + 1);
+	m_class_min.resize(num + 1);
 
-				for (a2 = 0;a2 < res2.num_atoms();a2++)
+	for (c = 0;c <= num;c++)
+	{
+		m_class_tail[c].resize(num + 1);
+		m_class_min[c].resize(num + 1);
+	}
+
+	for (c = 0;c <= num;c++)
+	{
+		for (int dir = 0;dir < 2;dir++)
+		{
+			const std::vector<int> &ids1 = m_class_ids[dir ? c : num];
+			const std::vector<int> &ids2 = m_class_ids[dir ? num : c];
+			double total = 0.0;
+
+			for (size_t i1 = 0;i1 < ids1.size();i1++)
+			{
+				for (size_t i2 = 0;i2 < ids2.size();i2++)
 				{
-					if (!p.atom_exists(n2, (Atom_Id) a2)) continue;
-					t2 = res2.m_atom[a2].m_type.m_type;
-//					if (t2 == Atom_Undef)	continue;
+					total += m_table.value(ids1[i1], ids2[i2],
+						m_table.top_bin() - 1);
+				}
+			}
 
-					id_2 = m_rapdf_ids[res2.m_amino.m_val][t2];   // res2.amino().rapdf_id(t2);	
-					pos2 = p.m_conf.m_backbone[n2 * Num_Backbone + t2]; // pos2(n2, t2);
+			m_class_tail[dir ? c : num][dir ? num : c] = total;
 
-					const CORE_Params &lj = m_lj[a1][a2];
-//					p2 = p.atom_pos2(n2, (Atom_Id) a2);
+			// the lowest RAPDF value in any distance bin, and the lowest
+			// LJ value (-epsilon, at the bottom of the well) for each
+			// pair of atoms
+			const std::vector<int> &atoms1 = m_class_atoms[dir ? c : num];
+			const std::vector<int> &atoms2 = m_class_atoms[dir ? num : c];
+			Pair_Score low;
+			low.rapdf = low.lj = 0.0;
 
-					d_dist = pos1.distance(pos2);
+			for (size_t i1 = 0;i1 < ids1.size();i1++)
+			{
+				for (size_t i2 = 0;i2 < ids2.size();i2++)
+				{
+					double v = m_table.value(ids1[i1], ids2[i2], 0);
+
+					for (int d = 1;d < m_table.top_bin();d++)
+					{
+						double v2 = m_table.value(ids1[i1], ids2[i2], d);
+						if (v2 < v) { v = v2; }
+					}
 
-					/* RAPDF Potential */
-					if ( m_top_bin - d_dist > 0 )
+					low.rapdf += v;
+
+					// (only backbone atoms have LJ values)
+					if (atoms1[i1] < Num_Backbone && atoms2[i2] < Num_Backbone)
 					{
-//						dist = (int) d_dist;
-//						frac = d_dist - (double) dist;
-//						weight=fabs(frac-0.5);
-//						other_bin = (frac > 0.5 ? dist + 1 : dist - 1);
-//						if (other_bin < m_first_bin || other_bin >= m_top_bin)
-						total_RAPDF += m_data[id_1][id_2][(int)d_dist];
-//						else
-//							total_RAPDF += (m_data[id_1][id_2][dist] * 0.5 + m_data[id_1][id_2][other_bin] * weight) / (weight+0.5); 
+						const CORE_Params &lj = m_lj[atoms1[i1]][atoms2[i2]];
+						low.lj -= square(lj.c6) / (4.0 * lj.c12);
 					}
-					else
-						total_RAPDF += m_data[id_1][id_2][m_top_bin - 1];
+				}
+			}
+
+			m_class_min[dir ? c : num][dir ? num : c] = low;
+		}
+	}
+
+	m_amino_class[aa] = num;
+	return num;
+}
+
+double CORE_impl::score(const Peptide &p,double w_LJ, double w_RAPDF, bool verbose, bool continuous, const Move_Range *range,
+	Neighbour_Grid *grid, const Topology *topology, Score_Limit *limit)
+{
+	// (does nothing if already loaded)
+	load_data();
+
+	double total_RAPDF = 0.0;
+	double total_LJ = 0.0;
+	int n1,n2;
+
+	if (grid == NULL)
+	{
+		m_grid.build(p);
+		grid = &m_grid;
+	}
+
+	if (topology == NULL)
+	{
+		m_topology.update(p);
+		topology = &m_topology;
+	}
+
+	m_res_class.resize(p.full_length());
+	m_atoms.resize(p.full_length());
+
+	for (n1 = p.start();n1 <= p.end();n1++)
+	{
+		m_res_class[n1] = residue_class(topology, n1);
+		set_atoms(p, topology, n1);
+	}
+
+	if (range == NULL)
+	{
+		// Only residue pairs that are near each other need to be
+		// calculated. The RAPDF values for all of the other pairs are
+		// constant, so the total is found by adding up the values for
+		// all pairs (using the number of residues in each class) and
+		// subtracting the values for the pairs that are near each other.
+		//
+		// The terms are added in a different order from the all-pairs
+		// loop, so the total can differ from it in the last bits. Fixed
+		// seed folds were checked against the all-pairs version: the
+		// candidate scores differ by at most about 1e-12 (relative) and
+		// no acceptance decision changes.
+
+		m_pair_score.clear();
+
+		int num_classes = (int) m_class_ids.size();
+		std::vector<int> class_count(num_classes, 0);
+		double far_total = 0.0;
+		Pair_Score s;
+
+		// (before the threads start, so that they only read the grid)
+		grid->use_cutoff(m_cutoff);
+
+		for (n1 = p.start() + 2;n1 <= p.end();n1++)
+		{
+			// (residues start .. n1 - 2 have been counted)
+			class_count[m_res_class[n1 - 2]]++;
+
+			const std::vector<double> &tail = m_class_tail[m_res_class[n1]];
+
+			for (int c = 0;c < num_classes;c++)
+			{
+				if (class_count[c] != 0)
+				{
+					far_total += tail[c] * class_count[c];
+				}
+			}
 
-					/* Lennard-Jones Potential */
-					if (fabs(pos1.x - pos2.x) < lj.max_dist && fabs(pos1.y - pos2.y) < lj.max_dist && fabs(pos1.z - pos2.z) < lj.max_dist )
+			// (with a thread pool, the near pairs are done below)
+			if (m_pool != NULL)
+			{
+				continue;
+			}
+
+			grid->find_near(n1, m_cutoff, n1 - 1, &m_near);
+
+			for (size_t i = 0;i < m_near.size();i++)
+			{
+				n2 = m_near[i];
+				score_residue_pair(n1, n2, &s);
+
+				total_RAPDF += s.rapdf -
+					far_rapdf(m_res_class[n1], m_res_class[n2]);
+				total_LJ += s.lj;
+			}
+		}
+
+		if (m_pool != NULL)
+		{
+			s = score_tiles(Tile_Near, p, grid);
+			total_RAPDF += s.rapdf;
+			total_LJ += s.lj;
+		}
+
+		total_RAPDF += far_total;
+	}
+	else
+	{
+		// if possible, reuse the values for residue pairs that were not
+		// affected by the move
+		bool reuse = m_pair_score.begin(p.start(), p.end(),
+			num_residue_pairs(p.end() + 1), range);
+
+		// (if the values are reused, the changed ones are recalculated
+		// first, so that this can stop early if the limit is reached)
+		if (reuse && !score_changed_pairs(p, range, grid, w_LJ, w_RAPDF,
+			continuous, limit))
+		{
+			return HUGE_VAL;
+		}
+
+		if (m_pool != NULL)
+		{
+			Pair_Score s = score_tiles((reuse ? Tile_Sum : Tile_All), p,
+				grid);
+			total_RAPDF = s.rapdf;
+			total_LJ = s.lj;
+		}
+		else
+		{
+			for (n1 = p.start() + 2;n1 <= p.end();n1++)
+			{
+				for (n2 = p.start();n2 < n1 - 1; n2++)
+				{
+					Pair_Score &s = m_pair_score[residue_pair_index(n1, n2)];
+
+					if (!reuse)
 					{
-						if (d_dist < lj.max_dist)
+						if (grid->may_be_near(n1, n2, m_cutoff))
+						{
+							score_residue_pair(n1, n2, &s);
+						}
+						else
 						{
-							if (d_dist < 1.0)
-								total_LJ += lj.c12 - lj.c6;
-							else
-							{
-								d6 = square(d_dist * d_dist * d_dist);
-								total_LJ += (lj.c12 / square(d6)) - (lj.c6 / d6);
-							}
+							s.rapdf = far_rapdf(m_res_class[n1], m_res_class[n2]);
+							s.lj = 0.0;
 						}
 					}
+
+					total_RAPDF += s.rapdf;
+					total_LJ += s.lj;
 				}
 			}
 		}
+
+		// (the starting point for score_changed_pairs() if accepted)
+		m_trial_total.rapdf = total_RAPDF;
+		m_trial_total.lj = total_LJ;
 	}
 
 #ifndef RAW_SCORE
@@ -707,3 +939,284 @@ double CORE_impl::score(const Peptide &p,double w_LJ, double w_RAPDF, bool verbo
 	return w_LJ*total_LJ +w_RAPDF*total_RAPDF;
 }
 
+void CORE_impl::accept()
+{
+	m_pair_score.accept();
+	m_curr_total = m_trial_total;
+}
+
+bool CORE_impl::score_changed_pairs(const Peptide &p, const Move_Range *range,
+	const Neighbour_Grid *grid, double w_LJ, double w_RAPDF, bool continuous,
+	Score_Limit *limit)
+{
+	// Lower bound on the totals: the current totals, with the value for
+	// each changed pair replaced by its new value if it is known, or by
+	// min_pair_score() if it still needs to be calculated
+
+	Pair_Score bound = m_curr_total;
+	int n1, n2;
+
+	m_changed.clear();
+
+	// (the pairs for which range->pair_changed() is true)
+	for (n1 = std::max(range->first, p.start() + 2);n1 <= p.end();n1++)
+	{
+		int last = std::min(range->last, n1 - 2);
+
+		for (n2 = p.start();n2 <= last;n2++)
+		{
+			Pair_Score &s = m_pair_score[residue_pair_index(n1, n2)];
+			int c1 = m_res_class[n1];
+			int c2 = m_res_class[n2];
+
+			bound.rapdf -= s.rapdf;
+			bound.lj -= s.lj;
+
+			if (grid->may_be_near(n1, n2, m_cutoff))
+			{
+				m_changed.push_back(n1);
+				m_changed.push_back(n2);
+				bound.rapdf += min_pair_score(c1, c2).rapdf;
+				bound.lj += min_pair_score(c1, c2).lj;
+			}
+			else
+			{
+				s.rapdf = far_rapdf(c1, c2);
+				s.lj = 0.0;
+				bound.rapdf += s.rapdf;
+			}
+		}
+	}
+
+	// (the bound only applies to the weighted total if neither weight
+	// is negative)
+	if (limit != NULL && (w_LJ < 0.0 || w_RAPDF < 0.0))
+	{
+		limit = NULL;
+	}
+
+	// the same normalisation as at the end of score()
+	double lj_factor = w_LJ;
+	double rapdf_factor = w_RAPDF;
+
+#ifndef RAW_SCORE
+	int len = p.length();
+	lj_factor *= 350.0 / (len + 200.0);
+
+	if (len <= SHORT_PEPTIDE || continuous)
+	{
+		rapdf_factor *= 7.0 / len;
+	}
+	else
+	{
+		rapdf_factor *= 0.75 / sqrt((double) len);
+	}
+#endif // RAW_SCORE
+
+	double t = (limit == NULL ? HUGE_VAL : limit->threshold(-HUGE_VAL));
+
+	// (with a thread pool, the pairs before this in m_changed have
+	// already been calculated)
+	size_t calculated = 0;
+
+	for (size_t i = 0;i < m_changed.size();i += 2)
+	{
+		n1 = m_changed[i];
+		n2 = m_changed[i + 1];
+
+		Pair_Score &s = m_pair_score[residue_pair_index(n1, n2)];
+
+		if (m_pool == NULL)
+		{
+			score_residue_pair(n1, n2, &s);
+		}
+		else
+		if (i == calculated)
+		{
+			// (all of them at once if scoring cannot stop early)
+			int num = (int) m_changed.size() / 2;
+			int first = (int) i / 2;
+			int end = (limit == NULL ? num :
+				std::min(num, first + Changed_Batch_Pairs));
+
+			score_changed_tiles(first, end);
+			calculated = end * 2;
+		}
+
+		if (limit != NULL)
+		{
+			const Pair_Score &low = min_pair_score(m_res_class[n1],
+				m_res_class[n2]);
+
+			bound.rapdf += s.rapdf - low.rapdf;
+			bound.lj += s.lj - low.lj;
+
+			// (slightly lower, to allow for rounding)
+			double min_score = rapdf_factor * bound.rapdf +
+				lj_factor * bound.lj;
+			min_score -= 1e-9 * (1.0 + fabs(min_score));
+
+			if (min_score > t)
+			{
+				t = limit->threshold(min_score);
+
+				if (min_score > t)
+				{
+					return false;
+				}
+			}
+		}
+	}
+
+	return true;
+}
+
+CORE_impl::Pair_Score CORE_impl::score_tiles(Tile_Job job, const Peptide &p,
+	const Neighbour_Grid *grid)
+{
+	// rows n1 = start + 2 .. end, with about Tile_Pairs pairs in each
+	// tile (row n1 has n1 - start - 1 pairs)
+	int start = p.start();
+	int pairs = 0;
+
+	m_tile_start.clear();
+
+	for (int n1 = start + 2;n1 <= p.end();n1++)
+	{
+		if (pairs == 0)
+		{
+			m_tile_start.push_back(n1);
+		}
+
+		pairs += n1 - start - 1;
+
+		if (pairs >= Tile_Pairs)
+		{
+			pairs = 0;
+		}
+	}
+
+	m_tile_start.push_back(p.end() + 1);
+
+	int num_tiles = (int) m_tile_start.size() - 1;
+	m_tile_job = job;
+	m_tile_grid = grid;
+	m_tile_res_start = start;
+	m_tile_total.resize(num_tiles);
+
+	CORE_Tile_Task task(this);
+	m_pool->run(&task, num_tiles);
+
+	// (always in the same order)
+	Pair_Score total;
+	total.rapdf = total.lj = 0.0;
+
+	for (int k = 0;k < num_tiles;k++)
+	{
+		total.rapdf += m_tile_total[k].rapdf;
+		total.lj += m_tile_total[k].lj;
+	}
+
+	return total;
+}
+
+void CORE_impl::score_changed_tiles(int first, int end)
+{
+	m_tile_start.clear();
+
+	for (int i = first;i < end;i += Changed_Tile_Pairs)
+	{
+		m_tile_start.push_back(i);
+	}
+
+	m_tile_start.push_back(end);
+
+	int num_tiles = (int) m_tile_start.size() - 1;
+	m_tile_job = Tile_Changed;
+	m_tile_total.resize(num_tiles);
+
+	CORE_Tile_Task task(this);
+	m_pool->run(&task, num_tiles);
+}
+
+void CORE_impl::score_tile(int k, int thread)
+{
+	Pair_Score total;
+	total.rapdf = total.lj = 0.0;
+
+	int first = m_tile_start[k];
+	int end = m_tile_start[k + 1];
+	Pair_Score s;
+
+	switch (m_tile_job)
+	{
+		case Tile_Near:
+		{
+			// (the same as the loop in score() with no thread pool)
+			std::vector<int> &near = m_thread_near[thread];
+
+			for (int n1 = first;n1 < end;n1++)
+			{
+				m_tile_grid->find_near(n1, m_cutoff, n1 - 1, &near);
+
+				for (size_t i = 0;i < near.size();i++)
+				{
+					int n2 = near[i];
+					score_residue_pair(n1, n2, &s);
+
+					total.rapdf += s.rapdf -
+						far_rapdf(m_res_class[n1], m_res_class[n2]);
+					total.lj += s.lj;
+				}
+			}
+
+			break;
+		}
+
+		case Tile_All:
+		case Tile_Sum:
+		{
+			for (int n1 = first;n1 < end;n1++)
+			{
+				for (int n2 = m_tile_res_start;n2 < n1 - 1;n2++)
+				{
+					Pair_Score &v = m_pair_score[residue_pair_index(n1, n2)];
+
+					if (m_tile_job == Tile_All)
+					{
+						if (m_tile_grid->may_be_near(n1, n2, m_cutoff))
+						{
+							score_residue_pair(n1, n2, &v);
+						}
+						else
+						{
+							v.rapdf = far_rapdf(m_res_class[n1],
+								m_res_class[n2]);
+							v.lj = 0.0;
+						}
+					}
+
+					total.rapdf += v.rapdf;
+					total.lj += v.lj;
+				}
+			}
+
+			break;
+		}
+
+		case Tile_Changed:
+		{
+			for (int i = first;i < end;i++)
+			{
+				int n1 = m_changed[i * 2];
+				int n2 = m_changed[i * 2 + 1];
+				score_residue_pair(n1, n2,
+					&m_pair_score[residue_pair_index(n1, n2)]);
+			}
+
+			break;
+		}
+	}
+
+	m_tile_total[k] = total;
+}
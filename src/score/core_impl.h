@@ -3,6 +3,12 @@
 
 #include "core.h"
 #include "amino.h"
+#include "score_cache.h"
+#include "neighbour_grid.h"
+#include "topology.h"
+#include "core_kernel.h"
+#include "rapdf_table.h"
+#include "atom_id.h"
 #include <string>
 #include <vector>
 #include <iostream>
@@ -10,24 +16,56 @@
 class Peptide;
 class Residue;
 class Atom;
+class Score_Limit;
+class Thread_Pool;
+struct Move_Range;
 
 class CORE_impl
 {
 	friend class CORE_Static_Init;
+	friend class CORE_Tile_Task;
 public:
 	// constructor
 	CORE_impl();
 	// destructor
 	~CORE_impl();
 
-	// score a peptide (low scores are better)
-	double score(const Peptide& peptide,double w_LJ, double w_RAPDF, bool verbose = false, bool continuous = false);
+	// score a peptide (low scores are better). If range is not NULL, the
+	// peptide differs from the conformation last passed to accept() only
+	// as described by range, and only the affected residue pairs are
+	// recalculated. If grid is not NULL, it must have been built for the
+	// peptide's current conformation, and if topology is not NULL, it must
+	// have been built for the peptide.
+	//
+	// If limit is not NULL (and range is not NULL), scoring stops as soon
+	// as the limit shows that the peptide will be rejected, and HUGE_VAL is
+	// returned. (A lower bound on the value of each residue pair that still
+	// needs to be calculated is used to find out when this is.)
+	double score(const Peptide& peptide,double w_LJ, double w_RAPDF, bool verbose = false, bool continuous = false,
+		const Move_Range *range = NULL, Neighbour_Grid *grid = NULL,
+		const Topology *topology = NULL, Score_Limit *limit = NULL);
+
+	// the peptide last scored is now the current conformation
+	void accept();
 	
 	// set the name of the data file for RAPDF
 	void set_data_file(const std::string &filename);
 	// set the name of the data file for Orientation
 	void set_data_file_ori(const std::string &filename);
 
+	// set the kernel used to calculate values for pairs of residues
+	void set_kernel(Core_Pair_Kernel kernel);
+
+	// set how the RAPDF values are stored (before the first score)
+	void set_precision(RAPDF_Precision precision);
+
+	// Score the residue pairs in tiles, shared between the threads in
+	// pool (or in the old order, one pair at a time, if pool is NULL).
+	// The tiles only depend on the peptide, and their totals are added
+	// up in order, so the scores are the same for any number of threads
+	// (but may differ very slightly from the ones with no pool).
+	void set_thread_pool(Thread_Pool *pool);
+
 private:
     // disable copy and assignment by making them private
 	CORE_impl(const CORE_impl&);
@@ -35,7 +73,9 @@ private:
 
 	// read data file (if it has not already been read)
 	void load_data();
-	void load_rapdf_ids();
+	// get the RAPDF id of each atom type of each amino acid
+	// (ids[amino][atom], for the atoms that have one)
+	void load_rapdf_ids(int ids[][Atom_Undef]);
 
 protected:
 	struct CORE_Params
@@ -50,19 +90,130 @@ protected:
 		CORE_Params(double c12_val, double c6_val);
 	};
 
+	// RAPDF and LJ totals for one pair of residues
+	struct Pair_Score
+	{
+		double rapdf;
+		double lj;
+	};
+
+	// copy the atoms of residue n into m_atoms[n]
+	void set_atoms(const Peptide &p, const Topology *topology, int n);
+
+	// calculate the RAPDF and LJ totals for residues n1 and n2
+	// (set_atoms() must have been called for both residues)
+	void score_residue_pair(int n1, int n2, Pair_Score *s);
+
+	// recalculate the values in m_pair_score for the residue pairs changed
+	// by a move (the other values must be the current ones). Returns false
+	// if it stopped early because of the limit (see score()).
+	bool score_changed_pairs(const Peptide &p, const Move_Range *range,
+		const Neighbour_Grid *grid, double w_LJ, double w_RAPDF,
+		bool continuous, Score_Limit *limit);
+
+	// What score_tile() does with each tile: add up the values of the
+	// near residue pairs (without storing them), calculate and store the
+	// values of every pair, add up the stored values, or calculate the
+	// pairs in m_changed.
+	enum Tile_Job { Tile_Near, Tile_All, Tile_Sum, Tile_Changed };
+
+	// number of residue pairs in each tile of rows (roughly), and in each
+	// tile of m_changed
+	static const int Tile_Pairs = 4096;
+	static const int Changed_Tile_Pairs = 64;
+
+	// while score_changed_pairs() can stop early, the pairs in m_changed
+	// are calculated this many at a time
+	static const int Changed_Batch_Pairs = 1024;
+
+	// do job for every residue pair (n1, n2) of p with n1 > n2 + 1, in
+	// tiles of rows (see set_thread_pool()), and return the total of
+	// the tile totals
+	Pair_Score score_tiles(Tile_Job job, const Peptide &p,
+		const Neighbour_Grid *grid);
+
+	// calculate pairs first .. end - 1 in m_changed (counting each pair
+	// of numbers as one) in tiles
+	void score_changed_tiles(int first, int end);
+
+	// do the current job for tile k (on thread number thread)
+	void score_tile(int k, int thread);
+
+	// Residues are divided into classes with the same list of RAPDF atom
+	// ids (normally one class per amino acid). Two residues that are
+	// further apart than m_cutoff have no LJ score, and their RAPDF total
+	// only depends on their classes (every atom pair is in the top bin).
+
+	// get the class of residue n (creating a new class if necessary)
+	int residue_class(const Topology *topology, int n);
+
+	// RAPDF total for two residues in the given classes that are too far
+	// apart to interact (the same value that score_residue_pair() would
+	// calculate)
+	double far_rapdf(int c1, int c2) const
+	{ return m_class_tail[c1][c2]; }
+
+	// lower bounds on the RAPDF and LJ totals for two residues in the given
+	// classes, at any distance apart
+	const Pair_Score &min_pair_score(int c1, int c2) const
+	{ return m_class_min[c1][c2]; }
+
 	std::string m_filename;		// data file for RAPDF
 	std::string m_filename_ori;	// data file for Orientation
 	bool m_data_loaded;			// whether data has been read
+	RAPDF_Precision m_precision;// how m_table stores the values
+
+	double m_cutoff;			// maximum distance between atoms that
+								// have an LJ score or a RAPDF value below
+								// the top bin
 
-	int m_first_bin;			// lowest distance bin
-	int m_top_bin;				// highest index + 1 of m_bin[n1][n2][*]
+	RAPDF_Table m_table;		// RAPDF values for backbone atoms
+	std::vector<int> m_r2_bin;	// distance bin of each squared distance
+	LJ_Table m_lj_table;		// LJ values (for the "table" kernel)
 
-	// (dimensions: [NUM_RAPDF_IDS][NUM_RAPDF_IDS][RAPDF_TOP_BIN])
-	double m_data_ori[ORIENT_DISTS][ORIENT_ANGLES][Amino::Num][Amino::Num];
-	double ***m_data;
-	int **m_rapdf_ids;
+	// m_table id of each backbone atom of each amino acid
+	int m_rapdf_ids[Amino::Full_Num][Num_Backbone];
 
 	static CORE_Params m_lj[Num_Backbone][Num_Backbone];
+
+	// totals for each pair of residues (indexed by residue_pair_index())
+	Score_Cache<Pair_Score> m_pair_score;
+
+	// sum of the values in m_pair_score for the last peptide scored and
+	// for the current conformation
+	Pair_Score m_trial_total;
+	Pair_Score m_curr_total;
+
+	// residue pairs (n1, n2) that score_changed_pairs() needs to calculate
+	std::vector<int> m_changed;
+
+	// residue classes (see residue_class())
+	std::vector< std::vector<int> > m_class_ids;	// RAPDF ids of each class
+	std::vector< std::vector<int> > m_class_atoms;	// atom of each RAPDF id
+	std::vector< std::vector<double> > m_class_tail;// far_rapdf() values
+	std::vector< std::vector<Pair_Score> > m_class_min;// min_pair_score()
+	std::vector<int> m_amino_class;	// last class found for each amino acid
+
+	std::vector<int> m_res_class;	// class of each residue (while scoring)
+	std::vector<int> m_near;		// residues near the current one
+
+	Core_Pair_Kernel m_kernel;		// calculates values for residue pairs
+	Core_Kernel_Data m_kernel_data;
+	std::vector<Core_Atoms> m_atoms;// atoms of each residue (while scoring)
+	Neighbour_Grid m_grid;			// used if no grid is passed to score()
+	Topology m_topology;			// used if no topology is passed to score()
+
+	// threads used to score the tiles (NULL to score one pair at a time)
+	Thread_Pool *m_pool;
+
+	// the current score_tiles() job
+	Tile_Job m_tile_job;
+	const Neighbour_Grid *m_tile_grid;
+	int m_tile_res_start;				// first residue of the peptide
+	std::vector<int> m_tile_start;		// first row (or pair) of each
+										// tile, then the end of the last
+	std::vector<Pair_Score> m_tile_total;// total for each tile
+	std::vector< std::vector<int> > m_thread_near;	// m_near for each thread
 };
 
 #endif // CORE_IMPL_H_INCLUDED
@@ -0,0 +1,453 @@
+#include <cmath>
+#include "common.h"
+#include "core_kernel.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define CORE_KERNEL_X86
+#include <immintrin.h>
+
+// (some versions of gcc give spurious warnings about the undefined
+// initial values that the intrinsics use)
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#endif
+
+// The vector versions must not let the compiler combine a multiply and
+// an add into a single fused multiply-add instruction, since that would
+// round differently from the plain version.
+#ifdef CORE_KERNEL_X86
+#define CORE_KERNEL_NO_FMA __attribute__((optimize("fp-contract=off")))
+#endif
+
+namespace
+{
+
+// get a RAPDF value from the table (see RAPDF_Table::value())
+
+inline double core_value(const Core_Kernel_Data &k, const double *table,
+	int n)
+{
+	return table[n];
+}
+
+inline double core_value(const Core_Kernel_Data &k, const float *table,
+	int n)
+{
+	return table[n];
+}
+
+inline double core_value(const Core_Kernel_Data &k, const short *table,
+	int n)
+{
+	return k.base + k.scale * table[n];
+}
+
+template <class T>
+void core_pair_scalar(const Core_Kernel_Data &k, const Core_Atoms &r1,
+	const Core_Atoms &r2, double *rapdf, double *lj)
+{
+	const T *table = (const T *) k.rapdf;
+
+	for (int i1 = 0;i1 < r1.num;i1++)
+	{
+		const double *c12 = k.c12[r1.lj[i1]];
+		const double *c6 = k.c6[r1.lj[i1]];
+		const double *max_dist = k.max_dist[r1.lj[i1]];
+		double *rapdf_row = rapdf + i1 * Core_Max_Atoms;
+		double *lj_row = lj + i1 * Core_Max_Atoms;
+
+		for (int i2 = 0;i2 < r2.num;i2++)
+		{
+			double dx = r1.x[i1] - r2.x[i2];
+			double dy = r1.y[i1] - r2.y[i2];
+			double dz = r1.z[i1] - r2.z[i2];
+			double d = sqrt(square(dx) + square(dy) + square(dz));
+
+			int offset = (r1.id[i1] >= r2.id[i2] ?
+				r1.row[i1] + r2.col[i2] : r2.row[i2] + r1.col[i1]);
+
+			if (k.top_bin - d > 0)
+			{
+				rapdf_row[i2] = core_value(k, table, offset + (int) d);
+			}
+			else
+			{
+				rapdf_row[i2] = core_value(k, table, offset + k.top_bin - 1);
+			}
+
+			int a2 = r2.lj[i2];
+			double val = 0.0;
+
+			if (fabs(dx) < max_dist[a2] && fabs(dy) < max_dist[a2] &&
+				fabs(dz) < max_dist[a2] && d < max_dist[a2])
+			{
+				if (d < 1.0)
+				{
+					val = c12[a2] - c6[a2];
+				}
+				else
+				{
+					double d6 = square(d * d * d);
+					val = (c12[a2] / square(d6)) - (c6[a2] / d6);
+				}
+			}
+
+			lj_row[i2] = val;
+		}
+	}
+}
+
+void core_pair_scalar(const Core_Kernel_Data &k, const Core_Atoms &r1,
+	const Core_Atoms &r2, double *rapdf, double *lj)
+{
+	switch (k.precision)
+	{
+		case RAPDF_Float:
+			core_pair_scalar<float>(k, r1, r2, rapdf, lj);
+			break;
+		case RAPDF_Int16:
+			core_pair_scalar<short>(k, r1, r2, rapdf, lj);
+			break;
+		default:
+			core_pair_scalar<double>(k, r1, r2, rapdf, lj);
+			break;
+	}
+}
+
+template <class T>
+void core_pair_table(const Core_Kernel_Data &k, const Core_Atoms &r1,
+	const Core_Atoms &r2, double *rapdf, double *lj)
+{
+	const T *table = (const T *) k.rapdf;
+
+	for (int i1 = 0;i1 < r1.num;i1++)
+	{
+		double *rapdf_row = rapdf + i1 * Core_Max_Atoms;
+		double *lj_row = lj + i1 * Core_Max_Atoms;
+
+		for (int i2 = 0;i2 < r2.num;i2++)
+		{
+			double d2 = square(r1.x[i1] - r2.x[i2]) +
+				square(r1.y[i1] - r2.y[i2]) + square(r1.z[i1] - r2.z[i2]);
+
+			int offset = (r1.id[i1] >= r2.id[i2] ?
+				r1.row[i1] + r2.col[i2] : r2.row[i2] + r1.col[i1]);
+
+			if (d2 < k.top_bin_sq)
+			{
+				rapdf_row[i2] = core_value(k, table,
+					offset + k.r2_bin[(int) d2]);
+			}
+			else
+			{
+				rapdf_row[i2] = core_value(k, table, offset + k.top_bin - 1);
+			}
+
+			lj_row[i2] = k.lj_table->value(r1.lj[i1], r2.lj[i2], d2);
+		}
+	}
+}
+
+void core_pair_table(const Core_Kernel_Data &k, const Core_Atoms &r1,
+	const Core_Atoms &r2, double *rapdf, double *lj)
+{
+	switch (k.precision)
+	{
+		case RAPDF_Float:
+			core_pair_table<float>(k, r1, r2, rapdf, lj);
+			break;
+		case RAPDF_Int16:
+			core_pair_table<short>(k, r1, r2, rapdf, lj);
+			break;
+		default:
+			core_pair_table<double>(k, r1, r2, rapdf, lj);
+			break;
+	}
+}
+
+#ifdef CORE_KERNEL_X86
+
+// get 4 RAPDF values from the table
+// (the int16 values are read as the low halves of 32 bit integers)
+
+__attribute__((target("avx2"))) CORE_KERNEL_NO_FMA
+inline __m256d core_gather4(const Core_Kernel_Data &k, const double *table,
+	__m128i n)
+{
+	return _mm256_i32gather_pd(table, n, 8);
+}
+
+__attribute__((target("avx2"))) CORE_KERNEL_NO_FMA
+inline __m256d core_gather4(const Core_Kernel_Data &k, const float *table,
+	__m128i n)
+{
+	return _mm256_cvtps_pd(_mm_i32gather_ps(table, n, 4));
+}
+
+__attribute__((target("avx2"))) CORE_KERNEL_NO_FMA
+inline __m256d core_gather4(const Core_Kernel_Data &k, const short *table,
+	__m128i n)
+{
+	__m128i x = _mm_i32gather_epi32((const int *) table, n, 2);
+	x = _mm_srai_epi32(_mm_slli_epi32(x, 16), 16);
+
+	return _mm256_add_pd(_mm256_set1_pd(k.base),
+		_mm256_mul_pd(_mm256_set1_pd(k.scale), _mm256_cvtepi32_pd(x)));
+}
+
+template <class T>
+__attribute__((target("avx2"))) CORE_KERNEL_NO_FMA
+void core_pair_avx2(const Core_Kernel_Data &k, const Core_Atoms &r1,
+	const Core_Atoms &r2, double *rapdf, double *lj)
+{
+	const T *table = (const T *) k.rapdf;
+	const __m256d top = _mm256_set1_pd(k.top_bin - 1.0);
+	const __m256d one = _mm256_set1_pd(1.0);
+	const __m256d sign = _mm256_set1_pd(-0.0);
+
+	for (int i1 = 0;i1 < r1.num;i1++)
+	{
+		const double *c12_row = k.c12[r1.lj[i1]];
+		const double *c6_row = k.c6[r1.lj[i1]];
+		const double *max_dist_row = k.max_dist[r1.lj[i1]];
+		__m256d x1 = _mm256_set1_pd(r1.x[i1]);
+		__m256d y1 = _mm256_set1_pd(r1.y[i1]);
+		__m256d z1 = _mm256_set1_pd(r1.z[i1]);
+		__m128i id1 = _mm_set1_epi32(r1.id[i1]);
+		__m128i row1 = _mm_set1_epi32(r1.row[i1]);
+		__m128i col1 = _mm_set1_epi32(r1.col[i1]);
+
+		for (int i2 = 0;i2 < r2.num;i2 += 4)
+		{
+			__m256d dx = _mm256_sub_pd(x1, _mm256_loadu_pd(r2.x + i2));
+			__m256d dy = _mm256_sub_pd(y1, _mm256_loadu_pd(r2.y + i2));
+			__m256d dz = _mm256_sub_pd(z1, _mm256_loadu_pd(r2.z + i2));
+			__m256d d = _mm256_sqrt_pd(_mm256_add_pd(_mm256_add_pd(
+				_mm256_mul_pd(dx, dx), _mm256_mul_pd(dy, dy)),
+				_mm256_mul_pd(dz, dz)));
+
+			// RAPDF: distances of top_bin - 1 or more (or NaN) use the
+			// top bin
+			__m128i id2 = _mm_loadu_si128((const __m128i *) (r2.id + i2));
+			__m128i row2 = _mm_loadu_si128((const __m128i *) (r2.row + i2));
+			__m128i col2 = _mm_loadu_si128((const __m128i *) (r2.col + i2));
+			__m128i offset = _mm_blendv_epi8(_mm_add_epi32(row1, col2),
+				_mm_add_epi32(row2, col1), _mm_cmplt_epi32(id1, id2));
+
+			__m128i bin = _mm256_cvttpd_epi32(_mm256_min_pd(d, top));
+			_mm256_storeu_pd(rapdf + i1 * Core_Max_Atoms + i2,
+				core_gather4(k, table, _mm_add_epi32(offset, bin)));
+
+			// Lennard-Jones
+			__m128i a2 = _mm_loadu_si128((const __m128i *) (r2.lj + i2));
+			__m256d c12 = _mm256_i32gather_pd(c12_row, a2, 8);
+			__m256d c6 = _mm256_i32gather_pd(c6_row, a2, 8);
+			__m256d max_dist = _mm256_i32gather_pd(max_dist_row, a2, 8);
+
+			__m256d near = _mm256_and_pd(
+				_mm256_and_pd(
+					_mm256_cmp_pd(_mm256_andnot_pd(sign, dx), max_dist,
+						_CMP_LT_OQ),
+					_mm256_cmp_pd(_mm256_andnot_pd(sign, dy), max_dist,
+						_CMP_LT_OQ)),
+				_mm256_and_pd(
+					_mm256_cmp_pd(_mm256_andnot_pd(sign, dz), max_dist,
+						_CMP_LT_OQ),
+					_mm256_cmp_pd(d, max_dist, _CMP_LT_OQ)));
+
+			__m256d d3 = _mm256_mul_pd(_mm256_mul_pd(d, d), d);
+			__m256d d6 = _mm256_mul_pd(d3, d3);
+			__m256d val = _mm256_sub_pd(
+				_mm256_div_pd(c12, _mm256_mul_pd(d6, d6)),
+				_mm256_div_pd(c6, d6));
+
+			val = _mm256_blendv_pd(val, _mm256_sub_pd(c12, c6),
+				_mm256_cmp_pd(d, one, _CMP_LT_OQ));
+
+			_mm256_storeu_pd(lj + i1 * Core_Max_Atoms + i2,
+				_mm256_and_pd(val, near));
+		}
+	}
+}
+
+__attribute__((target("avx2"))) CORE_KERNEL_NO_FMA
+void core_pair_avx2(const Core_Kernel_Data &k, const Core_Atoms &r1,
+	const Core_Atoms &r2, double *rapdf, double *lj)
+{
+	switch (k.precision)
+	{
+		case RAPDF_Float:
+			core_pair_avx2<float>(k, r1, r2, rapdf, lj);
+			break;
+		case RAPDF_Int16:
+			core_pair_avx2<short>(k, r1, r2, rapdf, lj);
+			break;
+		default:
+			core_pair_avx2<double>(k, r1, r2, rapdf, lj);
+			break;
+	}
+}
+
+// get 8 RAPDF values from the table
+
+__attribute__((target("avx512f"))) CORE_KERNEL_NO_FMA
+inline __m512d core_gather8(const Core_Kernel_Data &k, const double *table,
+	__m256i n)
+{
+	return _mm512_i32gather_pd(n, table, 8);
+}
+
+__attribute__((target("avx512f"))) CORE_KERNEL_NO_FMA
+inline __m512d core_gather8(const Core_Kernel_Data &k, const float *table,
+	__m256i n)
+{
+	return _mm512_cvtps_pd(_mm256_i32gather_ps(table, n, 4));
+}
+
+__attribute__((target("avx512f"))) CORE_KERNEL_NO_FMA
+inline __m512d core_gather8(const Core_Kernel_Data &k, const short *table,
+	__m256i n)
+{
+	__m256i x = _mm256_i32gather_epi32((const int *) table, n, 2);
+	x = _mm256_srai_epi32(_mm256_slli_epi32(x, 16), 16);
+
+	return _mm512_add_pd(_mm512_set1_pd(k.base),
+		_mm512_mul_pd(_mm512_set1_pd(k.scale), _mm512_cvtepi32_pd(x)));
+}
+
+template <class T>
+__attribute__((target("avx512f"))) CORE_KERNEL_NO_FMA
+void core_pair_avx512(const Core_Kernel_Data &k, const Core_Atoms &r1,
+	const Core_Atoms &r2, double *rapdf, double *lj)
+{
+	const T *table = (const T *) k.rapdf;
+	const __m512d top = _mm512_set1_pd(k.top_bin - 1.0);
+	const __m512d one = _mm512_set1_pd(1.0);
+
+	// (Core_Max_Atoms == 8, so all atoms of r2 fit in one vector)
+	__m512d x2 = _mm512_loadu_pd(r2.x);
+	__m512d y2 = _mm512_loadu_pd(r2.y);
+	__m512d z2 = _mm512_loadu_pd(r2.z);
+	__m256i id2 = _mm256_loadu_si256((const __m256i *) r2.id);
+	__m256i row2 = _mm256_loadu_si256((const __m256i *) r2.row);
+	__m256i col2 = _mm256_loadu_si256((const __m256i *) r2.col);
+	__m256i a2 = _mm256_loadu_si256((const __m256i *) r2.lj);
+
+	for (int i1 = 0;i1 < r1.num;i1++)
+	{
+		__m512d dx = _mm512_sub_pd(_mm512_set1_pd(r1.x[i1]), x2);
+		__m512d dy = _mm512_sub_pd(_mm512_set1_pd(r1.y[i1]), y2);
+		__m512d dz = _mm512_sub_pd(_mm512_set1_pd(r1.z[i1]), z2);
+		__m512d d = _mm512_sqrt_pd(_mm512_add_pd(_mm512_add_pd(
+			_mm512_mul_pd(dx, dx), _mm512_mul_pd(dy, dy)),
+			_mm512_mul_pd(dz, dz)));
+
+		// RAPDF
+		__m256i offset = _mm256_blendv_epi8(
+			_mm256_add_epi32(_mm256_set1_epi32(r1.row[i1]), col2),
+			_mm256_add_epi32(row2, _mm256_set1_epi32(r1.col[i1])),
+			_mm256_cmpgt_epi32(id2, _mm256_set1_epi32(r1.id[i1])));
+
+		__m256i bin = _mm512_cvttpd_epi32(_mm512_min_pd(d, top));
+		_mm512_storeu_pd(rapdf + i1 * Core_Max_Atoms,
+			core_gather8(k, table, _mm256_add_epi32(offset, bin)));
+
+		// Lennard-Jones
+		int a1 = r1.lj[i1];
+		__m512d c12 = _mm512_i32gather_pd(a2, k.c12[a1], 8);
+		__m512d c6 = _mm512_i32gather_pd(a2, k.c6[a1], 8);
+		__m512d max_dist = _mm512_i32gather_pd(a2, k.max_dist[a1], 8);
+
+		__mmask8 near =
+			_mm512_cmp_pd_mask(_mm512_abs_pd(dx), max_dist, _CMP_LT_OQ) &
+			_mm512_cmp_pd_mask(_mm512_abs_pd(dy), max_dist, _CMP_LT_OQ) &
+			_mm512_cmp_pd_mask(_mm512_abs_pd(dz), max_dist, _CMP_LT_OQ) &
+			_mm512_cmp_pd_mask(d, max_dist, _CMP_LT_OQ);
+
+		__m512d d3 = _mm512_mul_pd(_mm512_mul_pd(d, d), d);
+		__m512d d6 = _mm512_mul_pd(d3, d3);
+		__m512d val = _mm512_sub_pd(
+			_mm512_div_pd(c12, _mm512_mul_pd(d6, d6)),
+			_mm512_div_pd(c6, d6));
+
+		val = _mm512_mask_blend_pd(_mm512_cmp_pd_mask(d, one, _CMP_LT_OQ),
+			val, _mm512_sub_pd(c12, c6));
+
+		_mm512_storeu_pd(lj + i1 * Core_Max_Atoms,
+			_mm512_maskz_mov_pd(near, val));
+	}
+}
+
+__attribute__((target("avx512f"))) CORE_KERNEL_NO_FMA
+void core_pair_avx512(const Core_Kernel_Data &k, const Core_Atoms &r1,
+	const Core_Atoms &r2, double *rapdf, double *lj)
+{
+	switch (k.precision)
+	{
+		case RAPDF_Float:
+			core_pair_avx512<float>(k, r1, r2, rapdf, lj);
+			break;
+		case RAPDF_Int16:
+			core_pair_avx512<short>(k, r1, r2, rapdf, lj);
+			break;
+		default:
+			core_pair_avx512<double>(k, r1, r2, rapdf, lj);
+			break;
+	}
+}
+
+#endif // CORE_KERNEL_X86
+
+} // namespace
+
+const char *core_pair_kernel_auto_name()
+{
+#ifdef CORE_KERNEL_X86
+	__builtin_cpu_init();
+
+	if (__builtin_cpu_supports("avx512f"))
+	{
+		return "avx512";
+	}
+
+	if (__builtin_cpu_supports("avx2"))
+	{
+		return "avx2";
+	}
+#endif
+
+	return "scalar";
+}
+
+Core_Pair_Kernel core_pair_kernel(const std::string &name)
+{
+	if (name == "auto")
+	{
+		return core_pair_kernel(core_pair_kernel_auto_name());
+	}
+
+	if (name == "scalar")
+	{
+		return core_pair_scalar;
+	}
+
+	if (name == "table")
+	{
+		return core_pair_table;
+	}
+
+#ifdef CORE_KERNEL_X86
+	__builtin_cpu_init();
+
+	if (name == "avx2" && __builtin_cpu_supports("avx2"))
+	{
+		return core_pair_avx2;
+	}
+
+	if (name == "avx512" && __builtin_cpu_supports("avx512f"))
+	{
+		return core_pair_avx512;
+	}
+#endif
+
+	return NULL;
+}
@@ -0,0 +1,94 @@
+#ifndef CORE_KERNEL_H_INCLUDED
+#define CORE_KERNEL_H_INCLUDED
+
+// Kernels that calculate the CORE (RAPDF and Lennard-Jones) values for
+// every pair of atoms in two residues.
+//
+// There is a plain C++ version and (on x86 processors) versions that
+// use AVX2 or AVX-512 instructions to handle 4 or 8 atoms of the second
+// residue at once. The vector versions are compiled into every binary,
+// and core_pair_kernel() chooses one that the processor running the
+// program supports.
+//
+// Every version does exactly the same floating point operations for
+// each pair of atoms, and the values are returned separately (rather
+// than added up by the kernel), so the caller can add them up in a
+// fixed order. So the scores do not depend on which version is used.
+//
+// The RAPDF values are read directly from a RAPDF_Table, in whichever
+// precision it stores them.
+//
+// The "table" version avoids square roots and divisions: it finds the
+// RAPDF distance bin from the squared distance, and the LJ value from an
+// LJ_Table. Its RAPDF values are the same as the other versions', but its
+// LJ values differ slightly (see LJ_Table).
+
+#include <string>
+#include "rapdf_table.h"
+#include "lj_table.h"
+
+// maximum number of atoms per residue (backbone atoms only, rounded up
+// to the size of the largest vector)
+const int Core_Max_Atoms = 8;
+
+// the atoms of one residue, in "structure of arrays" form so that
+// consecutive atoms can be loaded into a vector register
+// (entries from num to Core_Max_Atoms - 1 are padding)
+struct Core_Atoms
+{
+	int num;								// number of atoms
+	double x[Core_Max_Atoms];				// position
+	double y[Core_Max_Atoms];
+	double z[Core_Max_Atoms];
+	int id[Core_Max_Atoms];					// RAPDF table id
+	int row[Core_Max_Atoms];				// RAPDF_Table::row_offset(id)
+	int col[Core_Max_Atoms];				// RAPDF_Table::col_offset(id)
+	int lj[Core_Max_Atoms];					// atom number (for LJ values)
+};
+
+// constant values used by the kernels
+struct Core_Kernel_Data
+{
+	// RAPDF values (see RAPDF_Table::values()), indexed by the row of
+	// the atom with the larger id + the col of the other atom + distance
+	// bin
+	const void *rapdf;
+	RAPDF_Precision precision;
+	double base;
+	double scale;
+
+	// highest distance bin + 1
+	int top_bin;
+
+	// LJ parameters for each pair of atom numbers
+	double c12[Core_Max_Atoms][Core_Max_Atoms];
+	double c6[Core_Max_Atoms][Core_Max_Atoms];
+	double max_dist[Core_Max_Atoms][Core_Max_Atoms];
+
+	// (only used by the "table" kernel)
+	// distance bin for each whole number squared distance below
+	// top_bin squared (a squared distance d2 is in bin r2_bin[(int) d2])
+	const int *r2_bin;
+	double top_bin_sq;
+
+	// LJ values for each pair of atom numbers
+	const LJ_Table *lj_table;
+};
+
+// Calculate the RAPDF and LJ values for atom i1 of r1 and atom i2 of r2,
+// and store them in rapdf[i1 * Core_Max_Atoms + i2] and
+// lj[i1 * Core_Max_Atoms + i2] (for i1 < r1.num, i2 < r2.num; other
+// entries may be overwritten)
+typedef void (*Core_Pair_Kernel)(const Core_Kernel_Data &k,
+	const Core_Atoms &r1, const Core_Atoms &r2, double *rapdf, double *lj);
+
+// Get a kernel by name: "scalar", "table", "avx2", "avx512" or "auto"
+// (the fastest one this processor supports that uses the analytic LJ
+// values). Returns NULL if the name is not recognised or the processor
+// does not support the kernel.
+Core_Pair_Kernel core_pair_kernel(const std::string &name);
+
+// name of the kernel core_pair_kernel("auto") would return
+const char *core_pair_kernel_auto_name();
+
+#endif // CORE_KERNEL_H_INCLUDED
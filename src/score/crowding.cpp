@@ -17,7 +17,9 @@
 #include <cmath>
 #include <iostream>
 #include <fstream>
+#include <algorithm>
 
+#include "common.h"
 #include "peptide.h"
 #include "atom.h"
 #include "scorer_combined.h"
@@ -31,22 +33,109 @@ Crowding::~Crowding()
 {
 }
 
-double Crowding::score(const Peptide& p, bool verbose) const
+// C-alpha pairs further apart than this are penalised
+static const double Crowding_Dist = 40.0;
+
+double Crowding::score(const Peptide& p, bool verbose,
+	Neighbour_Grid *grid /*= NULL*/, const Topology *topology /*= NULL*/,
+	const Residue_Geometry *geometry /*= NULL*/)
 {
 	int len = p.length();	
 	double total=0.0, penalty=1.0;
 
-	for (int i = p.start();i <= p.end();i++)
-		for (int j = p.start();j <= p.end();j++)
-			if (p.atom_exists(i,Atom_CA) && p.atom_exists(j,Atom_CA) )
+	if (grid == NULL)
+	{
+		m_grid.build(p);
+		grid = &m_grid;
+	}
+
+	if (topology == NULL)
+	{
+		m_topology.update(p);
+		topology = &m_topology;
+	}
+
+	if (geometry == NULL)
+	{
+		m_geometry.build(p, *topology);
+		geometry = &m_geometry;
+	}
+
+	// the bounding box of the C-alphas
+	int num_ca = 0;
+	Point lo, hi;
+	int i;
+
+	for (i = p.start();i <= p.end();i++)
+		if (topology->atom_exists(i,Atom_CA))
+		{
+			const Point &ca_i = geometry->ca(i);
+
+			if (num_ca == 0)
 			{
-				Point ca_i = p.atom_pos(i, Atom_CA);
-				Point ca_j = p.atom_pos(j, Atom_CA);
-				//std::cout << i << "  " << j << "\t" << ca_i.distance(ca_j) << "\n";
-				if ( ca_i.distance(ca_j) > 40.0 )
-					total += penalty;
+				lo = hi = ca_i;
 			}
-	
+			else
+			{
+				lo.x = std::min(lo.x, ca_i.x); hi.x = std::max(hi.x, ca_i.x);
+				lo.y = std::min(lo.y, ca_i.y); hi.y = std::max(hi.y, ca_i.y);
+				lo.z = std::min(lo.z, ca_i.z); hi.z = std::max(hi.z, ca_i.z);
+			}
+
+			num_ca++;
+		}
+
+	// No two C-alphas can be further apart than the diagonal of the box
+	// (this is also true of the distances as calculated, since rounding
+	// never makes a smaller difference larger), so if it is short enough
+	// nothing is penalised. Similarly, C-alpha i cannot be further than
+	// the furthest corner of the box from any other C-alpha.
+	//
+	// Otherwise, each pair is counted once (when i is the later residue)
+	// instead of once from each end, and the total is doubled; since the
+	// counts are whole numbers, the result is exactly the same.
+
+	if (num_ca > 0 && lo.distance(hi) > Crowding_Dist)
+	{
+		int num_before = 0;		// C-alphas before residue i
+		long num_far = 0;		// pairs further apart than Crowding_Dist
+
+		grid->use_cutoff(Crowding_Dist);
+
+		for (i = p.start();i <= p.end();i++)
+			if (topology->atom_exists(i,Atom_CA))
+			{
+				const Point &ca_i = geometry->ca(i);
+				double cx = std::max(ca_i.x - lo.x, hi.x - ca_i.x);
+				double cy = std::max(ca_i.y - lo.y, hi.y - ca_i.y);
+				double cz = std::max(ca_i.z - lo.z, hi.z - ca_i.z);
+
+				if (sqrt(square(cx) + square(cy) + square(cz)) > Crowding_Dist)
+				{
+					// every C-alpha that the grid does not find near
+					// C-alpha i is too far away
+					int num_close = 0;
+
+					grid->find_near(i, Crowding_Dist, i, &m_near);
+
+					for (size_t k = 0;k < m_near.size();k++)
+					{
+						int j = m_near[k];
+
+						if (topology->atom_exists(j,Atom_CA) &&
+							!(ca_i.distance(geometry->ca(j)) > Crowding_Dist))
+							num_close++;
+					}
+
+					num_far += num_before - num_close;
+				}
+
+				num_before++;
+			}
+
+		total = penalty * 2.0 * num_far;
+	}
+
 
 #ifndef RAW_SCORE
 
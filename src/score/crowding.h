@@ -9,6 +9,11 @@
 #ifndef CROWDING_INCLUDED
 #define CROWDING_INCLUDED
 
+#include <vector>
+#include "neighbour_grid.h"
+#include "topology.h"
+#include "residue_geometry.h"
+
 class Peptide;
 /**
  * 
@@ -27,7 +32,19 @@ public:
 	~Crowding();
 
 	/* This method returns the random Score for the Peptide! */
-	double score(const Peptide& peptide, bool verbose = false) const;
+	/* (if grid is not NULL, it must have been built for the peptide's current conformation) */
+	/* (if topology is not NULL, it must have been built for the peptide, */
+	/* and if geometry is not NULL, it must be up to date for the */
+	/* peptide's current conformation) */
+	double score(const Peptide& peptide, bool verbose = false,
+		Neighbour_Grid *grid = NULL, const Topology *topology = NULL,
+		const Residue_Geometry *geometry = NULL);
+
+private:
+	std::vector<int> m_near;	// residues near the current one
+	Neighbour_Grid m_grid;		// used if no grid is passed to score()
+	Topology m_topology;		// used if no topology is passed to score()
+	Residue_Geometry m_geometry;// used if no geometry is passed to score()
 };
 
 #endif // CROWDING_INCLUDED
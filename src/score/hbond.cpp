@@ -27,11 +27,14 @@
 #include <cstdlib>
 #include <cstdio>
 #include <cmath>
+#include <vector>
+#include <algorithm>
 
 #include "peptide.h"
 #include "atom.h"
 #include "scorer_combined.h"
 #include "hbond.h"
+#include "move_range.h"
 
 //#define RAW_SCORE
 
@@ -43,51 +46,224 @@ HBond::~HBond()
 {
 }
 
-double HBond::score(const Peptide& p, bool verbose) const
+// maximum distance between the N and O atoms of a hydrogen bond
+static const double Max_HBond_Dist = 4.0;
+
+// added to Max_HBond_Dist when searching for O atoms, so that rounding
+// errors cannot cause a bond to be missed
+static const double Search_Margin = 1e-6;
+
+// atoms needed in the donor and acceptor residues of a bond
+static const unsigned Donor_Atoms =
+	Topology::mask(Atom_CA) | Topology::mask(Atom_N);
+static const unsigned Acceptor_Atoms =
+	Topology::mask(Atom_C) | Topology::mask(Atom_O);
+
+// whether there is a hydrogen bond between the N atom of residue i
+// and the O atom of residue j
+static bool hbond_between(const Peptide &p, const Topology *topology,
+	int i, int j)
+{
+	if (!(topology->atoms_exist(i, Donor_Atoms) &&
+		  topology->atoms_exist(j, Acceptor_Atoms)))
+	{
+		return false;
+	}
+
+	Point ca_i = p.atom_pos(i, Atom_CA);
+	Point n_i = p.atom_pos(i, Atom_N);
+	Point c_j = p.atom_pos(j, Atom_C);
+	Point o_j = p.atom_pos(j, Atom_O);
+
+	double dist  = n_i.distance(o_j);
+
+	return (dist > 2.0 &&
+		dist < Max_HBond_Dist &&
+		dist < n_i.distance(c_j) &&
+		dist < ca_i.distance(o_j));
+}
+
+// cell coordinate of a position
+static inline int hash_cell(double x)
+{
+	return (int) floor(x / Max_HBond_Dist);
+}
+
+void HBond::build_acceptors(const Peptide &p, const Topology *topology)
+{
+	// (at least twice as many buckets as atoms)
+	int num_buckets = 64;
+
+	while (num_buckets < 2 * p.length())
+	{
+		num_buckets *= 2;
+	}
+
+	m_hash_mask = (unsigned) num_buckets - 1;
+	m_bucket_first.assign(num_buckets + 1, 0);
+	m_bucket.resize(p.full_length());
+
+	int n;
+
+	// count the atoms in each bucket, then store them in bucket order
+	for (n = p.start();n <= p.end();n++)
+	{
+		if (!topology->atoms_exist(n, Acceptor_Atoms))
+		{
+			m_bucket[n] = -1;
+			continue;
+		}
+
+		const Point &o = p.atom_pos(n, Atom_O);
+		m_bucket[n] = bucket(hash_cell(o.x), hash_cell(o.y), hash_cell(o.z));
+		m_bucket_first[m_bucket[n] + 1]++;
+	}
+
+	for (int b = 0;b < num_buckets;b++)
+	{
+		m_bucket_first[b + 1] += m_bucket_first[b];
+	}
+
+	m_acceptors.resize(m_bucket_first[num_buckets]);
+	m_bucket_next.assign(m_bucket_first.begin(), m_bucket_first.end() - 1);
+
+	for (n = p.start();n <= p.end();n++)
+	{
+		if (m_bucket[n] != -1)
+		{
+			Acceptor &a = m_acceptors[m_bucket_next[m_bucket[n]]++];
+			a.o = p.atom_pos(n, Atom_O);
+			a.res = n;
+		}
+	}
+}
+
+void HBond::find_acceptors(const Point &pos)
 {
+	int x = hash_cell(pos.x);
+	int y = hash_cell(pos.y);
+	int z = hash_cell(pos.z);
+
+	// the buckets of the 27 cells around pos (two cells can share a
+	// bucket, so each bucket is only looked at once)
+	int buckets[27];
+	int num = 0;
+
+	for (int dx = -1;dx <= 1;dx++)
+	{
+		for (int dy = -1;dy <= 1;dy++)
+		{
+			for (int dz = -1;dz <= 1;dz++)
+			{
+				buckets[num++] = bucket(x + dx, y + dy, z + dz);
+			}
+		}
+	}
+
+	std::sort(buckets, buckets + num);
+	num = (int) (std::unique(buckets, buckets + num) - buckets);
+
+	double max_dist_sq = square(Max_HBond_Dist + Search_Margin);
+	m_near.clear();
+
+	for (int k = 0;k < num;k++)
+	{
+		int end = m_bucket_first[buckets[k] + 1];
+
+		for (int i = m_bucket_first[buckets[k]];i < end;i++)
+		{
+			const Acceptor &a = m_acceptors[i];
+
+			if (square(a.o.x - pos.x) + square(a.o.y - pos.y) +
+				square(a.o.z - pos.z) < max_dist_sq)
+			{
+				m_near.push_back(a.res);
+			}
+		}
+	}
+}
+
+double HBond::score(const Peptide& p, bool verbose,
+	const Move_Range *range /*= NULL*/, const Topology *topology /*= NULL*/)
+{
+	if (topology == NULL)
+	{
+		m_topology.update(p);
+		topology = &m_topology;
+	}
+
+	build_acceptors(p, topology);
+
+	// If possible, the bonds between residues whose relative position
+	// was not changed by the move are reused, so only the O atoms of
+	// the other residues near each N atom need to be checked.
+	bool reuse = m_donor.begin(p.start(), p.end(), p.full_length(), range);
+
+	// a residue cannot form a hydrogen bond with more than one other
+	// residue at the same time, so only count whether each residue's
+	// N atom is bonded to anything
 	int num_hbonds = 0;
 
-	for (int i = p.start();i <= p.end();i++)
+	for (int n = p.start();n <= p.end();n++)
 	{
-		if (!(p.atom_exists(i, Atom_CA) && p.atom_exists(i, Atom_N)))
+		Donor_Bonds &d = m_donor[n];
+
+		if (!topology->atoms_exist(n, Donor_Atoms))
 		{
+			d.num = 0;
 			continue;
 		}
 
-		Point ca_i = p.atom_pos(i, Atom_CA);
-		Point n_i = p.atom_pos(i, Atom_N);
-	
-		for (int j = p.start();j <= p.end();j++)
+		// (all of the bonds are checked again if they were not all
+		// listed)
+		bool all = (!reuse || d.num > Max_Partners);
+
+		if (all)
+		{
+			d.num = 0;
+		}
+		else
 		{
-			if (i != j)
+			// keep the bonds that cannot have changed
+			int num = 0;
+
+			for (int k = 0;k < d.num;k++)
 			{
-				if (!(p.atom_exists(j, Atom_C) && p.atom_exists(j, Atom_O)))
+				if (!range->pair_changed(n, d.partner[k]))
 				{
-					continue;
+					d.partner[num++] = d.partner[k];
 				}
+			}
 
-				Point c_j = p.atom_pos(j, Atom_C);
-				Point o_j = p.atom_pos(j, Atom_O);
+			d.num = num;
+		}
 
-				double dist  = n_i.distance(o_j);
+		find_acceptors(p.atom_pos(n, Atom_N));
 
-				if (dist > 2.0 &&
-					dist < 4.0 &&
-					dist < n_i.distance(c_j) &&
-					dist < ca_i.distance(o_j))
-				{
-					if (verbose)
-					{
-					}
+		for (size_t i = 0;i < m_near.size();i++)
+		{
+			int m = m_near[i];
 
-					num_hbonds++;
+			if (m != n && (all || range->pair_changed(n, m)) &&
+				hbond_between(p, topology, n, m))
+			{
+				if (d.num < Max_Partners)
+				{
+					d.partner[d.num] = m;
+				}
 
-					// cannot form a hydrogen bond with more than one
-					// other residue at the same time, so stop inner loop
-					break;
+				// (stays at Max_Partners + 1 once it gets there)
+				if (d.num <= Max_Partners)
+				{
+					d.num++;
 				}
 			}
 		}
+
+		if (d.num > 0)
+		{
+			num_hbonds++;
+		}
 	}
 
 	double total = ((double) -num_hbonds);
@@ -109,3 +285,7 @@ double HBond::score(const Peptide& p, bool verbose) const
 	return total;
 }
 
+void HBond::accept()
+{
+	m_donor.accept();
+}
@@ -9,7 +9,13 @@
 #ifndef HBOND_H_INCLUDED
 #define HBOND_H_INCLUDED
 
+#include <vector>
+#include "point.h"
+#include "score_cache.h"
+#include "topology.h"
+
 class Peptide;
+struct Move_Range;
 
 /**
  * @brief Hydrogen bond potential.
@@ -40,7 +46,71 @@ public:
 	HBond();
 	~HBond();
 
-	double score(const Peptide& peptide, bool verbose = false) const;
+	// score a peptide (low scores are better). If range is not NULL, the
+	// peptide differs from the conformation last passed to accept() only
+	// as described by range. If topology is not NULL, it must have been
+	// built for the peptide.
+	double score(const Peptide& peptide, bool verbose = false,
+		const Move_Range *range = NULL, const Topology *topology = NULL);
+
+	// the peptide last scored is now the current conformation
+	// (see Scorer::accept_last_scored())
+	void accept();
+
+private:
+	// maximum number of bonds listed for one donor
+	static const int Max_Partners = 4;
+
+	// the hydrogen bonds from the N atom of one residue
+	struct Donor_Bonds
+	{
+		int num;					// number of bonds (more than
+									// Max_Partners if they are not all
+									// listed)
+		int partner[Max_Partners];	// residues whose O atom it is bonded to
+	};
+
+	// an O atom (and its residue) in the spatial hash
+	struct Acceptor
+	{
+		Point o;
+		int res;
+	};
+
+	// put the O atoms of the residues that can accept a hydrogen bond
+	// into the spatial hash
+	void build_acceptors(const Peptide &p, const Topology *topology);
+
+	// find the residues whose O atom may be within the bond distance of
+	// pos (the result is stored in m_near)
+	void find_acceptors(const Point &pos);
+
+	// hash bucket of the cell containing (x, y, z), where x, y and z are
+	// cell coordinates
+	int bucket(int x, int y, int z) const
+	{
+		return (int) (((unsigned) x * 73856093u ^ (unsigned) y * 19349663u ^
+			(unsigned) z * 83492791u) & m_hash_mask);
+	}
+
+private:
+	// hydrogen bonds from each residue (for residues whose relative
+	// position is unchanged by a move, the bonds are reused)
+	Score_Cache<Donor_Bonds> m_donor;
+
+	// Spatial hash of the O atoms of the peptide being scored. Space is
+	// divided into cubes as wide as the largest bond distance, so each O
+	// atom that can form a bond with an N atom is in one of the 27 cells
+	// around it. Each cell is hashed to a bucket, and the atoms in bucket
+	// b are m_acceptors[m_bucket_first[b]] .. [m_bucket_first[b + 1] - 1].
+	std::vector<Acceptor> m_acceptors;
+	std::vector<int> m_bucket_first;
+	unsigned m_hash_mask;		// number of buckets - 1
+
+	std::vector<int> m_near;	// residues found by find_acceptors()
+	std::vector<int> m_bucket;	// (used by build_acceptors())
+	std::vector<int> m_bucket_next;
+	Topology m_topology;		// used if no topology is passed to score()
 };
 
 #endif // HBOND_H_INCLUDED
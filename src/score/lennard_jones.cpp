@@ -12,6 +12,7 @@
 //#define RAW_SCORE
 
 Lennard_Jones::LJ_Params Lennard_Jones::m_lj[Num_Backbone][Num_Backbone];
+double Lennard_Jones::m_max_dist = 0.0;
 
 Lennard_Jones::LJ_Params::LJ_Params()
 {
@@ -30,6 +31,7 @@ Lennard_Jones::LJ_Params::LJ_Params(double c12_val, double c6_val)
 	// fixing for our purposes (the jump is about 1.5 percent of the
 	// well depth).
 	this->max_dist = 2.5 * sigma;
+	this->max_d2 = square(this->max_dist);
 }
 
 // return a single letter representing an atom type
@@ -141,6 +143,13 @@ public:
 				Lennard_Jones::m_lj[a1][a2] =
 					Lennard_Jones::LJ_Params(c12, c6);
 
+				if (Lennard_Jones::m_lj[a1][a2].max_dist >
+					Lennard_Jones::m_max_dist)
+				{
+					Lennard_Jones::m_max_dist =
+						Lennard_Jones::m_lj[a1][a2].max_dist;
+				}
+
 				// check if minimum is where it should be: at (s, -e)
 				if (fabs(c12 / pow(s, 12.0) - c6 / pow(s, 6.0) + e) > 0.001)
 				{
@@ -158,6 +167,7 @@ namespace
 }
 
 Lennard_Jones::Lennard_Jones()
+	: m_tabulated(false)
 {
 }
 
@@ -165,73 +175,138 @@ Lennard_Jones::~Lennard_Jones()
 {
 }
 
-double Lennard_Jones::score(const Peptide& p, bool verbose /*= false*/)
+void Lennard_Jones::set_tabulated(bool tabulated)
 {
-	double total = 0.0;
-	
-	for (int n1 = p.start() + 2;n1 <= p.end();n1++)
+	m_tabulated = tabulated;
+
+	if (m_tabulated)
 	{
+		m_table.set_num_types(Num_Backbone);
+
 		for (int a1 = 0;a1 < Num_Backbone;a1++)
 		{
-			if (!p.atom_exists(n1, (Atom_Id) a1))
+			for (int a2 = 0;a2 < Num_Backbone;a2++)
 			{
-				continue;
+				m_table.set(a1, a2, m_lj[a1][a2].c12, m_lj[a1][a2].c6,
+					m_lj[a1][a2].max_dist);
 			}
+		}
 
-			Point p1 = p.atom_pos(n1, (Atom_Id) a1);
+		m_table.build();
+		m_table.report(std::cerr, "Lennard-Jones");
+	}
+}
+
+inline bool Lennard_Jones::pair_value(Atom_Id a1, Atom_Id a2,
+	const Point &p1, const Point &p2, double *val) const
+{
+	const LJ_Params &lj = m_lj[a1][a2];
+
+	if (m_tabulated)
+	{
+		double d2 = square(p1.x - p2.x) + square(p1.y - p2.y) +
+			square(p1.z - p2.z);
+
+		if (d2 >= lj.max_d2)
+		{
+			return false;
+		}
+
+		*val = m_table.value(a1, a2, d2);
+		return true;
+	}
+
+	if (fabs(p1.x - p2.x) < lj.max_dist &&
+		fabs(p1.y - p2.y) < lj.max_dist &&
+		fabs(p1.z - p2.z) < lj.max_dist)
+	{
+		double d = p1.distance(p2);
+
+		if (d < lj.max_dist)
+		{
+			if (d < 1.0)
+			{
+				// treat distance as 1.0
+				// (to avoid ridiculous values)
+				*val = lj.c12 - lj.c6;
+			}
+			else
+			{
+				double d6 = square(d * d * d);
+				*val = (lj.c12 / square(d6)) - (lj.c6 / d6);
+			}
+
+			return true;
+		}
+	}
+
+	return false;
+}
+
+double Lennard_Jones::score(const Peptide& p, bool verbose /*= false*/,
+	Neighbour_Grid *grid /*= NULL*/, const Topology *topology /*= NULL*/)
+{
+	double total = 0.0;
+
+	if (grid == NULL)
+	{
+		m_grid.build(p);
+		grid = &m_grid;
+	}
+
+	if (topology == NULL)
+	{
+		m_topology.update(p);
+		topology = &m_topology;
+	}
+
+	grid->use_cutoff(m_max_dist);
+	
+	for (int n1 = p.start() + 2;n1 <= p.end();n1++)
+	{
+		// (residues that are too far away have no LJ score)
+		grid->find_near(n1, m_max_dist, n1 - 1, &m_near);
+
+		int end1 = topology->end_backbone(n1);
+
+		for (int i1 = topology->first_atom(n1);i1 < end1;i1++)
+		{
+			Atom_Id a1 = topology->atom_type(i1);
+			Point p1 = p.atom_pos(n1, a1);
 
 			
 			// (n1 & n2 not in the same or an adjacent residue)
 
-			for (int n2 = p.start();n2 < n1 - 1;n2++)
+			for (size_t i = 0;i < m_near.size();i++)
 			{
-				for (int a2 = 0;a2 < Num_Backbone;a2++)
-				{
-					if (!p.atom_exists(n2, (Atom_Id) a2))
-					{
-						continue;
-					}
+				int n2 = m_near[i];
 
-					const LJ_Params &lj = m_lj[a1][a2];
-					Point p2 = p.atom_pos(n2, (Atom_Id) a2);
+				int end2 = topology->end_backbone(n2);
 
-					if (fabs(p1.x - p2.x) < lj.max_dist &&
-						fabs(p1.y - p2.y) < lj.max_dist &&
-						fabs(p1.z - p2.z) < lj.max_dist)
+				for (int i2 = topology->first_atom(n2);i2 < end2;i2++)
+				{
+					Atom_Id a2 = topology->atom_type(i2);
+					Point p2 = p.atom_pos(n2, a2);
+					double t;
+
+					if (pair_value(a1, a2, p1, p2, &t))
 					{
-						double d = p1.distance(p2);
+						total += t;
 
-						if (d < lj.max_dist)
+						if (verbose)
 						{
-							double old_total = total;
-
-							if (d < 1.0)
-							{
-								// treat distance as 1.0
-								// (to avoid ridiculous values)
-								total += lj.c12 - lj.c6;
-							}
-							else
-							{
-								double d6 = square(d * d * d);
-								total += (lj.c12 / square(d6)) - (lj.c6 / d6);
-							}
-
-							if (verbose)
-							{
-								std::cout << "LJ "
-									<< n2 << " " << n1
-									<< " = " << total - old_total
-									<< " dist "
-									<< d
-									<< " " << n2 << " "
-									<< Atom_Type((Atom_Id) a2).name()
-									<< " at " << p2
-									<< " & " << n1 << " "
-									<< Atom_Type((Atom_Id) a1).name()
-									<< " at " << p1
-									<< "\n";
-							}
+							std::cout << "LJ "
+								<< n2 << " " << n1
+								<< " = " << t
+								<< " dist "
+								<< p1.distance(p2)
+								<< " " << n2 << " "
+								<< Atom_Type(a2).name()
+								<< " at " << p2
+								<< " & " << n1 << " "
+								<< Atom_Type(a1).name()
+								<< " at " << p1
+								<< "\n";
 						}
 					}
 				}
@@ -257,66 +332,53 @@ bool Lennard_Jones::steric_clash(const Peptide &p, double max_total /* -1.0*/)
 {
 	double total = 0.0;
 
+	m_grid.build(p);
+	m_topology.update(p);
+
+	const Topology *topology = &m_topology;
+
+	m_grid.use_cutoff(m_max_dist);
+
 	for (int n1 = p.start() + 2;n1 <= p.end();n1++)
 	{
-		for (int a1 = 0;a1 < Num_Backbone;a1++)
-		{
-			if (!p.atom_exists(n1, (Atom_Id) a1))
-			{
-				continue;
-			}
+		// (residues that are too far away have no LJ score)
+		m_grid.find_near(n1, m_max_dist, n1 - 1, &m_near);
 
-			Point p1 = p.atom_pos(n1, (Atom_Id) a1);
+		int end1 = topology->end_backbone(n1);
+
+		for (int i1 = topology->first_atom(n1);i1 < end1;i1++)
+		{
+			Atom_Id a1 = topology->atom_type(i1);
+			Point p1 = p.atom_pos(n1, a1);
 
 			// (n1 & n2 not in the same or an adjacent residue)
 
-			for (int n2 = p.start();n2 < n1 - 1;n2++)
+			for (size_t i = 0;i < m_near.size();i++)
 			{
-				for (int a2 = 0;a2 < Num_Backbone;a2++)
-				{
-					if (!p.atom_exists(n2, (Atom_Id) a2))
-					{
-						continue;
-					}
+				int n2 = m_near[i];
 
-					const LJ_Params &lj = m_lj[a1][a2];
-					Point p2 = p.atom_pos(n2, (Atom_Id) a2);
+				int end2 = topology->end_backbone(n2);
 
-					if (fabs(p1.x - p2.x) < lj.max_dist &&
-						fabs(p1.y - p2.y) < lj.max_dist &&
-						fabs(p1.z - p2.z) < lj.max_dist)
+				for (int i2 = topology->first_atom(n2);i2 < end2;i2++)
+				{
+					Atom_Id a2 = topology->atom_type(i2);
+					Point p2 = p.atom_pos(n2, a2);
+					double t;
+
+					if (pair_value(a1, a2, p1, p2, &t))
 					{
-						double d = p1.distance(p2);
+						// for purposes of creating decoys, Threshold
+						// must be more than the value for any of the
+						// native structures
 
-						if (d < lj.max_dist)
+						static const double Threshold = 20.0;
+
+						if (t > Threshold)
 						{
-							double t;
-
-							if (d < 1.0)
-							{
-								// treat distance as 1.0
-								// (to avoid ridiculous values)
-								t = lj.c12 - lj.c6;
-							}
-							else
-							{
-								double d6 = square(d * d * d);
-								t = (lj.c12 / square(d6)) - (lj.c6 / d6);
-							}
-
-							// for purposes of creating decoys, Threshold
-							// must be more than the value for any of the
-							// native structures
-
-							static const double Threshold = 20.0;
-
-							if (t > Threshold)
-							{
-								return true;
-							}
-
-							total += t;
+							return true;
 						}
+
+						total += t;
 					}
 				}
 			}
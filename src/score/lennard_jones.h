@@ -1,6 +1,11 @@
 #ifndef LENNARD_JONES_H_INCLUDED
 #define LENNARD_JONES_H_INCLUDED
 
+#include <vector>
+#include "neighbour_grid.h"
+#include "topology.h"
+#include "lj_table.h"
+
 class Peptide;
 
 /**
@@ -14,25 +19,50 @@ public:
 	~Lennard_Jones();
 
 	// score a peptide (low scores are better)
-	double score(const Peptide& peptide, bool verbose = false);
+	// (if grid is not NULL, it must have been built for the peptide's
+	// current conformation, and if topology is not NULL, it must have
+	// been built for the peptide)
+	double score(const Peptide& peptide, bool verbose = false,
+		Neighbour_Grid *grid = NULL, const Topology *topology = NULL);
 
 	// check if any single LJ score is beyond a certain threshold
 	bool steric_clash(const Peptide &peptide,
 		double max_total = -1.0	// maximum total score (-1 means no limit)
 	);
 
+	// use values tabulated against the squared distance between atoms
+	// instead of calculating them (faster, but slightly different; see
+	// LJ_Table)
+	void set_tabulated(bool tabulated);
+
 protected:
 	struct LJ_Params
 	{
 		double c12;
 		double c6;
 		double max_dist;
+		double max_d2;		// max_dist squared
 
 		LJ_Params();
 		LJ_Params(double c12_val, double c6_val);
 	};
 
 	static LJ_Params m_lj[Num_Backbone][Num_Backbone];
+
+	// largest max_dist value in m_lj
+	static double m_max_dist;
+
+	// get the LJ value for atoms of types a1 and a2 at positions p1 and
+	// p2 (returns false if they are too far apart to have one)
+	bool pair_value(Atom_Id a1, Atom_Id a2, const Point &p1,
+		const Point &p2, double *val) const;
+
+	bool m_tabulated;			// whether to use m_table
+	LJ_Table m_table;			// tabulated values (if m_tabulated)
+
+	std::vector<int> m_near;	// residues near the current one
+	Neighbour_Grid m_grid;		// used if no grid is passed to score()
+	Topology m_topology;		// used if no topology is passed to score()
 };
 
 #endif // LENNARD_JONES_H_INCLUDED
@@ -0,0 +1,151 @@
+
+#include <cmath>
+#include <cassert>
+#include "common.h"
+#include "lj_table.h"
+
+const double LJ_Table::Contact_Dist = 3.0;
+
+LJ_Table::LJ_Table()
+	: m_num_types(0), m_max_error(0.0), m_max_error_dist(0.0),
+	  m_max_contact_error(0.0)
+{
+}
+
+void LJ_Table::set_num_types(int num_types)
+{
+	m_num_types = num_types;
+	m_pair.assign(num_types * num_types, -1);
+	m_table.clear();
+	m_values.clear();
+}
+
+void LJ_Table::set(int a1, int a2, double c12, double c6, double max_dist)
+{
+	assert(a1 >= 0 && a1 < m_num_types && a2 >= 0 && a2 < m_num_types);
+
+	// pairs of types with the same parameters share a table
+	int t;
+
+	for (t = 0;t < (int) m_table.size();t++)
+	{
+		if (m_table[t].c12 == c12 && m_table[t].c6 == c6 &&
+			m_table[t].max_dist == max_dist)
+		{
+			break;
+		}
+	}
+
+	if (t == (int) m_table.size())
+	{
+		Pair_Table p;
+		p.c12 = c12;
+		p.c6 = c6;
+		p.max_dist = max_dist;
+		p.max_d2 = square(max_dist);
+		p.offset = 0;
+		m_table.push_back(p);
+	}
+
+	m_pair[a1 * m_num_types + a2] = t;
+	m_pair[a2 * m_num_types + a1] = t;
+}
+
+double LJ_Table::analytic(double c12, double c6, double max_dist, double d2)
+{
+	double d = sqrt(d2);
+
+	if (d >= max_dist)
+	{
+		return 0.0;
+	}
+
+	if (d < 1.0)
+	{
+		// treat distance as 1.0
+		// (to avoid ridiculous values)
+		return c12 - c6;
+	}
+
+	double d6 = square(d * d * d);
+	return (c12 / square(d6)) - (c6 / d6);
+}
+
+void LJ_Table::build()
+{
+	m_values.clear();
+
+	for (size_t t = 0;t < m_table.size();t++)
+	{
+		Pair_Table &p = m_table[t];
+		p.offset = (int) m_values.size();
+
+		// (one extra value so that value() can interpolate up to max_d2)
+		int num = (int) ceil((p.max_d2 - 1.0) * Steps) + 2;
+
+		for (int i = 0;i < num;i++)
+		{
+			double d2 = 1.0 + i / (double) Steps;
+
+			// (the values beyond the cutoff are not used, except to
+			// interpolate just below it)
+			double d6 = d2 * d2 * d2;
+			m_values.push_back((p.c12 / square(d6)) - (p.c6 / d6));
+		}
+	}
+
+	check();
+}
+
+void LJ_Table::check()
+{
+	// sample each interval between stored values at several points
+	static const int Samples = 16;
+
+	m_max_error = 0.0;
+	m_max_error_dist = 0.0;
+	m_max_contact_error = 0.0;
+
+	for (int a1 = 0;a1 < m_num_types;a1++)
+	{
+		for (int a2 = 0;a2 <= a1;a2++)
+		{
+			int t = m_pair[a1 * m_num_types + a2];
+
+			if (t == -1)
+			{
+				continue;
+			}
+
+			const Pair_Table &p = m_table[t];
+			int num = (int) ceil((p.max_d2 + 1.0) * Steps * Samples);
+
+			for (int i = 0;i < num;i++)
+			{
+				double d2 = (i + 0.5) / (Steps * Samples);
+				double exact = analytic(p.c12, p.c6, p.max_dist, d2);
+				double err = fabs(value(a1, a2, d2) - exact);
+
+				if (err > m_max_error)
+				{
+					m_max_error = err;
+					m_max_error_dist = sqrt(d2);
+				}
+
+				if (d2 >= square(Contact_Dist) && err > m_max_contact_error)
+				{
+					m_max_contact_error = err;
+				}
+			}
+		}
+	}
+}
+
+void LJ_Table::report(std::ostream &out, const char *term) const
+{
+	out << "Note: tabulated LJ values for " << term
+		<< " differ from the analytic values by at most "
+		<< m_max_error << " (at distance " << m_max_error_dist
+		<< "), or " << m_max_contact_error
+		<< " at distances of " << Contact_Dist << " or more\n";
+}
@@ -0,0 +1,110 @@
+#ifndef LJ_TABLE_H_INCLUDED
+#define LJ_TABLE_H_INCLUDED
+
+// Lennard-Jones values for pairs of atom types, tabulated against the
+// squared distance between the atoms so that no square root or division
+// is needed to find a value.
+//
+// For each pair of atom types, values are stored at squared distances
+// 1, 1 + 1/Steps, 1 + 2/Steps, ... up to the cutoff distance, and a value
+// in between is found by linear interpolation. Pairs of atom types with
+// the same parameters share a table.
+//
+// The values are the same as the analytic ones at distances below 1
+// (which are treated as 1) and beyond the cutoff (where the value is 0);
+// elsewhere they differ slightly. build() finds the largest difference
+// by comparing the two at many distances.
+
+#include <vector>
+#include <iostream>
+
+class LJ_Table
+{
+public:
+	// number of values per square Angstrom
+	static const int Steps = 32;
+
+	// constructor
+	LJ_Table();
+
+	// set the number of atom types, and clear all values
+	void set_num_types(int num_types);
+
+	// set the parameters for atom types a1 and a2 (and a2 and a1)
+	void set(int a1, int a2, double c12, double c6, double max_dist);
+
+	// calculate the values (after all pairs of types have been set)
+	void build();
+
+	// the Lennard-Jones value for atoms of types a1 and a2 whose squared
+	// distance apart is d2
+	double value(int a1, int a2, double d2) const
+	{
+		const Pair_Table &t = m_table[m_pair[a1 * m_num_types + a2]];
+
+		if (d2 >= t.max_d2)
+		{
+			return 0.0;
+		}
+
+		if (d2 < 1.0)
+		{
+			return t.c12 - t.c6;
+		}
+
+		double x = (d2 - 1.0) * Steps;
+		int i = (int) x;
+		const double *v = &m_values[t.offset + i];
+
+		return v[0] + (x - i) * (v[1] - v[0]);
+	}
+
+	// the value calculated the usual way (the same as value() without
+	// using the table)
+	static double analytic(double c12, double c6, double max_dist,
+		double d2);
+
+	// largest difference between value() and analytic()
+	double max_error() const
+	{ return m_max_error; }
+
+	// distance at which max_error() occurs
+	double max_error_dist() const
+	{ return m_max_error_dist; }
+
+	// largest difference between value() and analytic() at distances of
+	// at least Contact_Dist (which excludes the steep part of the curve
+	// that only affects atoms that clash)
+	static const double Contact_Dist;
+
+	double max_contact_error() const
+	{ return m_max_contact_error; }
+
+	// print the above (for the given score term) to out
+	void report(std::ostream &out, const char *term) const;
+
+private:
+	struct Pair_Table
+	{
+		double c12;
+		double c6;
+		double max_dist;
+		double max_d2;			// max_dist squared
+		int offset;				// position of first value in m_values
+	};
+
+	// compare value() to analytic() for every pair of types
+	void check();
+
+private:
+	int m_num_types;
+	std::vector<int> m_pair;	// index in m_table of each pair of types
+	std::vector<Pair_Table> m_table;
+	std::vector<double> m_values;
+
+	double m_max_error;
+	double m_max_error_dist;
+	double m_max_contact_error;
+};
+
+#endif // LJ_TABLE_H_INCLUDED
@@ -9,6 +9,7 @@ Orientation::Orientation()
 {
 	m_short = new Orientation_impl;
 	m_long = new Orientation_impl;
+	m_last = NULL;
 }
 
 Orientation::~Orientation()
@@ -27,15 +28,33 @@ void Orientation::set_long_data_file(const std::string &filename)
 	m_long->set_data_file(filename);
 }
 
-double Orientation::score(const Peptide &p, bool verbose, bool continuous)
+void Orientation::set_float(bool use_float)
+{
+	m_short->set_float(use_float);
+	m_long->set_float(use_float);
+}
+
+double Orientation::score(const Peptide &p, bool verbose, bool continuous,
+	const Move_Range *range /*= NULL*/, const Topology *topology /*= NULL*/,
+	const Residue_Geometry *geometry /*= NULL*/)
 {
 	if (p.length() <= SHORT_PEPTIDE || continuous)
 	{
-		return m_short->score(p, verbose, continuous);
+		m_last = m_short;
+		return m_short->score(p, verbose, continuous, range, topology, geometry);
 	}
 	else
 	{
-		return m_long->score(p, verbose);
+		m_last = m_long;
+		return m_long->score(p, verbose, false, range, topology, geometry);
+	}
+}
+
+void Orientation::accept()
+{
+	if (m_last != NULL)
+	{
+		m_last->accept();
 	}
 }
 
@@ -6,6 +6,9 @@
 
 class Peptide;
 class Orientation_impl;
+class Topology;
+class Residue_Geometry;
+struct Move_Range;
 
 //#define ORIENT_DISTS	8
 #define ORIENT_DISTS	18
@@ -21,12 +24,21 @@ public:
 	~Orientation();
 
 	// score a peptide (low scores are better)
-	double score(const Peptide& peptide, bool verbose = false, bool continuous = false);
+	double score(const Peptide& peptide, bool verbose = false, bool continuous = false,
+		const Move_Range *range = NULL, const Topology *topology = NULL,
+		const Residue_Geometry *geometry = NULL);
+
+	// the peptide last scored is now the current conformation
+	// (see Scorer::accept_last_scored())
+	void accept();
 
 	// set the name of the orientation data file
 	void set_short_data_file(const std::string &filename);
 	void set_long_data_file(const std::string &filename);
 
+	// whether to keep the values as floats (see Orientation_impl)
+	void set_float(bool use_float);
+
 	// get the distance and angle bin between two residues (index n and m)
 	// Returns false if there is no bin (too far apart or missing atoms)
 	static bool get_bins(const Peptide &p, int n, int m,
@@ -38,6 +50,7 @@ public:
 private:
 	Orientation_impl *m_short;    // for short proteins
 	Orientation_impl *m_long;     // for long proteins
+	Orientation_impl *m_last;     // the one used for the last score() call
 };
 
 #endif // ORIENTATION_H_INCLUDED
@@ -3,6 +3,7 @@
 #include <cstdio>
 #include <cassert>
 #include <cmath>
+#include <algorithm>
 
 #include "peptide.h"
 #include "residue.h"
@@ -13,13 +14,28 @@
 #include "scorer_combined.h"
 #include "orientation.h"
 #include "orientation_impl.h"
+#include "move_range.h"
 
 #ifndef M_SQRT1_2
 #define M_SQRT1_2 0.70710678119
 #endif
 
+namespace
+{
+	// dimensions of the table of values (see Orientation_impl::read_text())
+	std::vector<int> table_dims()
+	{
+		std::vector<int> dims;
+		dims.push_back(ORIENT_DISTS);
+		dims.push_back(ORIENT_ANGLES);
+		dims.push_back((int) Amino::Num);
+		dims.push_back((int) Amino::Num);
+		return dims;
+	}
+}
+
 Orientation_impl::Orientation_impl() :
-	m_data_loaded(false)
+	m_data_loaded(false), m_use_float(false)
 {
 }
 
@@ -32,6 +48,12 @@ void Orientation_impl::set_data_file(const std::string &filename)
 	m_filename = filename;
 }
 
+void Orientation_impl::set_float(bool use_float)
+{
+	m_use_float = use_float;
+	m_data_loaded = false;
+}
+
 void Orientation_impl::load_data()
 {
 	if (m_data_loaded)
@@ -47,8 +69,53 @@ void Orientation_impl::load_data()
 
 //std::cout << "LOADING ORIENTATION DATA\n";
 
+	if (!Potential_File::read_table(m_filename, "orientation", &m_table))
+	{
+		read_text(m_filename, &m_table);
+	}
+
+	m_table.check(m_filename, "orientation", table_dims(), 0);
+
+	// rearrange the values from [dist][angle][a1][a2] order
+	m_values.resize(m_table.num_values());
+
+	for (int a1 = 0;a1 < Amino::Num;a1++)
+	{
+		for (int a2 = 0;a2 < Amino::Num;a2++)
+		{
+			double *v = &m_values[pair_offset(a1, a2)];
+
+			for (int dist = 0;dist < ORIENT_DISTS;dist++)
+			{
+				for (int angle = 0;angle < ORIENT_ANGLES;angle++)
+				{
+					*v++ = m_table.values[((dist * ORIENT_ANGLES + angle) *
+						Amino::Num + a1) * Amino::Num + a2];
+				}
+			}
+		}
+	}
+
+	m_values_float.clear();
+
+	if (m_use_float)
+	{
+		m_values_float.assign(m_values.begin(), m_values.end());
+	}
+
+	m_data_loaded = true;
+}
+
+void Orientation_impl::read_text(const std::string &filename,
+	Potential_Table *table)
+{
 	// exits with error message if the file does not exist
-	C_File file(m_filename, "r", "Orientation data file");
+	C_File file(filename, "r", "Orientation data file");
+
+	table->allocate(table_dims());
+	table->params.clear();
+
+	double *data = &table->own_values[0];
 
 	static const int Max_Len = 1000;
 	char buffer[Max_Len];
@@ -61,7 +128,7 @@ void Orientation_impl::load_data()
 			if (!file.next_line(buffer, Max_Len) || std::string(buffer, 3) != Amino(a1).abbr() || std::string(buffer + 4, 3) != Amino(a2).abbr())
 			{
 				std::cerr << "Error: expected \"" << Amino(a1).abbr() << ' ' << Amino(a2).abbr() << "\" on line " << file.line_num()
-					<< " of orientation data file " << m_filename << "\n"; exit(1);
+					<< " of orientation data file " << filename << "\n"; exit(1);
 			}
 
 			for (int angle = 0;angle < ORIENT_ANGLES;angle++)
@@ -73,126 +140,242 @@ void Orientation_impl::load_data()
 					if (!file.next_line(buffer, Max_Len) || sscanf(buffer, "%d %lf", &d, &val) != 2 || d != dist + 3)
 					{
 						std::cerr << "Error: expected \"" << dist + 3 << "\" followed by value on line " << file.line_num() << " of orientation data file "
-							<< m_filename << "\n"; exit(1);
+							<< filename << "\n"; exit(1);
 					}
 
 //					std::cout << ": " << dist << " " << angle << " " << a1 << " " << a2 << " " << " = " << val << "\n";
 
-					m_data[dist][angle][a1][a2] = val;
-					m_data[dist][angle][a2][a1] = val;
+					data[((dist * ORIENT_ANGLES + angle) * Amino::Num + a1) * Amino::Num + a2] = val;
+					data[((dist * ORIENT_ANGLES + angle) * Amino::Num + a2) * Amino::Num + a1] = val;
 				}
 			}
 		}
 	}
 
 	if (file.next_line(buffer, Max_Len))
-		std::cerr << "Warning: ignoring extra data on line " << file.line_num() << " of orientation data file " << m_filename << "\n";
+		std::cerr << "Warning: ignoring extra data on line " << file.line_num() << " of orientation data file " << filename << "\n";
+}
 
-	m_data_loaded = true;
+void Orientation_impl::get_residues(const Peptide &p,
+	const Topology *topology, const Residue_Geometry *geometry)
+{
+	static const unsigned CA_C = Topology::mask(Atom_CA) | Topology::mask(Atom_C);
+
+	int len = p.full_length();
+	m_ca_x.resize(len); m_ca_y.resize(len); m_ca_z.resize(len);
+	m_sc_x.resize(len); m_sc_y.resize(len); m_sc_z.resize(len);
+	m_dir_x.resize(len); m_dir_y.resize(len); m_dir_z.resize(len);
+	m_amino.resize(len);
+	m_usable.resize(len);
+	m_dist_bin.resize(len);
+	m_angle_key.resize(len);
+
+	for (int n = p.start();n <= p.end();n++)
+	{
+		m_amino[n] = topology->amino(n);
+		m_usable[n] = (topology->atoms_exist(n, CA_C) &&
+			geometry->has_side_chain(n));
+
+		// (the values are not used for other residues, but are always
+		// set so that score_row() does not use uninitialised values)
+		Point ca, sc, dir;
+
+		if (m_usable[n])
+		{
+			ca = geometry->ca(n);
+			sc = geometry->side_chain(n);
+			dir = geometry->side_chain_dir(n);
+		}
+
+		m_ca_x[n] = ca.x; m_ca_y[n] = ca.y; m_ca_z[n] = ca.z;
+		m_sc_x[n] = sc.x; m_sc_y[n] = sc.y; m_sc_z[n] = sc.z;
+		m_dir_x[n] = dir.x; m_dir_y[n] = dir.y; m_dir_z[n] = dir.z;
+	}
+}
+
+// The angle bin for two residues r1 and r2 (where r1 has the lower amino
+// acid number) depends on the angle a1 between the CA(r1) -> CA(r2)
+// direction and the side chain direction of r1, the angle a2 between
+// CA(r2) -> CA(r1) and the side chain direction of r2, and in one case
+// on the torsion angle side chain(r1), CA(r1), CA(r2), side chain(r2):
+//
+//	bin		a1		a2		torsion
+//	 0		<45		<45
+//	 1		<45		45-90
+//	 2		<45		90+
+//	 3		45-90	<45
+//	 4		90+		<45
+//	 5		90+		90+
+//	 6		90+		45-90
+//	 7		45-90	90+
+//	 8		45-90	45-90	<90
+//	 9		45-90	45-90	90+
+//
+// score_row() finds a key for each pair: 3 * c1 + c2, where c1 and c2 are
+// 0, 1 or 2 for a1 and a2 less than 45, 45-90 or 90+ degrees, except that
+// the key is 9 (bin 8) or 10 (bin 9) instead of 4. Angle_Bin gives the
+// bin for each key.
+
+static const int Angle_Bin[11] = { 0, 1, 2, 3, 8, 7, 4, 6, 5, 8, 9 };
+
+void Orientation_impl::score_row(int n, int first, int last, double *out)
+{
+	int num = last - first + 1;
+
+	if (num <= 0)
+	{
+		return;
+	}
+
+	const double *ca_x = &m_ca_x[0], *ca_y = &m_ca_y[0], *ca_z = &m_ca_z[0];
+	const double *sc_x = &m_sc_x[0], *sc_y = &m_sc_y[0], *sc_z = &m_sc_z[0];
+	const double *dir_x = &m_dir_x[0], *dir_y = &m_dir_y[0],
+		*dir_z = &m_dir_z[0];
+	const int *amino = &m_amino[0];
+	int *dist_bin = &m_dist_bin[0];
+	int *angle_key = &m_angle_key[0];
+
+	int a_n = amino[n];
+	double ca_nx = ca_x[n], ca_ny = ca_y[n], ca_nz = ca_z[n];
+	double dir_nx = dir_x[n], dir_ny = dir_y[n], dir_nz = dir_z[n];
+	double e_nx = sc_x[n] - ca_nx;		// side chain(n) - CA(n)
+	double e_ny = sc_y[n] - ca_ny;
+	double e_nz = sc_z[n] - ca_nz;
+
+	// Find the distance bin and angle key for each pair, without any
+	// branches, so that the compiler can do several pairs at once. (The
+	// calculations are the same as the Point functions would do, so the
+	// bins are the same as they would be found with them.)
+	for (int k = 0;k < num;k++)
+	{
+		int m = first + k;
+
+		// (the same as CA(r2) - CA(r1) if r1 is n, or minus it if r1 is m)
+		double vx = ca_x[m] - ca_nx;
+		double vy = ca_y[m] - ca_ny;
+		double vz = ca_z[m] - ca_nz;
+		double d = sqrt(vx * vx + vy * vy + vz * vz);
+
+		double inv = 1.0 / d;
+		double ux = vx * inv, uy = vy * inv, uz = vz * inv;
+
+		// cosines of the angles for r1 = n and r2 = m; if r1 is m, they
+		// are swapped (since the CA -> CA direction is reversed)
+		double dp_n = ux * dir_nx + uy * dir_ny + uz * dir_nz;
+		double dp_m = (-ux) * dir_x[m] + (-uy) * dir_y[m] + (-uz) * dir_z[m];
+
+		bool swap = !(a_n < amino[m]);
+		double dp1 = (swap ? dp_m : dp_n);
+		double dp2 = (swap ? dp_n : dp_m);
+
+		// The same normals as torsion_angle() finds for the torsion angle
+		// side chain(r1), CA(r1), CA(r2), side chain(r2); the angle is
+		// less than 90 degrees if their dot product is negative. (The
+		// differences are selected rather than indexing by r1 and r2, and
+		// negating a difference gives exactly the reversed difference.)
+		double e_mx = sc_x[m] - ca_x[m];
+		double e_my = sc_y[m] - ca_y[m];
+		double e_mz = sc_z[m] - ca_z[m];
+
+		double xij = (swap ? e_mx : e_nx);
+		double yij = (swap ? e_my : e_ny);
+		double zij = (swap ? e_mz : e_nz);
+		double xkj = (swap ? -vx : vx);
+		double ykj = (swap ? -vy : vy);
+		double zkj = (swap ? -vz : vz);
+		double xkl = -(swap ? e_nx : e_mx);
+		double ykl = -(swap ? e_ny : e_my);
+		double zkl = -(swap ? e_nz : e_mz);
+
+		double dxi = yij * zkj - zij * ykj;
+		double dyi = zij * xkj - xij * zkj;
+		double dzi = xij * ykj - yij * xkj;
+		double gxi = zkj * ykl - ykj * zkl;
+		double gyi = xkj * zkl - zkj * xkl;
+		double gzi = ykj * xkl - xkj * ykl;
+		double ct = (dxi * gxi) + (dyi * gyi) + (dzi * gzi);
+
+		int c1 = 2 - (dp1 > 0.0) - (dp1 > M_SQRT1_2);
+		int c2 = 2 - (dp2 > 0.0) - (dp2 > M_SQRT1_2);
+		int key = c1 * 3 + c2;
+		key = (key == 4 ? 9 + !(ct < 0.0) : key);
+		angle_key[k] = (d < 0.1 ? 0 : key);
+
+		dist_bin[k] = (d < 3.0 ? 0 :
+			(int) std::min(d - 2.0, (double) (ORIENT_DISTS - 1)));
+	}
+
+	// look up the values
+	for (int k = 0;k < num;k++)
+	{
+		int m = first + k;
+
+		if (!(m_usable[n] && m_usable[m]))
+		{
+			out[k] = 0.0;
+			continue;
+		}
+
+		int i = pair_offset(a_n, amino[m]) + dist_bin[k] * ORIENT_ANGLES +
+			Angle_Bin[angle_key[k]];
+		out[k] = (m_use_float ? m_values_float[i] : m_values[i]);
+	}
 }
 
-double Orientation_impl::score(const Peptide& p, bool verbose, bool continuous)
+double Orientation_impl::score(const Peptide& p, bool verbose, bool continuous,
+	const Move_Range *range /*= NULL*/, const Topology *topology /*= NULL*/,
+	const Residue_Geometry *geometry /*= NULL*/)
 {
 	// (does nothing if already loaded)
 	load_data();
 
-	int dist_bin, angle_bin, a1,a2;
-	int r1, r2;
-	double total = 0.0, d;
-	double dp1,dp2;
-	static const double NinetyDeg = deg2rad(90.0);
-	Point ca1,ca2,s1,s2,ca1_ca2;
-	
-	for (int n = p.start() + 2;n <= p.end();n++)
+	if (topology == NULL)
 	{
-		a1 = p.res(n).amino().num();
-		
-		for (int m = p.start(); m < n - 1; m++ )
-		{
-			a2 = p.res(m).amino().num();
+		m_topology.update(p);
+		topology = &m_topology;
+	}
 
-			if ( a1 < a2 )
-			{
-				r1 = n;
-				r2 = m;
-			}
-			else
-			{
-				r1 = m;
-				r2 = n;
-			}
-			
-			if (!(p.atom_exists(r1, Atom_CA) && p.atom_exists(r2, Atom_CA))) continue;
-			if (!(p.atom_exists(r1, Atom_C ) && p.atom_exists(r2, Atom_C ))) continue;
-			if (!(p.get_side_chain_pos(r1, &s1) && p.get_side_chain_pos(r2, &s2))) continue;  
+	if (geometry == NULL)
+	{
+		m_geometry.build(p, *topology);
+		geometry = &m_geometry;
+	}
 
-			ca1 = p.atom_pos2(r1, Atom_CA);
-			ca2 = p.atom_pos2(r2, Atom_CA);
+	double total = 0.0;
 
-			d = ca1.distance(ca2); //sqrt(pow((ca1.x-ca2.x),2)+pow((ca1.y-ca2.y),2)+pow((ca1.z-ca2.z),2));
+	// if possible, reuse the values for residue pairs that were not
+	// affected by the move
+	bool reuse = m_pair_score.begin(p.start(), p.end(),
+		num_residue_pairs(p.end() + 1), range);
 
-			dist_bin = (d < 3.0 ? 0 : (int) (d - 2.0));
-			if (dist_bin >= ORIENT_DISTS) dist_bin = ORIENT_DISTS - 1; // ORIENT_DISTS = 18;
+	get_residues(p, topology, geometry);
 
-			if (d < 0.1)
-				angle_bin = 0;
-			else
-			{
-				ca1_ca2 = (ca2.minus(ca1)).normalised();
-				dp1 = ca1_ca2.dot_product((s1.minus(ca1)).normalised());
-				dp2 = ca1_ca2.negated().dot_product((s2.minus(ca2)).normalised());
-																	// summary of angle values:	
-																	//		
-				if (dp1 > M_SQRT1_2) 	 //(a1 < 45)				// val		a1		a2		torsion
-				{													//
-					if (dp2 > M_SQRT1_2) //(a2 < 45)				//
-						angle_bin = 0;  							//   0		<45		<45
-					else											//
-					{												//
-						if (dp2 > 0) 	 //(a2 < 90)				//
-							angle_bin = 1; 							//   1		<45		45-90
-						else										//
-							angle_bin = 2;							//   2		<45		90+
-					}												//
-				}													//
-				else												//
-				{ 													//
-					if (dp2 > M_SQRT1_2) //(a2 < 45)				//
-					{												//
-						if (dp1 > 0) 	 //(a1 < 90)				//
-							angle_bin = 3;							//   3		45-90	<45
-						else										//
-							angle_bin = 4;							//   4		90+		<45
-					}												//
-					else											//
-					{												//
-						if (!(dp1 > 0 )) //( a1 >= 90)				//
-						{											//
-							if (!(dp2 > 0 )) //(a2 >= 90) 			//
-								angle_bin = 5;						//   5		90+		90+
-							else									//
-								angle_bin = 6;						//   6		90+		45-90
-						}											//
-						else										//
-						{											//
-							if (!(dp2 > 0)) //(a2 >= 90)			//
-								angle_bin = 7;						//   7		45-90	90+	
-							else									//							
-							{										//
-								if ( fabs(torsion_angle(s1, ca1, ca2, s2)) < NinetyDeg )
-									angle_bin = 8;					//   8		45-90	45-90	<90
-								else								//
-									angle_bin = 9;					//   9		45-90	45-90	90+
-							}
-						}
-					}		
-				}
-			}
-//			std::cout << ": " << dist_bin << " " << angle_bin << " " << a1 << " " << a2 << " " << " = " << m_data[dist_bin][angle_bin][a1][a2] << "\n";
-			total += m_data[dist_bin][angle_bin][a1][a2];
+	// (the pairs in each row are next to each other in m_pair_score)
+	int n;
+
+	for (n = p.start() + 2;n <= p.end();n++)
+	{
+		if (!reuse)
+		{
+			score_row(n, p.start(), n - 2,
+				&m_pair_score[residue_pair_index(n, p.start())]);
+		}
+		else
+		if (n >= range->first)
+		{
+			// (the pairs for which range->pair_changed() is true)
+			score_row(n, p.start(), std::min(range->last, n - 2),
+				&m_pair_score[residue_pair_index(n, p.start())]);
 		}
 	}
 
+	for (n = p.start() + 2;n <= p.end();n++)
+	{
+		for (int m = p.start(); m < n - 1; m++ )
+		{
+			total += m_pair_score[residue_pair_index(n, m)];
+		}
+	}
 
     if(1)
     {
@@ -209,3 +392,7 @@ void Orientation_impl::dump(std::ostream &out /*=std::cout*/)
 {
 }
 
+void Orientation_impl::accept()
+{
+	m_pair_score.accept();
+}
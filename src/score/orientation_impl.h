@@ -2,11 +2,17 @@
 #define ORIENTATION_IMPL_H_INCLUDED
 
 #include <iostream>
+#include <vector>
 #include "amino.h"
+#include "score_cache.h"
+#include "topology.h"
+#include "residue_geometry.h"
+#include "potential_file.h"
 
 class Peptide;
 class Residue;
 class Atom;
+struct Move_Range;
 
 /**
  * @brief Orientation Potential.
@@ -17,23 +23,83 @@ public:
 	Orientation_impl();
 	~Orientation_impl();
 
-	// score a peptide (low scores are better)
-	double score(const Peptide& peptide, bool verbose = false, bool continuous = false);
+	// score a peptide (low scores are better). If range is not NULL, the
+	// peptide differs from the conformation last passed to accept() only
+	// as described by range. If topology is not NULL, it must have been
+	// built for the peptide, and if geometry is not NULL, it must be up to
+	// date for the peptide's current conformation.
+	double score(const Peptide& peptide, bool verbose = false, bool continuous = false,
+		const Move_Range *range = NULL, const Topology *topology = NULL,
+		const Residue_Geometry *geometry = NULL);
+
+	// the peptide last scored is now the current conformation
+	void accept();
 
 	// set the name of the orientation data file
 	void set_data_file(const std::string &filename);
 
+	// whether to keep the values as floats (half the memory, but the
+	// scores change slightly)
+	void set_float(bool use_float);
+
 	// dump the values used for scoring
 	void dump(std::ostream &out = std::cout);
 
+	// read an orientation data file (exits with an error message if it
+	// is not valid). The table has dimensions
+	// [ORIENT_DISTS][ORIENT_ANGLES][Amino::Num][Amino::Num].
+	static void read_text(const std::string &filename, Potential_Table *table);
+
 private:
 	void load_data();
 
+	// offset of the values for two amino acids in m_values (the values
+	// for each pair of amino acids are together, in [dist][angle] order)
+	static int pair_offset(int a1, int a2)
+	{ return (a1 * Amino::Num + a2) * (ORIENT_DISTS * ORIENT_ANGLES); }
+
+	// copy the CA positions etc. of residues p.start() .. p.end() into
+	// the arrays below
+	void get_residues(const Peptide &p, const Topology *topology,
+		const Residue_Geometry *geometry);
+
+	// calculate the scores for residue pairs (n, m) for m = first .. last
+	// and store them in out[0 .. last - first] (get_residues() must have
+	// been called)
+	void score_row(int n, int first, int last, double *out);
+
 private:
 	std::string m_filename;		// name of orientation data file
 	bool m_data_loaded;					// whether data has been loaded
 
-	double m_data[ORIENT_DISTS][ORIENT_ANGLES][Amino::Num][Amino::Num];
+	Potential_Table m_table;		// values (see read_text())
+
+	// the values in m_table, rearranged so that the values for each pair
+	// of amino acids are together (see pair_offset()), as doubles or as
+	// floats
+	bool m_use_float;
+	std::vector<double> m_values;
+	std::vector<float> m_values_float;
+
+	// score for each pair of residues (indexed by residue_pair_index())
+	Score_Cache<double> m_pair_score;
+
+	// for each residue: the CA position, the side chain position and the
+	// unit vector from the CA to the side chain, the amino acid, and
+	// whether it has the atoms needed for a score (one array for each
+	// coordinate, so that score_row() can handle several residues at once)
+	std::vector<double> m_ca_x, m_ca_y, m_ca_z;
+	std::vector<double> m_sc_x, m_sc_y, m_sc_z;
+	std::vector<double> m_dir_x, m_dir_y, m_dir_z;
+	std::vector<int> m_amino;
+	std::vector<int> m_usable;
+
+	// (used by score_row())
+	std::vector<int> m_dist_bin;
+	std::vector<int> m_angle_key;
+
+	Topology m_topology;			// used if no topology is passed to score()
+	Residue_Geometry m_geometry;	// used if no geometry is passed to score()
 };
 
 #endif // ORIENTATION_IMPL_H_INCLUDED
@@ -23,8 +23,10 @@
 #include "atom.h"
 #include "scorer_combined.h"
 #include "predss.h"
+#include "move_range.h"
 
 PredSS::PredSS()
+	: m_data_loaded(false)
 {
 }
 
@@ -75,33 +77,55 @@ void PredSS::load_data()
 }
 
 
-double PredSS::score(const Peptide& p, bool verbose) 
+int PredSS::residue_score(const Peptide &p, int n) const
 {
-	load_data();
 	double phi2,psi2;
-	int i;
-	double score=0.0;
 	char SS2;
 
+	phi2 = p.conf().phi(n);
+	psi2 = p.conf().psi(n);
+               
+	phi2 = fmod(phi2*57.29578,360);
+	psi2 = fmod(psi2*57.29578,360);
+
+	if(  (  phi2 > -155 && phi2 < -47 && psi2 > -62 && psi2 < -52) || (phi2 >-104 && phi2 < -47 && psi2 > -52 && psi2 <-37) || (phi2 >-117&&phi2 <-104 && psi2 > -52 && psi2 < -37)  )
+		SS2='H';
+	else 
+	{ 
+		if ( ( phi2 >-155 && phi2 <-138 && psi2 >90 && psi2 < 155) || (phi2 >-140 && phi2 <-64 && psi2 >90 && psi2 <180) || (phi2 >-64 && phi2 <-53 && psi2 >90 && psi2 <168) )
+	 		SS2 = 'E';
+	 	else
+	 	 	SS2 = 'C'; 
+	}
+
+	return (m_data[n] !='C' && m_data[n] != SS2 ? 1 : 0);
+}
+
+double PredSS::score(const Peptide& p, bool verbose,
+	const Move_Range *range /*= NULL*/) 
+{
+	load_data();
+	int i;
+	int count = 0;
+
+	// if possible, reuse the values for residues whose torsion angles
+	// were not changed by the move
+	bool reuse = m_res_score.begin(p.start(), p.end(), p.full_length(),
+		range);
+
 	for (i = p.start(); i <= p.end()-2; i++)
 	{
-		phi2 = p.conf().phi(i+1);
-		psi2 = p.conf().psi(i+1);
-	               
-		phi2 = fmod(phi2*57.29578,360);
-		psi2 = fmod(psi2*57.29578,360);
-
- 		if(  (  phi2 > -155 && phi2 < -47 && psi2 > -62 && psi2 < -52) || (phi2 >-104 && phi2 < -47 && psi2 > -52 && psi2 <-37) || (phi2 >-117&&phi2 <-104 && psi2 > -52 && psi2 < -37)  )
- 			SS2='H';
-		else 
-		{ 
- 			if ( ( phi2 >-155 && phi2 <-138 && psi2 >90 && psi2 < 155) || (phi2 >-140 && phi2 <-64 && psi2 >90 && psi2 <180) || (phi2 >-64 && phi2 <-53 && psi2 >90 && psi2 <168) )
- 		 		SS2 = 'E';
- 		 	else
-		 	 	SS2 = 'C'; 
+		int &s = m_res_score[i+1];
+
+		if (!reuse || range->angles_changed(i+1))
+		{
+			s = residue_score(p, i+1);
 		}
-		if( m_data[i+1] !='C' && m_data[i+1] != SS2 ) score+=1;
+
+		count += s;
 	}
+
+	double score = count;
 #ifndef RAW_SCORE
 	score /= p.end()-2;
 	score = score * 100.0;
@@ -110,3 +134,8 @@ double PredSS::score(const Peptide& p, bool verbose)
 	return score;
 }
 
+void PredSS::accept()
+{
+	m_res_score.accept();
+}
+
@@ -9,7 +9,11 @@
 #ifndef PREDSS_INCLUDED
 #define PREDSS_INCLUDED
 
+#include <string>
+#include "score_cache.h"
+
 class Peptide;
+struct Move_Range;
 /**
  * 
  * Predicted Secondary Structure's Scoring Class:
@@ -27,7 +31,13 @@ public:
 	~PredSS();
 
 	/* This method returns the random Score for the Peptide! */
-	double score(const Peptide& peptide, bool verbose = false);
+	/* (if range is not NULL, only the residues whose torsion angles */
+	/* were changed by the move are recalculated) */
+	double score(const Peptide& peptide, bool verbose = false,
+		const Move_Range *range = NULL);
+
+	// the peptide last scored is now the current conformation
+	void accept();
 
 	// Set the name of the Predicted Secondary Structure data file
 	void set_short_data_file(const std::string &filename);
@@ -35,11 +45,18 @@ public:
 
 private:
 	void load_data();
+
+	// 1 if the secondary structure of residue n (from its torsion
+	// angles) differs from the predicted one, otherwise 0
+	int residue_score(const Peptide &p, int n) const;
 	//
 private:
 	std::string m_filename;
 	bool m_data_loaded;					// whether data has been loaded
 	char m_data[1000];
+
+	// residue_score() for each residue
+	Score_Cache<int> m_res_score;
 };
 
 #endif // PREDSS_INCLUDED
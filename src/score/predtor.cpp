@@ -23,6 +23,7 @@
 #include "atom.h"
 #include "scorer_combined.h"
 #include "predtor.h"
+#include "move_range.h"
 
 PredTor::PredTor()
 {
@@ -86,21 +87,41 @@ void PredTor::load_data(const Peptide& p)
 	fclose(input_file);	
 }
 
-double PredTor::score(const Peptide& p, bool verbose)
+double PredTor::residue_score(const Peptide &p, int n) const
+{
+	double phi2,psi2;
+
+	phi2 = p.conf().phi(n);
+	psi2 = p.conf().psi(n);
+
+	phi2 = fmod(phi2*57.29578,360);
+	psi2 = fmod(psi2*57.29578,360);
+	return abs(phi2 - m_phipsi[0][n]) + abs(psi2 - m_phipsi[1][n]);
+}
+
+double PredTor::score(const Peptide& p, bool verbose,
+	const Move_Range *range /*= NULL*/)
 {
 	load_data(p);
 	int len = p.length();
 	int i;
-	double phi2,psi2,total=0.0;
+	double total=0.0;
+
+	// if possible, reuse the values for residues whose torsion angles
+	// were not changed by the move
+	bool reuse = m_res_score.begin(p.start(), p.end(), p.full_length(),
+		range);
 
         for (i = p.start() ; i <= p.end()-2 ; i++)
         {
-                phi2 = p.conf().phi(i+1);
-                psi2 = p.conf().psi(i+1);
+		double &s = m_res_score[i+1];
+
+		if (!reuse || range->angles_changed(i+1))
+		{
+			s = residue_score(p, i+1);
+		}
 
-                phi2 = fmod(phi2*57.29578,360);
-                psi2 = fmod(psi2*57.29578,360);
-		total += abs(phi2 - m_phipsi[0][i+1]) + abs(psi2 - m_phipsi[1][i+1]);	
+		total += s;
         }
 
 
@@ -117,3 +138,8 @@ double PredTor::score(const Peptide& p, bool verbose)
 	return total;
 }
 
+void PredTor::accept()
+{
+	m_res_score.accept();
+}
+
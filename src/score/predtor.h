@@ -9,7 +9,11 @@
 #ifndef PREDTOR_INCLUDED
 #define PREDTOR_INCLUDED
 
+#include <string>
+#include "score_cache.h"
+
 class Peptide;
+struct Move_Range;
 /**
  * 
  * Predicted Torsion Angle Score: 
@@ -26,7 +30,13 @@ public:
 	~PredTor();
 
 	/* This method returns the random Score for the Peptide! */
-	double score(const Peptide& peptide, bool verbose = false);
+	/* (if range is not NULL, only the residues whose torsion angles */
+	/* were changed by the move are recalculated) */
+	double score(const Peptide& peptide, bool verbose = false,
+		const Move_Range *range = NULL);
+
+	// the peptide last scored is now the current conformation
+	void accept();
 
 	// Set the name of the Predicted Torsion Angle data file
 	void set_short_data_file(const std::string &filename);
@@ -34,12 +44,19 @@ public:
 
 private:
 	void load_data(const Peptide& p);
+
+	// difference between the torsion angles of residue n and the
+	// predicted ones
+	double residue_score(const Peptide &p, int n) const;
 	//
 private:
 	std::string m_filename;
 	bool m_data_loaded;					// whether data has been loaded
 	int m_maxtor;
 	double *m_phipsi[2];
+
+	// residue_score() for each residue
+	Score_Cache<double> m_res_score;
 };
 
 #endif // PREDTOR_INCLUDED
@@ -26,15 +26,22 @@ void RAPDF::set_long_data_file(const std::string &filename)
 	m_long->set_data_file(filename);
 }
 
-double RAPDF::score(const Peptide &p, bool verbose, bool continuous)
+void RAPDF::set_precision(RAPDF_Precision precision)
+{
+	m_short->set_precision(precision);
+	m_long->set_precision(precision);
+}
+
+double RAPDF::score(const Peptide &p, bool verbose, bool continuous,
+	const Topology *topology /*= NULL*/)
 {
 	if (p.length() <= SHORT_PEPTIDE || continuous)
 	{
-		return m_short->score(p, verbose, continuous);
+		return m_short->score(p, verbose, continuous, topology);
 	}
 	else
 	{
-		return m_long->score(p, verbose);
+		return m_long->score(p, verbose, false, topology);
 	}
 }
 
@@ -3,6 +3,7 @@
 
 #include "rapdf.h"
 #include "amino.h"
+#include "rapdf_table.h"
 #include <string>
 #include <vector>
 #include <iostream>
@@ -10,6 +11,7 @@
 // forward declarations
 class Peptide;
 class RAPDF_impl;
+class Topology;
 
 class RAPDF
 {
@@ -21,12 +23,17 @@ public:
 	~RAPDF();
 
 	// score a peptide (low scores ate better)
-	double score(const Peptide &p, bool verbose = false, bool continuous = false);
+	// (if topology is not NULL, it must have been built for the peptide)
+	double score(const Peptide &p, bool verbose = false, bool continuous = false,
+		const Topology *topology = NULL);
 
 	// set the name of the RAPDF data file
 	void set_short_data_file(const std::string &filename);
 	void set_long_data_file(const std::string &filename);
 
+	// set how the RAPDF values are stored (see rapdf_table.h)
+	void set_precision(RAPDF_Precision precision);
+
 private:
     // disable copy and assignment by making them private
 	RAPDF(const RAPDF&);
@@ -3,6 +3,8 @@
 
 #include "rapdf.h"
 #include "amino.h"
+#include "rapdf_table.h"
+#include "topology.h"
 #include <string>
 #include <vector>
 #include <iostream>
@@ -21,11 +23,16 @@ public:
 	~RAPDF_impl();
 
 	// score a peptide (low scores ate better)
-	double score(const Peptide &p, bool verbose = false, bool continuous = false);
+	// (if topology is not NULL, it must have been built for the peptide)
+	double score(const Peptide &p, bool verbose = false, bool continuous = false,
+		const Topology *topology = NULL);
 
 	// set the name of the data file
 	void set_data_file(const std::string &filename);
 
+	// set how the values are stored (before the first score)
+	void set_precision(RAPDF_Precision precision);
+
 private:
     // disable copy and assignment by making them private
 	RAPDF_impl(const RAPDF_impl&);
@@ -37,12 +44,13 @@ private:
 private:
 	std::string m_filename;		// data file
 	bool m_data_loaded;			// whether data has been read
+	RAPDF_Precision m_precision;// how m_table stores the values
 
 	int m_first_bin;			// lowest distance bin
-	int m_top_bin;				// highest index + 1 of m_bin[n1][n2][*]
+	int m_top_bin;				// highest distance bin + 1
 
-	// (dimensions: [NUM_RAPDF_IDS][NUM_RAPDF_IDS][RAPDF_TOP_BIN])
-	double ***m_data;
+	RAPDF_Table m_table;		// values for each pair of RAPDF ids
+	Topology m_topology;		// used if no topology is passed to score()
 };
 
 #endif // RAPDF_IMPL_INCLUDED
@@ -0,0 +1,336 @@
+
+#include <cstdlib>
+#include <cstdio>
+#include <iostream>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+#include "amino.h"
+#include "atom_type.h"
+#include "c_file.h"
+#include "rapdf_table.h"
+
+namespace
+{
+	// alignment of the values (a cache line)
+	const size_t Table_Align = 64;
+
+	// largest value stored for RAPDF_Int16
+	const int Int16_Max = 32767;
+}
+
+RAPDF_Table::RAPDF_Table()
+	: m_first_bin(0), m_top_bin(0), m_num_ids(0),
+	  m_precision(RAPDF_Double), m_max_error(0.0),
+	  m_block(NULL), m_values(NULL), m_base(0.0), m_scale(1.0)
+{
+}
+
+RAPDF_Table::~RAPDF_Table()
+{
+	delete [] m_block;
+}
+
+void RAPDF_Table::load(const std::string &filename,
+	RAPDF_Precision precision, const std::vector<int> *index /*= NULL*/)
+{
+	Potential_Table table;
+
+	if (!Potential_File::read_table(filename, "rapdf", &table))
+	{
+		read_text(filename, &table);
+	}
+
+	// (the dimensions depend on the top bin, so they are checked after it)
+	if (table.params.size() != 2)
+	{
+		std::cerr << "Error: the RAPDF table in " << filename
+			<< " does not have the expected size\n";
+		exit(1);
+	}
+
+	m_first_bin = (int) table.params[0];
+	m_top_bin = (int) table.params[1];
+
+	std::vector<int> dims;
+	dims.push_back(NUM_RAPDF_IDS * (NUM_RAPDF_IDS + 1) / 2);
+	dims.push_back(m_top_bin);
+	table.check(filename, "RAPDF", dims, 2);
+
+	if (m_first_bin < 0 || m_first_bin >= m_top_bin)
+	{
+		std::cerr << "Error: the RAPDF table in " << filename
+			<< " has invalid bins\n";
+		exit(1);
+	}
+
+	int b1, b2, d;
+
+	m_num_ids = 0;
+
+	for (b1 = 0;b1 < NUM_RAPDF_IDS;b1++)
+	{
+		int id = (index == NULL ? b1 : (*index)[b1]);
+
+		if (id >= m_num_ids)
+		{
+			m_num_ids = id + 1;
+		}
+	}
+
+	std::vector<double> val((m_num_ids * (m_num_ids + 1) / 2) * m_top_bin,
+		0.0);
+	const double *file_val = table.values;
+
+	for (b1 = 0;b1 < NUM_RAPDF_IDS;b1++)
+	{
+		int id1 = (index == NULL ? b1 : (*index)[b1]);
+
+		for (b2 = 0;b2 <= b1;b2++, file_val += m_top_bin)
+		{
+			int id2 = (index == NULL ? b2 : (*index)[b2]);
+
+			if (id1 != -1 && id2 != -1)
+			{
+				double *pair_val = &val[pair_offset(id1, id2)];
+
+				for (d = 0;d < m_top_bin;d++)
+				{
+					pair_val[d] = file_val[d];
+				}
+			}
+		}
+	}
+
+	m_precision = precision;
+	store(val);
+
+	if (m_precision != RAPDF_Double)
+	{
+		std::cerr << "Note: RAPDF values from " << filename
+			<< " stored as " << precision_name(m_precision)
+			<< " (maximum error " << m_max_error << ")\n";
+	}
+}
+
+void RAPDF_Table::read_text(const std::string &filename,
+	Potential_Table *table)
+{
+	// exits with error message if file does not exist
+	C_File file(filename, "r", "RAPDF data file");
+
+	static const int Max_Len = 1000;
+	char buffer[Max_Len];
+	int first_bin, top_bin;
+
+	if (!file.next_line(buffer, Max_Len) ||
+		sscanf(buffer, "%d %d", &first_bin, &top_bin) != 2 ||
+		first_bin < 0 || first_bin >= top_bin)
+	{
+		std::cerr << "Error: expected RAPDF data file "
+			<< filename
+			<< " to start with two numbers (first bin, top bin)\n";
+		exit(1);
+	}
+
+	std::vector<int> dims;
+	dims.push_back(NUM_RAPDF_IDS * (NUM_RAPDF_IDS + 1) / 2);
+	dims.push_back(top_bin);
+	table->allocate(dims);
+
+	table->params.clear();
+	table->params.push_back(first_bin);
+	table->params.push_back(top_bin);
+
+	double *pair_val = &table->own_values[0];
+	int b1, b2, d;
+
+	for (b1 = 0;b1 < NUM_RAPDF_IDS;b1++)
+	{
+		std::string b1_aa_str = Amino::rapdf_amino(b1).abbr();
+		std::string b1_a_str = Amino::rapdf_atom(b1).name();
+
+		for (b2 = 0;b2 <= b1;b2++, pair_val += top_bin)
+		{
+			std::string b2_aa_str = Amino::rapdf_amino(b2).abbr();
+			std::string b2_a_str = Amino::rapdf_atom(b2).name();
+
+			char aa1_str[100], a1_str[100];
+			char aa2_str[100], a2_str[100];
+
+			if (!file.next_line(buffer, Max_Len) ||
+				sscanf(buffer, "%s %s %s %s",
+				aa1_str, a1_str, aa2_str, a2_str) != 4 ||
+				std::string(aa1_str) != b1_aa_str ||
+				std::string(a1_str) != b1_a_str ||
+				std::string(aa2_str) != b2_aa_str ||
+				std::string(a2_str) != b2_a_str)
+			{
+				std::cerr << "Error on line " << file.line_num()
+					<< " of " << filename
+					<< ": expected \""
+					<< b1_aa_str << " " << b1_a_str << "  "
+					<< b2_aa_str << " " << b2_a_str << "\"\n";
+				exit(1);
+			}
+
+			int dist;
+			double v;
+
+			for (d = first_bin;d < top_bin;d++)
+			{
+				if (!file.next_line(buffer, Max_Len) ||
+					sscanf(buffer, "%d %lf", &dist, &v) != 2 ||
+					dist != d)
+				{
+					std::cerr << "Error on line " << file.line_num()
+						<< " of " << filename
+						<< ": expected \""
+						<< d
+						<< "\" followed by value\n";
+					exit(1);
+				}
+
+				pair_val[d] = v;
+			}
+
+			for (d = 0;d < first_bin;d++)
+			{
+				pair_val[d] = pair_val[first_bin];
+			}
+		}
+	}
+
+	if (file.next_line(buffer, Max_Len))
+	{
+		std::cerr << "Warning: ignoring extra data on line "
+			<< file.line_num()
+			<< " of "
+			<< filename
+			<< "\n";
+	}
+}
+
+void RAPDF_Table::store(const std::vector<double> &val)
+{
+	size_t size;
+
+	switch (m_precision)
+	{
+		case RAPDF_Float:
+			size = sizeof(float);
+			break;
+		case RAPDF_Int16:
+			size = sizeof(short);
+			break;
+		default:
+			size = sizeof(double);
+			break;
+	}
+
+	// (padded at the end so the CORE kernels can read 4 bytes at a time)
+	delete [] m_block;
+	m_block = new char[val.size() * size + Table_Align + sizeof(int)];
+
+	size_t addr = (size_t) m_block;
+	m_values = m_block + (Table_Align - addr % Table_Align) % Table_Align;
+
+	m_base = 0.0;
+	m_scale = 1.0;
+
+	if (m_precision == RAPDF_Int16 && !val.empty())
+	{
+		double low = val[0];
+		double high = val[0];
+
+		for (size_t n = 1;n < val.size();n++)
+		{
+			if (val[n] < low) { low = val[n]; }
+			if (val[n] > high) { high = val[n]; }
+		}
+
+		m_base = 0.5 * (low + high);
+
+		if (high > low)
+		{
+			m_scale = (high - low) / (2.0 * Int16_Max);
+		}
+	}
+
+	for (size_t n = 0;n < val.size();n++)
+	{
+		switch (m_precision)
+		{
+			case RAPDF_Float:
+				((float *) m_values)[n] = (float) val[n];
+				break;
+			case RAPDF_Int16:
+			{
+				long x = lround((val[n] - m_base) / m_scale);
+
+				if (x > Int16_Max) { x = Int16_Max; }
+				if (x < -Int16_Max) { x = -Int16_Max; }
+
+				((short *) m_values)[n] = (short) x;
+				break;
+			}
+			default:
+				((double *) m_values)[n] = val[n];
+				break;
+		}
+	}
+
+	memset((char *) m_values + val.size() * size, 0, sizeof(int));
+
+	// (found from the values as they are read back, so that it includes
+	// all rounding)
+	m_max_error = 0.0;
+
+	for (int i1 = 0;i1 < m_num_ids;i1++)
+	{
+		for (int i2 = 0;i2 <= i1;i2++)
+		{
+			for (int d = 0;d < m_top_bin;d++)
+			{
+				double err = fabs(value(i1, i2, d) -
+					val[pair_offset(i1, i2) + d]);
+
+				if (err > m_max_error)
+				{
+					m_max_error = err;
+				}
+			}
+		}
+	}
+}
+
+bool RAPDF_Table::parse_precision(const std::string &name,
+	RAPDF_Precision *precision)
+{
+	static const RAPDF_Precision all[] =
+		{ RAPDF_Double, RAPDF_Float, RAPDF_Int16 };
+
+	for (int n = 0;n < 3;n++)
+	{
+		if (name == precision_name(all[n]))
+		{
+			*precision = all[n];
+			return true;
+		}
+	}
+
+	return false;
+}
+
+const char *RAPDF_Table::precision_name(RAPDF_Precision precision)
+{
+	switch (precision)
+	{
+		case RAPDF_Float:
+			return "float";
+		case RAPDF_Int16:
+			return "int16";
+		default:
+			return "double";
+	}
+}
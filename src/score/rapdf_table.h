@@ -0,0 +1,143 @@
+#ifndef RAPDF_TABLE_H_INCLUDED
+#define RAPDF_TABLE_H_INCLUDED
+
+// RAPDF values read from a RAPDF data file, for use by RAPDF and CORE.
+//
+// All values are kept in a single aligned block. Since the value for
+// ids (i1, i2) is the same as for (i2, i1), only pairs with i1 >= i2 are
+// stored, in the order (0,0), (1,0), (1,1), (2,0), ..., with the values
+// for each distance bin of a pair next to each other.
+//
+// The values can also be stored as floats or as 16 bit integers (scaled
+// to cover the range of values in the file), which makes the table two
+// or four times smaller at the cost of some accuracy.
+
+#include <string>
+#include <vector>
+#include "potential_file.h"
+
+// how the values are stored
+enum RAPDF_Precision
+{
+	RAPDF_Double, RAPDF_Float, RAPDF_Int16
+};
+
+class RAPDF_Table
+{
+public:
+	// constructor
+	RAPDF_Table();
+
+	// destructor
+	~RAPDF_Table();
+
+	// read a RAPDF data file or potential file (exits with an error
+	// message if the file is not valid). If index is not NULL, it maps
+	// each RAPDF id in the file to an id in the table (or -1 if the
+	// values for that RAPDF id are not needed); otherwise the table ids
+	// are the RAPDF ids.
+	void load(const std::string &filename, RAPDF_Precision precision,
+		const std::vector<int> *index = NULL);
+
+	// read a RAPDF data file (exits with an error message if it is not
+	// valid). The table has dimensions
+	// [NUM_RAPDF_IDS * (NUM_RAPDF_IDS + 1) / 2][top bin], with the pairs
+	// of RAPDF ids in the same order as in values(), and the parameters
+	// are the first bin and top bin.
+	static void read_text(const std::string &filename, Potential_Table *table);
+
+	// lowest distance bin in the data file (values for lower bins are
+	// the same as for the lowest one)
+	int first_bin() const
+	{ return m_first_bin; }
+
+	// highest distance bin + 1
+	int top_bin() const
+	{ return m_top_bin; }
+
+	// number of table ids
+	int num_ids() const
+	{ return m_num_ids; }
+
+	RAPDF_Precision precision() const
+	{ return m_precision; }
+
+	// largest difference between a stored value and the value in the
+	// data file (0 for RAPDF_Double)
+	double max_error() const
+	{ return m_max_error; }
+
+	// offset in values() of the values for a pair of table ids, found
+	// from the row_offset() of the larger id and col_offset() of the
+	// smaller one
+	int row_offset(int i) const
+	{ return (i * (i + 1) / 2) * m_top_bin; }
+
+	int col_offset(int i) const
+	{ return i * m_top_bin; }
+
+	int pair_offset(int i1, int i2) const
+	{
+		return (i1 >= i2 ? row_offset(i1) + col_offset(i2)
+						 : row_offset(i2) + col_offset(i1));
+	}
+
+	// the stored values (double, float or short, depending on
+	// precision()). A value is found from the stored number x as
+	// (base() + scale() * x) for RAPDF_Int16, or just x otherwise.
+	// (The block is padded so that 4 bytes can be read at any value.)
+	const void *values() const
+	{ return m_values; }
+
+	double base() const
+	{ return m_base; }
+
+	double scale() const
+	{ return m_scale; }
+
+	// get the value for a pair of table ids and a distance bin
+	double value(int i1, int i2, int bin) const
+	{
+		int n = pair_offset(i1, i2) + bin;
+
+		switch (m_precision)
+		{
+			case RAPDF_Float:
+				return ((const float *) m_values)[n];
+			case RAPDF_Int16:
+				return m_base + m_scale * ((const short *) m_values)[n];
+			default:
+				return ((const double *) m_values)[n];
+		}
+	}
+
+	// get the precision with the given name ("double", "float" or
+	// "int16"). Returns false if the name is not recognised.
+	static bool parse_precision(const std::string &name,
+		RAPDF_Precision *precision);
+
+	// get the name of a precision
+	static const char *precision_name(RAPDF_Precision precision);
+
+private:
+    // disable copy and assignment by making them private
+	RAPDF_Table(const RAPDF_Table&);
+	RAPDF_Table &operator = (const RAPDF_Table&);
+
+	// store the values read from the file
+	void store(const std::vector<double> &val);
+
+private:
+	int m_first_bin;
+	int m_top_bin;
+	int m_num_ids;
+	RAPDF_Precision m_precision;
+	double m_max_error;
+
+	char *m_block;				// allocated memory
+	void *m_values;				// (aligned) start of values in m_block
+	double m_base;
+	double m_scale;
+};
+
+#endif // RAPDF_TABLE_H_INCLUDED
@@ -0,0 +1,104 @@
+
+#include <cstdlib>
+#include <cstdio>
+#include <iostream>
+#include "restraint_list.h"
+
+Restraint_List::Restraint_List()
+	: m_loaded(false)
+{
+}
+
+void Restraint_List::clear()
+{
+	m_loaded = false;
+	m_res1.clear();
+	m_res2.clear();
+	m_weight.clear();
+}
+
+void Restraint_List::add(int r1, int r2, int weight)
+{
+	m_res1.push_back(r1);
+	m_res2.push_back(r2);
+	m_weight.push_back(weight);
+}
+
+bool Restraint_List::read_map(const std::string &filename)
+{
+	clear();
+
+	FILE *input_file = fopen(filename.c_str(), "r");
+
+	if (input_file == NULL)
+	{
+		return false;
+	}
+
+	int len;
+
+	if (fscanf(input_file, "%d", &len) != 1 || len < 0)
+	{
+		len = 0;
+	}
+
+	// (the whole map is only needed while it is being read)
+	std::vector<int> map(len * len);
+	int i, j;
+
+	for (i = 0;i < len;i++)
+	{
+		for (j = 0;j < len;j++)
+		{
+			if (fscanf(input_file, "%d", &map[i * len + j]) != 1)
+			{
+				map[i * len + j] = 0;
+			}
+		}
+	}
+
+	fclose(input_file);
+
+	for (i = 1;i < len;i++)
+	{
+		for (j = 0;j < i;j++)
+		{
+			int weight = (map[i * len + j] != 0) + (map[j * len + i] != 0);
+
+			if (weight != 0)
+			{
+				add(i, j, weight);
+			}
+		}
+	}
+
+	m_loaded = true;
+	return true;
+}
+
+void Restraint_List::read_list(const std::string &filename, double min_prob)
+{
+	clear();
+
+	FILE *input_file = fopen(filename.c_str(), "r");
+
+	if (input_file == NULL)
+	{
+		std::cerr << "Predicted Contacts File not found !\n";
+		exit(1);
+	}
+
+	int i, j;
+	double prob;
+
+	while (fscanf(input_file, "%d %d %lf", &i, &j, &prob) == 3)
+	{
+		if (prob > min_prob)
+		{
+			add(i - 1, j - 1, 1);
+		}
+	}
+
+	fclose(input_file);
+	m_loaded = true;
+}
@@ -0,0 +1,67 @@
+#ifndef RESTRAINT_LIST_H_INCLUDED
+#define RESTRAINT_LIST_H_INCLUDED
+
+// Predicted contacts between pairs of residues, read from a file once and
+// kept as a list, so that a score term based on them only needs to look at
+// the pairs of residues that are in the list.
+//
+// Residue numbers start from 0.
+
+#include <string>
+#include <vector>
+
+class Restraint_List
+{
+public:
+	// constructor
+	Restraint_List();
+
+	// read a contact map: the number of residues N followed by N x N
+	// numbers, where the number in row i, column j is nonzero if residues
+	// i and j are predicted to be in contact. Each pair of residues i > j
+	// that is in contact is stored once (in order of i, then j), with a
+	// weight of 2 if both (i, j) and (j, i) are nonzero, or 1 otherwise.
+	// Returns false if the file could not be opened.
+	bool read_map(const std::string &filename);
+
+	// read a list of contacts, one per line: "i j probability", where i
+	// and j are residue numbers starting from 1. Contacts with a
+	// probability of more than min_prob are stored in the same order as
+	// in the file, with a weight of 1. Exits with an error message if the
+	// file could not be opened.
+	void read_list(const std::string &filename, double min_prob);
+
+	// whether a file has been read
+	bool loaded() const
+	{ return m_loaded; }
+
+	// remove all restraints (so that loaded() is false)
+	void clear();
+
+	// number of restraints
+	int size() const
+	{ return (int) m_res1.size(); }
+
+	// the residues restraint k is between
+	int res1(int k) const
+	{ return m_res1[k]; }
+
+	int res2(int k) const
+	{ return m_res2[k]; }
+
+	// number of times restraint k appears in the file
+	int weight(int k) const
+	{ return m_weight[k]; }
+
+private:
+	// add a restraint
+	void add(int r1, int r2, int weight);
+
+private:
+	bool m_loaded;
+	std::vector<int> m_res1;
+	std::vector<int> m_res2;
+	std::vector<int> m_weight;
+};
+
+#endif // RESTRAINT_LIST_H_INCLUDED
@@ -17,7 +17,9 @@
 #include <cmath>
 #include <iostream>
 #include <fstream>
+#include <algorithm>
 
+#include "common.h"
 #include "peptide.h"
 #include "atom.h"
 #include "atom_id.h"
@@ -32,14 +34,86 @@ Rgyr::~Rgyr()
 {
 }
 
-double Rgyr::score(const Peptide& p, bool verbose) const
+Rgyr::Moments Rgyr::block_moments(int b, int start, int end,
+	const Topology *topology, const Residue_Geometry *geometry) const
+{
+	Moments m;
+	int last = std::min(start + (b + 1) * Block_Size - 1, end);
+
+	for (int n = start + b * Block_Size;n <= last;n++)
+	{
+		if (topology->atom_exists(n, Atom_CA))
+		{
+			const Point &ca = geometry->ca(n);
+			m.num++;
+			m.x += ca.x;
+			m.y += ca.y;
+			m.z += ca.z;
+			m.sq += square(ca.x) + square(ca.y) + square(ca.z);
+		}
+	}
+
+	return m;
+}
+
+double Rgyr::score(const Peptide& p, bool verbose,
+	const Move_Range *range /*= NULL*/, const Topology *topology /*= NULL*/,
+	const Residue_Geometry *geometry /*= NULL*/)
 {
 	double total=0.0;
 
 //	total = pow(p.radius_of_gyr() - (1.484*pow(len,0.4)+5.33333), 2 )  ;
-	if(p.length() > 50)
-		total = p.radius_of_gyr();
+	if(p.length() <= 50)
+		return total;
+
+	if (topology == NULL)
+	{
+		m_topology.update(p);
+		topology = &m_topology;
+	}
+
+	if (geometry == NULL)
+	{
+		m_geometry.build(p, *topology);
+		geometry = &m_geometry;
+	}
+
+	// the same value as p.radius_of_gyr() (apart from rounding), from
+	// the moments of each block; only the blocks containing residues
+	// that were moved need to be recalculated
+	int num_blocks = (p.end() - p.start() + Block_Size) / Block_Size;
+	bool reuse = m_block.begin(p.start(), p.end(), num_blocks, range);
+	Moments sum;
+
+	for (int b = 0;b < num_blocks;b++)
+	{
+		int first = p.start() + b * Block_Size;
+		int last = std::min(first + Block_Size - 1, p.end());
+
+		if (!reuse || range->moved(range->before_moved ? first : last))
+		{
+			m_block[b] = block_moments(b, p.start(), p.end(), topology,
+				geometry);
+		}
+
+		const Moments &m = m_block[b];
+		sum.num += m.num;
+		sum.x += m.x;
+		sum.y += m.y;
+		sum.z += m.z;
+		sum.sq += m.sq;
+	}
+
+	double pairs = sum.num * sum.sq -
+		(square(sum.x) + square(sum.y) + square(sum.z));
+	total = sqrt(std::max(pairs, 0.0) /
+		(0.5 * sum.num * (sum.num - 1.0)));
 
 	return total;
 }
 
+void Rgyr::accept()
+{
+	m_block.accept();
+}
+
@@ -9,7 +9,12 @@
 #ifndef RGYR_INCLUDED
 #define RGYR_INCLUDED
 
+#include "score_cache.h"
+#include "topology.h"
+#include "residue_geometry.h"
+
 class Peptide;
+struct Move_Range;
 /**
  * 
  * A scoring class that calculates the Radius of gyration (Rg) of the growing peptide 
@@ -26,7 +31,46 @@ public:
 	~Rgyr();
 
 	/* This method returns the random Score for the Peptide! */
-	double score(const Peptide& peptide, bool verbose = false) const;
+	/* (if range is not NULL, only the blocks of residues that were */
+	/* moved are recalculated; see Scorer::score_delta()) */
+	/* (if topology is not NULL, it must have been built for the peptide, */
+	/* and if geometry is not NULL, it must be up to date for the */
+	/* peptide's current conformation) */
+	double score(const Peptide& peptide, bool verbose = false,
+		const Move_Range *range = NULL, const Topology *topology = NULL,
+		const Residue_Geometry *geometry = NULL);
+
+	// the peptide last scored is now the current conformation
+	void accept();
+
+private:
+	// Sums over the C-alphas in a block of residues, from which the
+	// radius of gyration is found without looking at every pair:
+	//
+	//	sum over pairs |p_i - p_j|^2 = num * sum |p_i|^2 - |sum p_i|^2
+	struct Moments
+	{
+		int num;				// number of C-alphas
+		double x, y, z;			// sum of the positions
+		double sq;				// sum of the squared lengths
+
+		Moments() : num(0), x(0.0), y(0.0), z(0.0), sq(0.0)
+		{ }
+	};
+
+	// number of residues in each block
+	static const int Block_Size = 16;
+
+	// the moments of block b
+	Moments block_moments(int b, int start, int end,
+		const Topology *topology, const Residue_Geometry *geometry) const;
+
+private:
+	// moments for each block of residues
+	Score_Cache<Moments> m_block;
+
+	Topology m_topology;			// used if no topology is passed to score()
+	Residue_Geometry m_geometry;	// used if no geometry is passed to score()
 };
 
 #endif // Rgyr_INCLUDED
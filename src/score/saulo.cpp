@@ -13,8 +13,8 @@
 #include <string>
 #include <cstdlib>
 #include <cstdio>
-#include <cstring>
 #include <cmath>
+#include <cassert>
 #include <iostream>
 #include <fstream>
 #include "amino.h"
@@ -23,10 +23,10 @@
 #include "atom.h"
 #include "scorer_combined.h"
 #include "saulo.h"
+#include "move_range.h"
 
 Saulo::Saulo()
 {
-	m_data_loaded=false;
 }
 
 Saulo::~Saulo()
@@ -43,13 +43,9 @@ void Saulo::set_long_data_file(const std::string &filename)
 	m_filename  = filename;
 }
 
-void Saulo::load_data(const Peptide& p)
+void Saulo::load_data()
 {
-	FILE *input_file; 
-	int i,j,con;
-	double scr;
-
-	if (m_data_loaded)
+	if (m_contacts.loaded())
 	{
 		return;
 	}
@@ -60,72 +56,65 @@ void Saulo::load_data(const Peptide& p)
 		exit(1);
 	}
 
-	input_file = fopen(m_filename.c_str(),"r");
+	// (contacts with a probability of 0.5 or less are ignored)
+	m_contacts.read_list(m_filename, 0.5);
+}
+
+double Saulo::score(const Peptide& p, bool verbose,
+	const Move_Range *range /*= NULL*/, const Topology *topology /*= NULL*/,
+	const Residue_Geometry *geometry /*= NULL*/)
+{
+	load_data();
 
-	if (input_file == NULL)
+	if (topology == NULL)
 	{
-		std::cerr << "Predicted Contacts File not found !\n";
-		exit(1);
+		m_topology.update(p);
+		topology = &m_topology;
 	}
 
-	m_con[0] = (int *)malloc(sizeof(int)*5000);
-	m_con[1] = (int *)malloc(sizeof(int)*5000);
-
-	for (con=0;fscanf(input_file,"%d %d %lf",&i,&j,&scr) != EOF ; con++)
+	if (geometry == NULL)
 	{
-		if(scr>0.5)
-		{	
-			m_con[0][con]=i;
-			m_con[1][con]=j;
-		}
-		else
-			con--;
+		m_geometry.build(p, *topology);
+		geometry = &m_geometry;
 	}
-	
-	num_con=con;
-
-    m_previous_len = 0;
-    // p.alloc_satisfied_con (num_con);
-	m_data_loaded = true;
-	fclose(input_file);	
-}
-
-double Saulo::score(const Peptide& p, bool verbose)
-{
-	load_data(p);
 
 	int len = p.length();
+	int num_con = m_contacts.size();
 	int i,j,k;
 
 	double total=0.0;
-	Point cb_i, cb_j;
+
+	// if possible, reuse the values for contacts whose residues were
+	// not moved relative to each other
+	bool reuse = m_con_score.begin(p.start(), p.end(), num_con, range);
 
     /* Main loop */
 	for (k=0;k<num_con;k++)
 	{
-		i = m_con[0][k]; 	j=m_con[1][k];
+		i = m_contacts.res1(k); 	j = m_contacts.res2(k);
 
-		if( i-1 >= p.start() &&  i-1 <= p.end() && j-1 <= p.end() && j-1 >= p.start() )
+		if (reuse && !range->pair_changed(i, j))
 		{
-			if(std::strcmp(p.res(i-1).amino().abbr(),"GLY") == 0)
-			{
-				cb_i = p.atom_pos(i-1, Atom_CA);				
-			}
-			else
-				cb_i = p.atom_pos(i-1, Atom_CB);				
+			total += m_con_score[k];
+			continue;
+		}
 
-			if(!std::strcmp(p.res(j-1).amino().abbr(),"GLY"))
-			{
-				cb_j = p.atom_pos(j-1, Atom_CA);				
-			}
-			else
-				cb_j = p.atom_pos(j-1, Atom_CB);				
+		m_con_score[k] = 0.0;
+
+		if( i >= p.start() &&  i <= p.end() && j <= p.end() && j >= p.start() )
+		{
+			// (CA for glycine)
+			assert(geometry->has_cb_ca(i) && geometry->has_cb_ca(j));
+			const Point &cb_i = geometry->cb_ca(i);
+			const Point &cb_j = geometry->cb_ca(j);
 
 			if ( cb_i.distance(cb_j) > 8.0) /* They are predicted to be contacts, but are far away in the model! */
 			{
-				total += cb_i.distance(cb_j) - 8.0;
+				m_con_score[k] = cb_i.distance(cb_j) - 8.0;
 			}
          }
+
+		total += m_con_score[k];
 	}
 
 #ifndef RAW_SCORE
@@ -139,3 +128,7 @@ double Saulo::score(const Peptide& p, bool verbose)
 	return total;
 }
 
+void Saulo::accept()
+{
+	m_con_score.accept();
+}
@@ -9,7 +9,14 @@
 #ifndef SAULO_INCLUDED
 #define SAULO_INCLUDED
 
+#include <string>
+#include "score_cache.h"
+#include "topology.h"
+#include "residue_geometry.h"
+#include "restraint_list.h"
+
 class Peptide;
+struct Move_Range;
 /**
  * 
  * Saulo's Scoring Class is a very intuitive class:
@@ -26,20 +33,34 @@ public:
 	~Saulo();
 
 	/* This method returns the random Score for the Peptide! */
-	double score(const Peptide& peptide, bool verbose = false);
+	/* (if range is not NULL, only the contacts affected by the move */
+	/* are recalculated; see Scorer::score_delta()) */
+	/* (if topology is not NULL, it must have been built for the peptide, */
+	/* and if geometry is not NULL, it must be up to date for the */
+	/* peptide's current conformation) */
+	double score(const Peptide& peptide, bool verbose = false,
+		const Move_Range *range = NULL, const Topology *topology = NULL,
+		const Residue_Geometry *geometry = NULL);
+
+	// the peptide last scored is now the current conformation
+	void accept();
 
 	// Set the name of the Contact Map data file
 	void set_short_data_file(const std::string &filename);
 	void set_long_data_file(const std::string &filename);
 
 private:
-	void load_data(const Peptide& p);
+	void load_data();
 	//
 private:
 	std::string m_filename;
-	bool m_data_loaded;					// whether data has been loaded
-	int *m_con[2],num_con;
-    int m_previous_len;
+	Restraint_List m_contacts;			// predicted contacts
+
+	// score for each contact
+	Score_Cache<double> m_con_score;
+
+	Topology m_topology;		// used if no topology is passed to score()
+	Residue_Geometry m_geometry;// used if no geometry is passed to score()
 };
 
 #endif // SAULO_INCLUDED
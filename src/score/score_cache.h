@@ -0,0 +1,121 @@
+#ifndef SCORE_CACHE_H_INCLUDED
+#define SCORE_CACHE_H_INCLUDED
+
+// Stores the individual contributions (eg. one per pair of residues)
+// that make up a score term, so that after a move only the contributions
+// affected by the move need to be recalculated.
+//
+// Two sets of values are kept: the "current" values (for the conformation
+// the Runner is currently at) and the "trial" values (for the last
+// conformation scored). accept() makes the trial values current.
+//
+// Usage in a score term:
+//
+//	bool reuse = m_cache.begin(p.start(), p.end(), num_values, range);
+//
+//	for (each value i)
+//	{
+//		if (!reuse || <value i may have been changed by the move>)
+//		{
+//			m_cache[i] = <calculate value i>;
+//		}
+//
+//		total += m_cache[i];
+//	}
+//
+// Since the values are always added up in the same order, the total only
+// differs from a full recalculation by floating point rounding (residues
+// that were moved as a rigid body do not keep exactly the same distances).
+
+#include <vector>
+#include "move_range.h"
+
+template <class T>
+class Score_Cache
+{
+public:
+	Score_Cache() :
+		m_curr_start(0), m_curr_end(-1), m_trial_start(0), m_trial_end(-1),
+		m_curr_valid(false), m_trial_valid(false)
+	{
+	}
+
+	// Prepare the trial values for scoring a peptide containing residues
+	// start .. end, requiring "num" values. If "range" is not NULL and the
+	// current values were calculated for the same residues, the current
+	// values are copied and true is returned (only values affected by the
+	// move need to be recalculated). Otherwise returns false, in which case
+	// all values must be calculated.
+	bool begin(int start, int end, int num, const Move_Range *range)
+	{
+		bool reuse = (range != NULL && m_curr_valid &&
+			start == m_curr_start && end == m_curr_end &&
+			(int) m_curr.size() == num);
+
+		if (reuse)
+		{
+			m_trial = m_curr;
+		}
+		else
+		{
+			m_trial.resize(num);
+		}
+
+		m_trial_start = start;
+		m_trial_end = end;
+		m_trial_valid = true;
+		return reuse;
+	}
+
+	// trial value i
+	T &operator [] (int i)
+	{ return m_trial[i]; }
+
+	// current value i
+	const T &current(int i) const
+	{ return m_curr[i]; }
+
+	// whether the current values are for residues start .. end
+	bool current_valid(int start, int end) const
+	{ return m_curr_valid && start == m_curr_start && end == m_curr_end; }
+
+	// make the trial values the current values
+	void accept()
+	{
+		if (m_trial_valid)
+		{
+			m_curr.swap(m_trial);
+			m_curr_start = m_trial_start;
+			m_curr_end = m_trial_end;
+			m_curr_valid = true;
+			m_trial_valid = false;
+		}
+	}
+
+	// forget all stored values
+	void clear()
+	{
+		m_curr_valid = m_trial_valid = false;
+	}
+
+private:
+	std::vector<T> m_curr, m_trial;
+	int m_curr_start, m_curr_end;
+	int m_trial_start, m_trial_end;
+	bool m_curr_valid, m_trial_valid;
+};
+
+// index of the pair of residues (n, m), where n > m, in a triangular
+// array of all pairs
+inline int residue_pair_index(int n, int m)
+{
+	return n * (n - 1) / 2 + m;
+}
+
+// number of residue pairs in a triangular array for residues 0 .. num - 1
+inline int num_residue_pairs(int num)
+{
+	return num * (num - 1) / 2;
+}
+
+#endif // SCORE_CACHE_H_INCLUDED
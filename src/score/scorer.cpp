@@ -28,6 +28,31 @@ Scorer::~Scorer()
 {
 }
 
+double Scorer::score_delta(const Peptide &p, const Move_Range & /*range*/,
+	double progress /*= 1.0*/, double *progress1_score /*= NULL*/,
+	Score_Limit *limit /*= NULL*/)
+{
+	return score(p, progress, progress1_score, limit);
+}
+
+void Scorer::accept_last_scored()
+{
+}
+
+void Scorer::coarse_begin(const Peptide & /*p*/)
+{
+}
+
+double Scorer::coarse_score(const Peptide & /*p*/,
+	const Move_Range * /*range*/)
+{
+	return 0.0;
+}
+
+void Scorer::print_run_stats(std::ostream & /*out*/)
+{
+}
+
 void Scorer::print_info_when_scoring(bool info_on)
 {
 	m_score_info_on = info_on;
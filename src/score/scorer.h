@@ -17,6 +17,31 @@
 
 // forward declarations
 class Peptide;
+struct Move_Range;
+
+// Tells a scorer when it can stop scoring a candidate, because the
+// candidate will be rejected whatever the rest of its score turns out to
+// be (see Strategy::reject_threshold()).
+
+class Score_Limit
+{
+public:
+	virtual ~Score_Limit()
+	{ }
+
+	// Given that the candidate's score is known to be at least min_score,
+	// returns a value t. If min_score > t, the candidate will be rejected,
+	// so it does not need to be scored any further. Otherwise scoring
+	// should continue, and threshold() should be called again once the
+	// score is known to be more than t.
+	virtual double threshold(double min_score) = 0;
+
+	// Sets *t to the value threshold(min_score) would return, if that is
+	// known without changing anything (eg. without the strategy drawing a
+	// random number); otherwise returns false.
+	virtual bool known_threshold(double min_score, double *t)
+	{ return false; }
+};
 
 class Scorer
 {
@@ -40,12 +65,49 @@ public:
 	virtual void verify_parameters() = 0;
 
 	// score a peptide (low scores ate better)
+	//
+	// If limit is not NULL, scoring may stop as soon as the limit shows
+	// that the peptide will be rejected, in which case HUGE_VAL is
+	// returned (and the peptide must not be passed to
+	// accept_last_scored()).
 	virtual double score(const Peptide &p, double progress = 1.0,
-		double *progress1_score = NULL) = 0;
+		double *progress1_score = NULL, Score_Limit *limit = NULL) = 0;
+
+	// score a peptide that differs from the conformation last passed to
+	// accept_last_scored() only as described by range (see move_range.h).
+	// Subclasses that keep the contributions to each term from the
+	// current conformation only need to recalculate the ones affected
+	// by the move; the result is the same as calling score().
+	// The default implementation just calls score().
+	virtual double score_delta(const Peptide &p, const Move_Range &range,
+		double progress = 1.0, double *progress1_score = NULL,
+		Score_Limit *limit = NULL);
+
+	// the peptide passed to the last call to score() or score_delta()
+	// is now the current conformation (eg. the move was accepted), so
+	// later calls to score_delta() are relative to it
+	virtual void accept_last_scored();
+
+	// prepare for coarse_score(): p is the current conformation (the one
+	// last passed to accept_last_scored())
+	virtual void coarse_begin(const Peptide &p);
+
+	// A cheap estimate of the change in score between the conformation
+	// passed to coarse_begin() and p (which differs from it only as
+	// described by range, if range is not NULL). It is only roughly in
+	// the same order as the full score, and is used to decide which of
+	// several candidates are worth scoring in full.
+	// The default implementation returns 0.
+	virtual double coarse_score(const Peptide &p, const Move_Range *range);
 
 	// print a brief description of the type of scoring
 	virtual void print_desc(std::ostream &out = std::cout) = 0;
 
+	// print any statistics collected while scoring during the current
+	// run, and start collecting them again for the next one
+	// The default implementation does nothing.
+	virtual void print_run_stats(std::ostream &out);
+
 	// print template config file section
 	static void print_template(std::ostream &out);
 
@@ -4,6 +4,7 @@
 #include <cstdlib>
 #include <iostream>
 #include <cassert>
+#include <algorithm>
 #include "scorer_combined.h"
 #include "common.h"
 #include "atom.h"
@@ -25,6 +26,11 @@
 #include "orientation.h"
 #include "lennard_jones.h"
 #include "ribosome.h"
+#include "neighbour_grid.h"
+#include "topology.h"
+#include "residue_geometry.h"
+#include "coarse.h"
+#include "thread_pool.h"
 
 
 // static data members
@@ -50,6 +56,15 @@ const char *Scorer_Combined::c_score_name[SC_NUM] =
 };
 
 const char *Scorer_Combined::c_param_raw_scores = "raw_scores";
+const char *Scorer_Combined::c_param_incremental = "incremental";
+const char *Scorer_Combined::c_param_early_rejection = "early_rejection";
+const char *Scorer_Combined::c_param_neighbour_skin = "neighbour_skin";
+const char *Scorer_Combined::c_param_core_kernel = "core_kernel";
+const char *Scorer_Combined::c_param_rapdf_precision = "rapdf_precision";
+const char *Scorer_Combined::c_param_pair_potential = "pair_potential";
+const char *Scorer_Combined::c_param_score_precision = "score_precision";
+const char *Scorer_Combined::c_param_precision_check = "precision_check";
+const char *Scorer_Combined::c_param_threads = "threads";
 
 const char *Scorer_Combined::c_param_filename[SC_NUM] =
 {
@@ -130,6 +145,25 @@ const char *Scorer_Combined::c_param_short_weight[SC_NUM] =
 
 
 const bool Scorer_Combined::c_default_raw_scores             = false;
+const bool Scorer_Combined::c_default_incremental            = true;
+const bool Scorer_Combined::c_default_early_rejection         = true;
+const double Scorer_Combined::c_default_neighbour_skin         = 0.0;
+const char *Scorer_Combined::c_default_core_kernel            = "auto";
+const char *Scorer_Combined::c_default_rapdf_precision        = "double";
+const char *Scorer_Combined::c_default_pair_potential         = "analytic";
+const char *Scorer_Combined::c_default_score_precision        = "double";
+const bool Scorer_Combined::c_default_precision_check         = false;
+const int Scorer_Combined::c_default_threads                  = 0;
+
+Scorer_Combined::Precision_Stats::Precision_Stats() :
+	scores(0), decisions(0), decisions_differ(0)
+{
+	for (int n = 0;n <= SC_NUM;n++)
+	{
+		// (-1 means the term has not been compared)
+		max_abs[n] = max_rel[n] = -1.0;
+	}
+}
 
 
 Scorer_Combined::Scorer_Combined()
@@ -149,7 +183,25 @@ Scorer_Combined::Scorer_Combined()
 	m_torsion = new Torsion;
 	m_predtor = new PredTor;
 	m_ribosome = new Ribosome;
+	m_grid = new Neighbour_Grid;
+	m_topology = new Topology;
+	m_geometry = new Residue_Geometry;
+	m_pool = NULL;
+	m_coarse = new Coarse;
+	m_coarse_contacts_set = false;
+	m_plan_valid = false;
     m_raw_scores = c_default_raw_scores;
+	m_incremental = c_default_incremental;
+	m_early_rejection = c_default_early_rejection;
+	m_neighbour_skin = c_default_neighbour_skin;
+	m_core_kernel = c_default_core_kernel;
+	m_tabulated = (std::string(c_default_pair_potential) == "tabulated");
+	m_float = (std::string(c_default_score_precision) == "float");
+	m_rapdf_precision = RAPDF_Double;
+	m_rapdf_precision_set = false;
+	m_table_precision = RAPDF_Double;
+	m_precision_check = c_default_precision_check;
+	m_check = NULL;
 
 	for (int n = 0;n < SC_NUM;n++)
 	{
@@ -170,11 +222,17 @@ Scorer_Combined::~Scorer_Combined()
 	delete m_predss;
 	delete m_rgyr;
 	delete m_contact;
+	delete m_grid;
+	delete m_topology;
+	delete m_geometry;
+	delete m_coarse;
 	delete m_crowding;
 	delete m_randomscr;
 	delete m_torsion;
 	delete m_predtor;
 	delete m_ribosome;
+	delete m_check;
+	delete m_pool;
 }
 
 bool Scorer_Combined::parse_parameter(const std::string &name,
@@ -184,6 +242,8 @@ bool Scorer_Combined::parse_parameter(const std::string &name,
 	full_name += " ";
 	full_name += name;
 
+	m_params.push_back(std::make_pair(name, value));
+
 	for (int n = 0;n < SC_NUM;n++)
 	{
 		if (name == c_param_filename[n])
@@ -264,6 +324,7 @@ bool Scorer_Combined::parse_parameter(const std::string &name,
 
 		if (name == c_param_weight[n])
 		{
+			m_plan_valid = false;
 			m_weight[n] = parse_double(value, full_name);
 			if (n == SC_RIBO)
 			{
@@ -275,6 +336,7 @@ bool Scorer_Combined::parse_parameter(const std::string &name,
 
 		if (name == c_param_short_weight[n])
 		{
+			m_plan_valid = false;
 			m_short_weight[n] = parse_double(value, full_name);
 			return true;
 		}
@@ -284,6 +346,99 @@ bool Scorer_Combined::parse_parameter(const std::string &name,
         m_raw_scores = parse_bool(value, full_name);
         return true;
     }
+	if (name == c_param_incremental)
+	{
+		m_incremental = parse_bool(value, full_name);
+		return true;
+	}
+	if (name == c_param_early_rejection)
+	{
+		m_early_rejection = parse_bool(value, full_name);
+		return true;
+	}
+	if (name == c_param_neighbour_skin)
+	{
+		m_neighbour_skin = parse_double(value, full_name);
+
+		if (m_neighbour_skin < 0.0)
+		{
+			std::cerr << "Error: " << full_name
+				<< " cannot be negative\n";
+			exit(1);
+		}
+
+		return true;
+	}
+	if (name == c_param_core_kernel)
+	{
+		Core_Pair_Kernel kernel = core_pair_kernel(value);
+
+		if (kernel == NULL)
+		{
+			std::cerr << "Error: " << full_name << " must be auto, "
+				"scalar, table, avx2 or avx512 (and supported by this "
+				"processor)\n";
+			exit(1);
+		}
+
+		m_core_kernel = value;
+		return true;
+	}
+	if (name == c_param_rapdf_precision)
+	{
+		RAPDF_Precision precision;
+
+		if (!RAPDF_Table::parse_precision(value, &precision))
+		{
+			std::cerr << "Error: " << full_name
+				<< " must be double, float or int16\n";
+			exit(1);
+		}
+
+		m_rapdf_precision = precision;
+		m_rapdf_precision_set = true;
+		return true;
+	}
+	if (name == c_param_pair_potential)
+	{
+		if (value != "analytic" && value != "tabulated")
+		{
+			std::cerr << "Error: " << full_name
+				<< " must be analytic or tabulated\n";
+			exit(1);
+		}
+
+		m_tabulated = (value == "tabulated");
+		return true;
+	}
+	if (name == c_param_score_precision)
+	{
+		if (value != "double" && value != "float")
+		{
+			std::cerr << "Error: " << full_name
+				<< " must be double or float\n";
+			exit(1);
+		}
+
+		// (coordinates and totals are always doubles; only the largest
+		// tables of values are affected)
+		m_float = (value == "float");
+		return true;
+	}
+	if (name == c_param_threads)
+	{
+		int threads = parse_integer(value, full_name, 0);
+
+		delete m_pool;
+		m_pool = (threads == 0 ? NULL : new Thread_Pool(threads));
+		m_core->set_thread_pool(m_pool);
+		return true;
+	}
+	if (name == c_param_precision_check)
+	{
+		m_precision_check = parse_bool(value, full_name);
+		return true;
+	}
 
 	return false;
 }
@@ -291,6 +446,7 @@ bool Scorer_Combined::parse_parameter(const std::string &name,
 void Scorer_Combined::set_long_weight(Score_Term s, double val)
 {
 	m_weight[s] = val;
+	m_plan_valid = false;
 
 	// short and long weight are always the same for the ribosome
 	if (s == SC_RIBO) { m_short_weight[s] = val; }
@@ -299,13 +455,102 @@ void Scorer_Combined::set_long_weight(Score_Term s, double val)
 void Scorer_Combined::set_short_weight(Score_Term s, double val)
 {
 	m_short_weight[s] = val;
+	m_plan_valid = false;
 
 	// short and long weight are always the same for the ribosome
 	if (s == SC_RIBO) { m_weight[s] = val; }
 }
 
+const std::vector<Scorer_Combined::Plan_Term> &Scorer_Combined::plan(
+	bool is_short, Plan_Order order)
+{
+	if (!m_plan_valid)
+	{
+		for (int sh = 0;sh < 2;sh++)
+		{
+			const double *weight = (sh ? m_short_weight : m_weight);
+
+			for (int o = 0;o < Plan_Num;o++)
+			{
+				std::vector<Plan_Term> &terms = m_plan[sh][o];
+				terms.clear();
+
+				for (int k = 0;k < SC_NUM;k++)
+				{
+					// (with CORE moved to the end for Plan_Core_Last)
+					int n = (o != Plan_Core_Last || k < SC_CORE ? k :
+						(k == SC_NUM - 1 ? (int) SC_CORE : k + 1));
+
+					// (RAPDF and LJ are only scored separately to print
+					// their values)
+					if (weight[n] == 0.0 ||
+						(o != Plan_Info && (n == SC_RAPDF || n == SC_LJ)))
+					{
+						continue;
+					}
+
+					Plan_Term t;
+					t.term = (Score_Term) n;
+					t.weight = weight[n];
+					terms.push_back(t);
+				}
+			}
+		}
+
+		m_plan_valid = true;
+	}
+
+	return m_plan[is_short ? 1 : 0][order];
+}
+
 void Scorer_Combined::verify_parameters()
 {
+	// "auto" chooses the table kernel if the LJ values are tabulated, so
+	// that CORE and Lennard_Jones use the same values
+	if (m_tabulated && m_core_kernel != "auto" && m_core_kernel != "table")
+	{
+		std::cerr << "Error: " << Scorer::config_section() << " "
+			<< c_param_core_kernel << " = " << m_core_kernel
+			<< " uses the analytic LJ values, but "
+			<< c_param_pair_potential << " is tabulated\n";
+		exit(1);
+	}
+
+	bool table = (m_tabulated && m_core_kernel == "auto");
+	m_core->set_kernel(core_pair_kernel(table ? "table" : m_core_kernel));
+	m_lj->set_tabulated(m_tabulated);
+
+	// (an explicit rapdf_precision wins over score_precision, whichever
+	// comes first)
+	m_table_precision = (m_rapdf_precision_set ? m_rapdf_precision :
+		m_float ? RAPDF_Float : RAPDF_Double);
+	m_core->set_precision(m_table_precision);
+	m_rapdf->set_precision(m_table_precision);
+	m_orientation->set_float(m_float);
+
+	if (m_precision_check && m_check == NULL)
+	{
+		// the same parameters, but with all of the tables at double
+		// precision (or at float, if they already are double)
+		m_check = new Scorer_Combined;
+
+		for (size_t k = 0;k < m_params.size();k++)
+		{
+			const std::string &name = m_params[k].first;
+
+			if (name != c_param_score_precision &&
+				name != c_param_rapdf_precision &&
+				name != c_param_precision_check)
+			{
+				m_check->parse_parameter(name, m_params[k].second);
+			}
+		}
+
+		m_check->parse_parameter(c_param_score_precision,
+			(reduced_precision() ? "double" : "float"));
+		m_check->set_verbose(false);
+		m_check->verify_parameters();
+	}
 }
 
 void Scorer_Combined::print_desc(std::ostream &out)
@@ -326,62 +571,194 @@ void Scorer_Combined::print_desc(std::ostream &out)
 }
 
 double Scorer_Combined::score(const Peptide &p, double progress /*= 1.0*/,
-	double *progress1_score /*= NULL*/)
+	double *progress1_score /*= NULL*/, Score_Limit *limit /*= NULL*/)
+{
+	return score_terms(p, NULL, progress1_score, limit);
+}
+
+double Scorer_Combined::score_delta(const Peptide &p, const Move_Range &range,
+	double progress /*= 1.0*/, double *progress1_score /*= NULL*/,
+	Score_Limit *limit /*= NULL*/)
+{
+	return score_terms(p, &range, progress1_score, limit);
+}
+
+namespace
+{
+	// Converts a limit on the total score into a limit on one term, given
+	// the (weighted) total of the other terms and the term's weight
+	// (which must be positive).
+	class Term_Limit : public Score_Limit
+	{
+	public:
+		Term_Limit(Score_Limit *limit, double others, double weight)
+			: m_limit(limit), m_others(others), m_weight(weight)
+		{ }
+
+		virtual double threshold(double min_score)
+		{
+			double t = m_limit->threshold(m_others + m_weight * min_score);
+			return (t == HUGE_VAL ? HUGE_VAL : (t - m_others) / m_weight);
+		}
+
+	private:
+		Score_Limit *m_limit;
+		double m_others;
+		double m_weight;
+	};
+}
+
+void Scorer_Combined::accept_last_scored()
+{
+	// (terms that were not used for the last score do nothing)
+	m_solvation->accept();
+	m_orientation->accept();
+	m_hbond->accept();
+	m_saulo->accept();
+	m_core->accept();
+	m_contact->accept();
+	m_torsion->accept();
+	m_predtor->accept();
+	m_predss->accept();
+	m_rgyr->accept();
+	m_grid->accept();
+	m_geometry->accept();
+}
+
+void Scorer_Combined::coarse_begin(const Peptide &p)
+{
+	const double *w = (p.length() <= SHORT_PEPTIDE ?
+		m_short_weight : m_weight);
+
+	// each part of the estimate is weighted like the term it stands in
+	// for (Lennard-Jones is part of CORE)
+	m_coarse->set_weights(w[SC_CORE] * w[SC_LJ], w[SC_SOLV], w[SC_CONTACT]);
+
+	if (!m_coarse_contacts_set)
+	{
+		m_coarse->set_contacts(w[SC_CONTACT] != 0.0 ?
+			&m_contact->contacts() : NULL);
+		m_coarse_contacts_set = true;
+	}
+
+	m_topology->update(p);
+	m_coarse->begin(p, *m_topology);
+}
+
+double Scorer_Combined::coarse_score(const Peptide &p,
+	const Move_Range *range)
+{
+	return m_coarse->score_change(p, *m_topology, range);
+}
+
+double Scorer_Combined::score_terms(const Peptide &p, const Move_Range *range,
+	double *progress1_score, Score_Limit *limit)
 {
 	double total = 0.0;
 	bool info_on = print_info_when_scoring();
 	double s = 0.0;
 
 	bool vbose = verbose();
+	bool is_short = (p.length() <= SHORT_PEPTIDE);
+	const double *weight = (is_short ? m_short_weight : m_weight);
 
-	double weight_rapdf = (p.length() <= SHORT_PEPTIDE ?
-			m_short_weight[SC_RAPDF] : m_weight[SC_RAPDF]);
+	double weight_rapdf = weight[SC_RAPDF];
+	double weight_lj = weight[SC_LJ];
 
-	double weight_lj = (p.length() <= SHORT_PEPTIDE ?
-			m_short_weight[SC_LJ] : m_weight[SC_LJ]);
+	// (updated once, then used by each of the pairwise score terms)
+	m_grid->update(p, range, m_neighbour_skin);
 
-	for (int n = 0;n < SC_NUM;n++)
+	// (only rebuilt if the sequence has changed)
+	m_topology->update(p);
+
+	// (only the residues moved by the move are recalculated)
+	m_geometry->update(p, *m_topology, range);
+
+	if (!m_incremental)
 	{
-		double w = (p.length() <= SHORT_PEPTIDE ?
-			m_short_weight[n] : m_weight[n]);
+		range = NULL;
+	}
+
+	// CORE is usually the most expensive term, so when scoring can stop
+	// early it is scored last, once the total of the other terms is
+	// known. It then stops as soon as it is certain that the total will
+	// be above the limit.
+	bool core_last = (limit != NULL && m_early_rejection && !info_on &&
+		!vbose && m_check == NULL);
+
+	// (only the terms with nonzero weights)
+	const std::vector<Plan_Term> &terms = plan(is_short,
+		(info_on ? Plan_Info : (core_last ? Plan_Core_Last : Plan_Normal)));
 
+	double *term = m_last_term;	// (weighted) score for each term
+	double others = 0.0;		// total of the terms scored before CORE
 
-		if (w != 0.0 )
+	for (size_t k = 0;k < terms.size();k++)
+	{
+		int n = terms[k].term;
+		double w = terms[k].weight;
+
+		switch (n)
 		{
-			switch (n)
+			case SC_SOLV:	s = m_solvation->score(p, vbose, m_raw_scores, range, m_grid, m_topology, m_geometry); break; 
+			case SC_ORIENT:	s = m_orientation->score(p, vbose, m_raw_scores, range, m_topology, m_geometry); break; 
+			/* We want to compute these scores individually to print their values: */
+			case SC_LJ:	s = m_lj->score(p, vbose, m_grid, m_topology); break;
+			case SC_RAPDF:	s = m_rapdf->score(p, vbose, m_raw_scores, m_topology); break; 
+			case SC_HBOND:	s = m_hbond->score(p, vbose, range, m_topology); break;
+			case SC_SAULO:  s = m_saulo->score(p, vbose, range, m_topology, m_geometry); break;
+			case SC_CORE:
 			{
-				case SC_SOLV:	s = m_solvation->score(p, vbose, m_raw_scores); break; 
-				case SC_ORIENT:	s = m_orientation->score(p, vbose, m_raw_scores); break; 
-				/* We want to compute these scores individually to print their values: */
-				case SC_LJ:	if (info_on) s = m_lj->score(p, vbose); break;
-				case SC_RAPDF:	if (info_on) s = m_rapdf->score(p, vbose, m_raw_scores); break; 
-				case SC_HBOND:	s = m_hbond->score(p, vbose); break;
-				case SC_SAULO:  s = m_saulo->score(p, vbose); break;
-				case SC_CORE:	s = m_core->score(p,weight_lj,weight_rapdf,vbose,m_raw_scores); break;
-				case SC_PREDSS: s = m_predss->score(p, vbose); break;
-				case SC_RGYR:	s = m_rgyr->score(p, vbose); break;
-				case SC_CONTACT:s = m_contact->score(p, vbose); break;
-				case SC_CROWD:	s = m_crowding->score(p, vbose); break;
-				case SC_RANDSCR:s = m_randomscr->score(p, vbose); break;    
-				case SC_TOR:	s = m_torsion->score(p, vbose); break; 
-                                case SC_PREDTOR:s = m_predtor->score(p, vbose); break;
-				case SC_RIBO:	s = m_ribosome->score(p, vbose); break; 
-				default:
-					assert(!"case not handled in Scorer_Combined::score()");
-					s = 0.0;
-			}
+				Term_Limit core_limit(limit, others, w);
+				s = m_core->score(p,weight_lj,weight_rapdf,vbose,m_raw_scores,range,m_grid,m_topology,
+					(core_last && w > 0.0 ? &core_limit : NULL));
 
-			s *= w;
+				if (s == HUGE_VAL)
+				{
+					if (progress1_score != NULL)
+					{
+						*progress1_score = HUGE_VAL;
+					}
 
+					return HUGE_VAL;
+				}
 
-			if (info_on)
-			{
-				std::cout << c_score_name[n] << " = " << s << "\n";
+				break;
 			}
-			/* These scores are part of the CORE component, so they should not be added to "total" */
-			if(n != SC_RAPDF && n != SC_LJ)
-				total += s;
+			case SC_PREDSS: s = m_predss->score(p, vbose, range); break;
+			case SC_RGYR:	s = m_rgyr->score(p, vbose, range, m_topology, m_geometry); break;
+			case SC_CONTACT:s = m_contact->score(p, vbose, range, m_topology, m_geometry); break;
+			case SC_CROWD:	s = m_crowding->score(p, vbose, m_grid, m_topology, m_geometry); break;
+			case SC_RANDSCR:s = m_randomscr->score(p, vbose); break;    
+			case SC_TOR:	s = m_torsion->score(p, vbose, range); break; 
+                                case SC_PREDTOR:s = m_predtor->score(p, vbose, range); break;
+			case SC_RIBO:	s = m_ribosome->score(p, vbose); break; 
+			default:
+				assert(!"case not handled in Scorer_Combined::score()");
+				s = 0.0;
 		}
+
+		s *= w;
+		term[n] = s;
+
+		// (CORE is never moved to the end when info_on is true)
+		if (info_on)
+		{
+			std::cout << c_score_name[n] << " = " << s << "\n";
+		}
+
+		if(n != SC_RAPDF && n != SC_LJ)
+			others += s;
+	}
+
+	// (added up in the same order whichever order they were scored in;
+	// RAPDF and LJ are part of the CORE component, so they are not added
+	// to "total")
+	const std::vector<Plan_Term> &sum_terms = plan(is_short, Plan_Normal);
+
+	for (size_t k = 0;k < sum_terms.size();k++)
+	{
+		total += term[sum_terms[k].term];
 	}
 
 
@@ -390,9 +767,125 @@ double Scorer_Combined::score(const Peptide &p, double progress /*= 1.0*/,
 		*progress1_score = total;
 	}
 
+	if (m_check != NULL && !info_on)
+	{
+		check_precision(p, total, limit);
+	}
+
 	return total;
 }
 
+void Scorer_Combined::check_precision(const Peptide &p, double total,
+	Score_Limit *limit)
+{
+	// (always scored from scratch, so nothing depends on what m_check
+	// scored before)
+	double check_total = m_check->score_terms(p, NULL, NULL, NULL);
+	m_check->accept_last_scored();
+
+	// the differences are between the reduced precision values and the
+	// double ones
+	bool reduced = reduced_precision();
+	const double *double_term = (reduced ? m_check->m_last_term :
+		m_last_term);
+	const double *reduced_term = (reduced ? m_last_term :
+		m_check->m_last_term);
+	double double_total = (reduced ? check_total : total);
+	double reduced_total = (reduced ? total : check_total);
+
+	Precision_Stats &st = m_precision_stats;
+	const std::vector<Plan_Term> &terms = plan(p.length() <= SHORT_PEPTIDE,
+		Plan_Normal);
+
+	// (the total is stored after the terms, at SC_NUM)
+	for (size_t k = 0;k <= terms.size();k++)
+	{
+		int n = (k < terms.size() ? (int) terms[k].term : (int) SC_NUM);
+		double d = (n < SC_NUM ? double_term[n] : double_total);
+		double f = (n < SC_NUM ? reduced_term[n] : reduced_total);
+		double diff = fabs(f - d);
+
+		st.max_abs[n] = std::max(st.max_abs[n], diff);
+
+		if (d != 0.0)
+		{
+			st.max_rel[n] = std::max(st.max_rel[n], diff / fabs(d));
+		}
+	}
+
+	st.scores++;
+
+	if (limit != NULL)
+	{
+		// Whether the strategy would reject the conformation with each
+		// score. The threshold for "total" only draws a random number if
+		// select() is going to use it, so the run is the same as with the
+		// check off. The decision is only counted if the threshold for
+		// the other score is then known without drawing another one.
+		double t = limit->threshold(total);
+		double check_t;
+
+		if (limit->known_threshold(check_total, &check_t))
+		{
+			st.decisions++;
+
+			if ((total > t) != (check_total > check_t))
+			{
+				st.decisions_differ++;
+			}
+		}
+	}
+}
+
+void Scorer_Combined::print_run_stats(std::ostream &out)
+{
+	Precision_Stats &st = m_precision_stats;
+
+	if (m_check == NULL || st.scores == 0)
+	{
+		return;
+	}
+
+	// (the scorer that is not using double tables)
+	const Scorer_Combined *r = (reduced_precision() ? this : m_check);
+	const char *reduced_name = (r->m_table_precision == RAPDF_Double ?
+		"float" : RAPDF_Table::precision_name(r->m_table_precision));
+
+	out << "Precision check: " << st.scores
+		<< " conformations scored with both " << reduced_name
+		<< " and double tables\n"
+		<< Printf("  %-14s", "term") << Printf(" %12s", "max abs diff")
+		<< Printf(" %12s\n", "max rel diff");
+
+	for (int n = 0;n <= SC_NUM;n++)
+	{
+		if (st.max_abs[n] < 0.0)
+		{
+			continue;
+		}
+
+		out << Printf("  %-14s", (n < SC_NUM ? c_score_name[n] : "total"))
+			<< Printf(" %12.4g ", st.max_abs[n]);
+
+		if (st.max_rel[n] < 0.0)
+		{
+			out << Printf("%12s\n", "-");
+		}
+		else
+		{
+			out << Printf("%12.4g\n", st.max_rel[n]);
+		}
+	}
+
+	if (st.decisions > 0)
+	{
+		out << "  accept/reject decisions that differ: "
+			<< st.decisions_differ << " of " << st.decisions << "\n";
+	}
+
+	st = Precision_Stats();
+}
+
 void Scorer_Combined::print_template(std::ostream &out,
 	 bool commented /*= true*/)
 {
@@ -440,6 +933,57 @@ void Scorer_Combined::print_template(std::ostream &out,
 	}
 
 	out << "\n";
+
+	out << c << c_param_incremental << " = "
+		<< bool_str(c_default_incremental)
+		<< "\t# only rescore residue pairs affected by each move\n";
+
+	out << c << c_param_early_rejection << " = "
+		<< bool_str(c_default_early_rejection)
+		<< "\t# stop scoring a move as soon as it is certain\n"
+		<< c << "\t\t\t\t# to be rejected\n";
+
+	out << c << c_param_neighbour_skin << " = "
+		<< c_default_neighbour_skin
+		<< "\t# Verlet list skin in Angstroms (0 = find neighbours\n"
+		<< c << "\t\t\t\t# again for every conformation)\n";
+
+	out << c << c_param_core_kernel << " = " << c_default_core_kernel
+		<< "\t\t# CORE kernel: auto, scalar, table, avx2 or avx512\n"
+		<< c << "\t\t\t\t# (auto is table if pair_potential is\n"
+		<< c << "\t\t\t\t# tabulated)\n";
+
+	out << c << c_param_rapdf_precision << " = "
+		<< c_default_rapdf_precision
+		<< "\t# RAPDF table values: double, float or int16\n"
+		<< c << "\t\t\t\t# (float and int16 use less memory but\n"
+		<< c << "\t\t\t\t# change the scores slightly)\n";
+
+	out << c << c_param_pair_potential << " = "
+		<< c_default_pair_potential
+		<< "\t# LJ values: analytic or tabulated (tabulated\n"
+		<< c << "\t\t\t\t# avoids square roots but changes the\n"
+		<< c << "\t\t\t\t# scores slightly; needs core_kernel auto\n"
+		<< c << "\t\t\t\t# or table)\n";
+
+	out << c << c_param_score_precision << " = "
+		<< c_default_score_precision
+		<< "\t# potential tables used in the inner loops: double\n"
+		<< c << "\t\t\t\t# or float (also used for the RAPDF tables\n"
+		<< c << "\t\t\t\t# unless rapdf_precision is given)\n";
+
+	out << c << c_param_precision_check << " = "
+		<< bool_str(c_default_precision_check)
+		<< "\t# also score every conformation with double\n"
+		<< c << "\t\t\t\t# tables (float if they already are) and\n"
+		<< c << "\t\t\t\t# report the differences\n"
+		<< c << "\t\t\t\t# after each run (slow)\n";
+
+	out << c << c_param_threads << " = " << c_default_threads
+		<< "\t\t\t# threads used to score CORE residue pairs (0 = the\n"
+		<< c << "\t\t\t\t# usual single threaded order; 1 or more give\n"
+		<< c << "\t\t\t\t# the same scores as each other, for long\n"
+		<< c << "\t\t\t\t# chains)\n\n";
 }
 
 void Scorer_Combined::dump(std::ostream &out /*=std::cout*/)
@@ -5,7 +5,11 @@
 // The default type of Scorer.
 
 #include "scorer.h"
+#include "rapdf_table.h"
 #include <iostream>
+#include <vector>
+#include <string>
+#include <utility>
 
 // a peptide is "short" if it is less than or equal to this length
 #define SHORT_PEPTIDE 150
@@ -29,6 +33,12 @@ class Randomscr;
 class Torsion;
 class PredTor;
 class Ribosome;
+class Neighbour_Grid;
+class Topology;
+class Residue_Geometry;
+class Coarse;
+class Thread_Pool;
+struct Move_Range;
 
 enum Score_Term
 {
@@ -56,11 +66,27 @@ public:
 
 	// score a peptide (low scores ate better)
 	virtual double score(const Peptide &p, double progress = 1.0,
-		double *progress1_score = NULL);
+		double *progress1_score = NULL, Score_Limit *limit = NULL);
+
+	// score a peptide, only recalculating the residue pairs affected
+	// by the move described by range (see Scorer::score_delta())
+	virtual double score_delta(const Peptide &p, const Move_Range &range,
+		double progress = 1.0, double *progress1_score = NULL,
+		Score_Limit *limit = NULL);
+
+	// the last peptide scored is now the current conformation
+	virtual void accept_last_scored();
+
+	// (see Scorer::coarse_score())
+	virtual void coarse_begin(const Peptide &p);
+	virtual double coarse_score(const Peptide &p, const Move_Range *range);
 
 	// print a brief description of the type of scoring
 	virtual void print_desc(std::ostream &out);
 
+	// print the differences found by the precision check (if it is on)
+	virtual void print_run_stats(std::ostream &out);
+
     // print sample config file parameters
     static void print_template(std::ostream &out, bool commented = true);
 
@@ -86,6 +112,34 @@ private:
 	Scorer_Combined(const Scorer_Combined&);
 	Scorer_Combined &operator = (const Scorer_Combined&);
 
+	// score a peptide; if range is not NULL, only recalculate the parts
+	// of each term affected by the move
+	// (if limit is not NULL, returns HUGE_VAL if scoring stopped early)
+	double score_terms(const Peptide &p, const Move_Range *range,
+		double *progress1_score, Score_Limit *limit);
+
+	// The order in which score_terms() scores the terms: the usual order
+	// (without the RAPDF and LJ terms, which are part of CORE), with
+	// CORE last (for early rejection), or the usual order including
+	// RAPDF and LJ (to print their values).
+	enum Plan_Order { Plan_Normal, Plan_Core_Last, Plan_Info, Plan_Num };
+
+	// a term with a nonzero weight
+	struct Plan_Term
+	{
+		Score_Term term;
+		double weight;
+	};
+
+	// the terms to score for short (or long) peptides in the given order
+	// (built the first time it is needed after the weights change)
+	const std::vector<Plan_Term> &plan(bool is_short, Plan_Order order);
+
+	// score p with m_check as well, and compare each term (and whether
+	// the limit would reject it) with the values just found by
+	// score_terms()
+	void check_precision(const Peptide &p, double total, Score_Limit *limit);
+
 private:
 	// "type" parameter name
 	static const char *c_type;
@@ -104,9 +158,27 @@ private:
 	static const char *c_param_short_weight[SC_NUM];
 
     static const char *c_param_raw_scores;
+    static const char *c_param_incremental;
+    static const char *c_param_early_rejection;
+    static const char *c_param_neighbour_skin;
+    static const char *c_param_core_kernel;
+    static const char *c_param_rapdf_precision;
+    static const char *c_param_pair_potential;
+    static const char *c_param_score_precision;
+    static const char *c_param_precision_check;
+    static const char *c_param_threads;
 
     // default parameter values
     static const bool c_default_raw_scores;
+    static const bool c_default_incremental;
+    static const bool c_default_early_rejection;
+    static const double c_default_neighbour_skin;
+    static const char *c_default_core_kernel;
+    static const char *c_default_rapdf_precision;
+    static const char *c_default_pair_potential;
+    static const char *c_default_score_precision;
+    static const bool c_default_precision_check;
+    static const int c_default_threads;
 
 	RAPDF *m_rapdf;
 	Solvation *m_solvation;
@@ -123,11 +195,96 @@ private:
 	Orientation *m_orientation;
 	Lennard_Jones *m_lj;
 	Ribosome *m_ribosome;
-	
+
+	// neighbouring residues in the conformation being scored
+	// (shared by all of the pairwise score terms)
+	Neighbour_Grid *m_grid;
+
+	// amino acids and atoms of the peptide being scored
+	// (shared by all of the score terms that use it)
+	Topology *m_topology;
+
+	// positions derived from the atoms of each residue in the
+	// conformation being scored (shared by the residue level score terms)
+	Residue_Geometry *m_geometry;
+
+	// threads used to score the residue pairs of the CORE term (NULL if
+	// it is scored on one thread in the usual order)
+	Thread_Pool *m_pool;
+
+	// the CA/CB-only estimate used by coarse_score()
+	Coarse *m_coarse;
+	bool m_coarse_contacts_set;		// whether m_coarse has the contacts
 
 	double m_weight[SC_NUM];
 	double m_short_weight[SC_NUM];
+
+	// plan() for long and short peptides, and whether it is up to date
+	std::vector<Plan_Term> m_plan[2][Plan_Num];
+	bool m_plan_valid;
     bool m_raw_scores;
+
+	// whether score_delta() reuses the values from the current conformation
+	bool m_incremental;
+
+	// whether to stop scoring a candidate as soon as it is known that
+	// it will be rejected (when a Score_Limit is passed to score())
+	bool m_early_rejection;
+
+	// distance atoms can move before the neighbour lists are rebuilt
+	double m_neighbour_skin;
+
+	// "core_kernel" and "pair_potential" parameters (applied to m_core
+	// and m_lj by verify_parameters(), so that their order in the config
+	// file does not matter)
+	std::string m_core_kernel;
+	bool m_tabulated;
+
+	// whether the potential tables are stored as floats
+	bool m_float;
+
+	// "rapdf_precision" parameter, and whether it was given (otherwise
+	// the RAPDF tables follow m_float)
+	RAPDF_Precision m_rapdf_precision;
+	bool m_rapdf_precision_set;
+
+	// precision of the RAPDF tables used by m_core and m_rapdf (set by
+	// verify_parameters())
+	RAPDF_Precision m_table_precision;
+
+	// whether any of the tables are stored with less than double
+	// precision
+	bool reduced_precision() const
+	{ return m_float || m_table_precision != RAPDF_Double; }
+
+	// whether to also score every conformation with the other precision
+	// and record the differences
+	bool m_precision_check;
+
+	// every parameter passed to parse_parameter() (to set up m_check)
+	std::vector<std::pair<std::string, std::string> > m_params;
+
+	// scorer using double precision for all of the tables (or float, if
+	// this one already uses double), if m_precision_check is true
+	Scorer_Combined *m_check;
+
+	// (weighted) value of each term in the last score_terms() call
+	double m_last_term[SC_NUM];
+
+	// largest differences found by check_precision() during the current
+	// run (between float and double tables), for each term and the total
+	struct Precision_Stats
+	{
+		long scores;				// number of conformations compared
+		double max_abs[SC_NUM + 1];	// largest absolute difference
+		double max_rel[SC_NUM + 1];	// largest relative difference
+		long decisions;				// accept/reject decisions compared
+		long decisions_differ;		// number that would be different
+
+		Precision_Stats();
+	};
+
+	Precision_Stats m_precision_stats;
 };
 
 #endif // SCORER_COMBINED_INCLUDED
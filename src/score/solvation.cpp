@@ -8,6 +8,7 @@ Solvation::Solvation()
 {
 	m_short = new Solvation_impl;
 	m_long = new Solvation_impl;
+	m_last = NULL;
 }
 
 Solvation::~Solvation()
@@ -26,15 +27,28 @@ void Solvation::set_long_data_file(const std::string &filename)
 	m_long->set_data_file(filename);
 }
 
-double Solvation::score(const Peptide &p, bool verbose, bool continuous)
+double Solvation::score(const Peptide &p, bool verbose, bool continuous,
+	const Move_Range *range /*= NULL*/, Neighbour_Grid *grid /*= NULL*/,
+	const Topology *topology /*= NULL*/,
+	const Residue_Geometry *geometry /*= NULL*/)
 {
 	if (p.length() <= SHORT_PEPTIDE || continuous)
 	{
-		return m_short->score(p, verbose, continuous);
+		m_last = m_short;
+		return m_short->score(p, verbose, continuous, range, grid, topology, geometry);
 	}
 	else
 	{
-		return m_long->score(p, verbose);
+		m_last = m_long;
+		return m_long->score(p, verbose, false, range, grid, topology, geometry);
+	}
+}
+
+void Solvation::accept()
+{
+	if (m_last != NULL)
+	{
+		m_last->accept();
 	}
 }
 
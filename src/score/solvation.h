@@ -5,6 +5,10 @@
 #include <vector>
 class Peptide;
 class Solvation_impl;
+class Neighbour_Grid;
+class Topology;
+class Residue_Geometry;
+struct Move_Range;
 
 /**
  * @brief Solvation_impl Potential.
@@ -20,7 +24,14 @@ public:
 	~Solvation();
 
 	// score a peptide (low scores are better)
-	double score(const Peptide& peptide, bool verbose = false, bool continuous = false);
+	double score(const Peptide& peptide, bool verbose = false, bool continuous = false,
+		const Move_Range *range = NULL, Neighbour_Grid *grid = NULL,
+		const Topology *topology = NULL,
+		const Residue_Geometry *geometry = NULL);
+
+	// the peptide last scored is now the current conformation
+	// (see Scorer::accept_last_scored())
+	void accept();
 
 	// set the name of the solvation data file
 	void set_short_data_file(const std::string &filename);
@@ -29,6 +40,7 @@ public:
 private:
 	Solvation_impl *m_short;    // for short proteins
 	Solvation_impl *m_long;     // for long proteins
+	Solvation_impl *m_last;     // the one used for the last score() call
 };
 
 #endif // SOLVATION_H_INCLUDED
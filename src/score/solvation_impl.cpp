@@ -3,6 +3,7 @@
 #include <cstdio>
 #include <cmath>
 #include <cassert>
+#include <algorithm>
 
 #include "peptide.h"
 #include "residue.h"
@@ -12,9 +13,10 @@
 #include "scorer_combined.h"
 #include "solvation.h"
 #include "solvation_impl.h"
+#include "move_range.h"
 
 Solvation_impl::Solvation_impl() :
-	m_data_loaded(false)
+	m_data_loaded(false), m_num_incremental(0)
 {
 }
 
@@ -42,25 +44,69 @@ void Solvation_impl::load_data()
 
 //std::cout << "LOADING SOLVATION DATA\n";
 
+	Potential_Table table;
+
+	if (!Potential_File::read_table(m_filename, "solvation", &table))
+	{
+		read_text(m_filename, &table);
+	}
+
+	if (table.params.size() != 3 || table.dims.size() != 2 ||
+		table.dims[0] != Amino::Num ||
+		table.dims[1] != (int) table.params[1])
+	{
+		std::cerr << "Error: the solvation table in " << m_filename
+			<< " does not have the expected size\n";
+		exit(1);
+	}
+
+	m_first_bin = (int) table.params[0];
+	m_top_bin = (int) table.params[1];
+	m_solv_dist = table.params[2];
+	m_bin.resize(Amino::Num);
+
+	for (int a = 0;a < Amino::Num;a++)
+	{
+		const double *v = table.values + a * m_top_bin;
+		m_bin[a].assign(v, v + m_top_bin);
+	}
+
+	m_data_loaded = true;
+}
+
+void Solvation_impl::read_text(const std::string &filename,
+	Potential_Table *table)
+{
 	// exits with error message if file does not exist
-	C_File file(m_filename, "r", "Solvation data file");
+	C_File file(filename, "r", "Solvation data file");
 
 	static const int Max_Len = 1000;
 	char buffer[Max_Len];
-	int last_bin;
+	int first_bin, last_bin;
+	double solv_dist;
 
 	if (!file.next_line(buffer, Max_Len) ||
 		sscanf(buffer, "%d %d %lf",
-			   &m_first_bin, &last_bin, &m_solv_dist) != 3)
+			   &first_bin, &last_bin, &solv_dist) != 3 ||
+		first_bin < 0 || first_bin > last_bin)
 	{
 		std::cerr << "Error: expected solvation data file "
-			<< m_filename
+			<< filename
 			<< " to start with three numbers (min count, max count, radius)\n";
 		exit(1);
 	}
 
-	m_top_bin = last_bin + 1;
-	m_bin.resize(Amino::Num);
+	int top_bin = last_bin + 1;
+
+	std::vector<int> dims;
+	dims.push_back((int) Amino::Num);
+	dims.push_back(top_bin);
+	table->allocate(dims);
+
+	table->params.clear();
+	table->params.push_back(first_bin);
+	table->params.push_back(top_bin);
+	table->params.push_back(solv_dist);
 
 	for (int a = 0;a < Amino::Num;a++)
 	{
@@ -71,26 +117,26 @@ void Solvation_impl::load_data()
 				<< Amino(a).abbr() << "\" on line "
 				<< file.line_num()
 				<< " of solvation data file "
-				<< m_filename
+				<< filename
 				<< "\n";
 			exit(1);
 		}
 
-		m_bin[a].resize(m_top_bin);
+		double *bin_val = &table->own_values[a * top_bin];
 
-		for (int c = m_first_bin;c < m_top_bin;c++)
+		for (int c = first_bin;c < top_bin;c++)
 		{
 			int bin;
 
 			if (!file.next_line(buffer, Max_Len) ||
-				sscanf(buffer, "%d %lf", &bin, &m_bin[a][c]) != 2 ||
+				sscanf(buffer, "%d %lf", &bin, &bin_val[c]) != 2 ||
 				bin != c)
 			{
 				std::cerr << "Error: expected \""
 					<< c << "\" followed by value on line "
 					<< file.line_num()
 					<< " of "
-					<< m_filename
+					<< filename
 					<< "\n";
 				exit(1);
 			}
@@ -102,64 +148,147 @@ void Solvation_impl::load_data()
 		std::cerr << "Warning: ignoring extra data on line "
 			<< file.line_num()
 			<< " of solvation data file "
-			<< m_filename
+			<< filename
 			<< "\n";
 	}
-
-	m_data_loaded = true;
 }
 
-inline Point cbeta_pos(const Peptide &p, int n, bool *failed)
+double Solvation_impl::score(const Peptide &p, bool verbose, bool continuous,
+	const Move_Range *range /*= NULL*/, Neighbour_Grid *grid /*= NULL*/,
+	const Topology *topology /*= NULL*/,
+	const Residue_Geometry *geometry /*= NULL*/)
 {
-	Atom_Id a = (p.res(n).amino().is_glycine() ? Atom_CA : Atom_CB);
-
-	*failed = !(p.atom_exists(n, a));
+	// (does nothing if already loaded)
+	load_data();
 
-	if (*failed)
+	if (topology == NULL)
 	{
-		Point pp;
-		return pp;
+		m_topology.update(p);
+		topology = &m_topology;
 	}
-	else
+
+	if (geometry == NULL)
 	{
-		return p.atom_pos(n, a);
+		m_geometry.build(p, *topology);
+		geometry = &m_geometry;
 	}
-}
 
-double Solvation_impl::score(const Peptide &p, bool verbose, bool continuous)
-{
-	// (does nothing if already loaded)
-	load_data();
+	int n;
 
-	std::vector<int> count;
-	count.resize(p.full_length());
+	// (the number of near residues for each residue; see m_count)
+	bool reuse_count = m_count.begin(p.start(), p.end(), p.full_length(),
+		range);
 
-	int n;
-	for (n = p.start();n <= p.end();n++)
+	if (range == NULL)
 	{
-		count[n] = 0;
-	}
+		// only check the residues that the grid finds near each other
 
-	for (n = p.start() + 1;n <= p.end();n++)
-	{
-		bool failed = false;
-		Point pos = cbeta_pos(p, n, &failed);
-		if (failed) { continue; }
-		
-		if (failed)
+		m_near.clear();
+
+		for (n = p.start();n <= p.end();n++)
 		{
-			continue;
+			m_count[n] = 0;
 		}
 
-		for (int m = p.start();m < n;m++)
+		if (grid == NULL)
 		{
-			Point p2 = cbeta_pos(p, m, &failed);
-			if (failed) { continue; }
+			m_grid.build(p);
+			grid = &m_grid;
+		}
 
-			if (pos.closer_than(m_solv_dist, p2))
+		grid->use_cutoff(m_solv_dist);
+
+		for (n = p.start() + 1;n <= p.end();n++)
+		{
+			if (!geometry->has_cb_ca(n))
 			{
-				count[n]++;
-				count[m]++;
+				continue;
+			}
+
+			const Point &pos = geometry->cb_ca(n);
+
+			grid->find_near(n, m_solv_dist, n, &m_near_res);
+
+			for (size_t i = 0;i < m_near_res.size();i++)
+			{
+				int m = m_near_res[i];
+
+				if (geometry->has_cb_ca(m) &&
+					pos.closer_than(m_solv_dist, geometry->cb_ca(m)))
+				{
+					m_count[n]++;
+					m_count[m]++;
+				}
+			}
+		}
+	}
+	else
+	{
+		// if possible, reuse the values for residue pairs that were not
+		// affected by the move, and the counts from the current
+		// conformation
+		bool reuse = m_near.begin(p.start(), p.end(),
+			num_residue_pairs(p.end() + 1), range) && reuse_count;
+
+		if (reuse)
+		{
+			// only the pairs for which range->pair_changed() is true,
+			// adjusting the counts of the residues whose pairs changed
+			for (n = std::max(range->first, p.start() + 1);n <= p.end();n++)
+			{
+				bool failed = !geometry->has_cb_ca(n);
+				const Point &pos = geometry->cb_ca(n);
+				int last = std::min(range->last, n - 1);
+
+				for (int m = p.start();m <= last;m++)
+				{
+					unsigned char &near = m_near[residue_pair_index(n, m)];
+					unsigned char was_near = near;
+
+					near = (!failed && geometry->has_cb_ca(m) &&
+						pos.closer_than(m_solv_dist, geometry->cb_ca(m)));
+
+					if (near != was_near)
+					{
+						int change = (near ? 1 : -1);
+						m_count[n] += change;
+						m_count[m] += change;
+					}
+				}
+			}
+
+			// every so often, make sure the counts are still the same as
+			// counting the near pairs from scratch
+			if (++m_num_incremental % Check_Interval == 0)
+			{
+				check_counts(p);
+			}
+		}
+		else
+		{
+			for (n = p.start();n <= p.end();n++)
+			{
+				m_count[n] = 0;
+			}
+
+			for (n = p.start() + 1;n <= p.end();n++)
+			{
+				bool failed = !geometry->has_cb_ca(n);
+				const Point &pos = geometry->cb_ca(n);
+
+				for (int m = p.start();m < n;m++)
+				{
+					unsigned char &near = m_near[residue_pair_index(n, m)];
+					near = 0;
+
+					if (!failed && geometry->has_cb_ca(m) &&
+						pos.closer_than(m_solv_dist, geometry->cb_ca(m)))
+					{
+						near = 1;
+						m_count[n]++;
+						m_count[m]++;
+					}
+				}
 			}
 		}
 	}
@@ -168,8 +297,8 @@ double Solvation_impl::score(const Peptide &p, bool verbose, bool continuous)
 
 	for (n = p.start();n <= p.end();n++)
 	{
-		int a = p.res(n).amino().num();
-		int c = count[n];
+		int a = topology->amino(n);
+		int c = m_count[n];
 
 		if (c < m_first_bin) { c = m_first_bin; }
 		else
@@ -182,7 +311,7 @@ std::cout
 	<< n << "/" << p.res(n).res_seq_str()
 	<< " " << p.res(n).amino().name()
 	<< " (line " << p.res(n).pdb_line()
-	<< ")  count = " << count[n]
+	<< ")  count = " << m_count[n]
 	<< "\n";
 */
 
@@ -217,3 +346,32 @@ std::cout
 	return total;
 }
 
+void Solvation_impl::accept()
+{
+	m_near.accept();
+	m_count.accept();
+}
+
+void Solvation_impl::check_counts(const Peptide &p)
+{
+	for (int n = p.start();n <= p.end();n++)
+	{
+		int c = 0;
+
+		for (int m = p.start();m <= p.end();m++)
+		{
+			if (m != n && m_near[residue_pair_index(std::max(n, m),
+				std::min(n, m))])
+			{
+				c++;
+			}
+		}
+
+		if (c != m_count[n])
+		{
+			std::cerr << "Error: incremental solvation count for residue "
+				<< n << " is " << m_count[n] << " instead of " << c << "\n";
+			exit(1);
+		}
+	}
+}
@@ -3,10 +3,16 @@
 
 #include <iostream>
 #include <vector>
+#include "score_cache.h"
+#include "neighbour_grid.h"
+#include "topology.h"
+#include "residue_geometry.h"
+#include "potential_file.h"
 class Peptide;
 class Residue;
 class C_File;
 class Atom;
+struct Move_Range;
 
 class Solvation_impl
 {
@@ -14,15 +20,35 @@ public:
 	Solvation_impl();
 	~Solvation_impl();
 
-	// score a peptide (low scores are better)
-	double score(const Peptide& peptide, bool verbose = false, bool continuous = false);
+	// score a peptide (low scores are better). If range is not NULL, the
+	// peptide differs from the conformation last passed to accept() only
+	// as described by range. If grid is not NULL, it must have been built
+	// for the peptide's current conformation, and if topology is not NULL,
+	// it must have been built for the peptide. If geometry is not NULL, it
+	// must be up to date for the peptide's current conformation.
+	double score(const Peptide& peptide, bool verbose = false, bool continuous = false,
+		const Move_Range *range = NULL, Neighbour_Grid *grid = NULL,
+		const Topology *topology = NULL,
+		const Residue_Geometry *geometry = NULL);
+
+	// the peptide last scored is now the current conformation
+	void accept();
 
 	// set the name of the solvation data file
 	void set_data_file(const std::string &filename);
 
+	// read a solvation data file (exits with an error message if it is
+	// not valid). The table has dimensions [Amino::Num][top bin], and the
+	// parameters are the first bin, top bin and "near" distance.
+	static void read_text(const std::string &filename, Potential_Table *table);
+
 private:
 	void load_data();
 
+	// check that the incrementally updated counts for p match the near
+	// pairs (exits with an error message if not)
+	void check_counts(const Peptide &p);
+
 private:
 	typedef std::vector<double> Double_Vec;
 	typedef std::vector<Double_Vec> Double_Vec_Vec;
@@ -34,6 +60,25 @@ private:
 	int m_first_bin;			// lowest valid index of m_bin[amino][*]
 	int m_top_bin;				// hightest valid index + 1 of m_bin[amino][*]
 	double m_solv_dist;			// "near" distance between CB atoms (eg. 10.0)
+
+	// for each pair of residues, 1 if their CB atoms are "near", else 0
+	// (indexed by residue_pair_index())
+	Score_Cache<unsigned char> m_near;
+
+	// for each residue, the number of residues that are "near" it
+	// (after a move, only the counts of the residues in pairs that
+	// changed from near to not near or back are updated)
+	Score_Cache<int> m_count;
+
+	// number of times the counts have been updated incrementally, and
+	// how often they are checked against a full count
+	long m_num_incremental;
+	static const int Check_Interval = 1000;
+
+	std::vector<int> m_near_res;	// residues near the current one
+	Neighbour_Grid m_grid;			// used if no grid is passed to score()
+	Topology m_topology;			// used if no topology is passed to score()
+	Residue_Geometry m_geometry;	// used if no geometry is passed to score()
 };
 
 #endif // SOLVATION_IMPL_H_INCLUDED
@@ -27,18 +27,25 @@ void Torsion::set_long_data_file(const std::string &filename)
 	m_long->set_data_file(filename);
 }
 
-double Torsion::score(const Peptide &p, bool verbose)
+double Torsion::score(const Peptide &p, bool verbose,
+	const Move_Range *range /*= NULL*/)
 {
 	if (p.length() <= SHORT_PEPTIDE)
 	{
-		return m_short->score(p, verbose);
+		return m_short->score(p, verbose, range);
 	}
 	else
 	{
-		return m_long->score(p, verbose);
+		return m_long->score(p, verbose, range);
 	}
 }
 
+void Torsion::accept()
+{
+	m_short->accept();
+	m_long->accept();
+}
+
 bool Torsion::get_phi_psi_bin(const Peptide &p, int n,
 	int *phi_bin, int *psi_bin)
 {
@@ -7,6 +7,7 @@
 
 class Peptide;
 class Torsion_impl;
+struct Move_Range;
 
 // size of each torsion bin (degrees)
 #define TORSION_SIZE 3
@@ -31,7 +32,13 @@ public:
 	~Torsion();
 
 	// score a peptide (low scores are better)
-	double score(const Peptide& peptide, bool verbose = false);
+	// (if range is not NULL, only the residues whose torsion angles were
+	// changed by the move are recalculated; see Scorer::score_delta())
+	double score(const Peptide& peptide, bool verbose = false,
+		const Move_Range *range = NULL);
+
+	// the peptide last scored is now the current conformation
+	void accept();
 
 	// set the name of the torsion data file
 	void set_short_data_file(const std::string &filename);
@@ -3,12 +3,14 @@
 #include <string>
 #include <cstdio>
 #include <cassert>
+#include <algorithm>
 #include "peptide.h"
 #include "geom.h"
 #include "c_file.h"
 #include "stream_printf.h"
 #include "scorer_combined.h"
 #include "torsion.h"
+#include "move_range.h"
 #include "torsion_impl.h"
 
 Torsion_impl::Torsion_impl() :
@@ -25,6 +27,19 @@ void Torsion_impl::set_data_file(const std::string &filename)
 	m_filename = filename;
 }
 
+namespace
+{
+	// dimensions of the table of values (see Torsion_impl::read_text())
+	std::vector<int> table_dims()
+	{
+		std::vector<int> dims;
+		dims.push_back(TORSION_BINS);
+		dims.push_back(TORSION_BINS);
+		dims.push_back((int) Amino::Num);
+		return dims;
+	}
+}
+
 void Torsion_impl::load_data()
 {
 	if (m_data_loaded)
@@ -38,8 +53,28 @@ void Torsion_impl::load_data()
 		exit(1);
 	}
 
+	Potential_Table table;
+
+	if (!Potential_File::read_table(m_filename, "torsion", &table))
+	{
+		read_text(m_filename, &table);
+	}
+
+	table.check(m_filename, "torsion", table_dims(), 0);
+	std::copy(table.values, table.values + table.num_values(),
+		&m_data[0][0][0]);
+
+	m_data_loaded = true;
+}
+
+void Torsion_impl::read_text(const std::string &filename,
+	Potential_Table *table)
+{
 	// exits with error message if the file does not exist
-	C_File file(m_filename, "r", "Torsion data file");
+	C_File file(filename, "r", "Torsion data file");
+
+	table->allocate(table_dims());
+	table->params.clear();
 
 	static const int Max_Len = 1000;
 	char buffer[Max_Len];
@@ -53,7 +88,7 @@ void Torsion_impl::load_data()
 				<< Amino(a).abbr() << "\" on line "
 				<< file.line_num()
 				<< " of torsion data file "
-				<< m_filename
+				<< filename
 				<< "\n";
 			exit(1);
 		}
@@ -74,13 +109,14 @@ void Torsion_impl::load_data()
 						<< "\" followed by value on line "
 						<< file.line_num()
 						<< " of "
-						<< m_filename
+						<< filename
 						<< "\n"
 						<< "(TORSION_BINS = " << TORSION_BINS << ")\n";
 					exit(1);
 				}
 				
-				m_data[phi_bin][psi_bin][a] = val;
+				table->own_values[(phi_bin * TORSION_BINS + psi_bin) *
+					Amino::Num + a] = val;
 			}
 		}
 	}
@@ -90,65 +126,37 @@ void Torsion_impl::load_data()
 		std::cerr << "Warning: ignoring extra data on line "
 			<< file.line_num()
 			<< " of torsion data file "
-			<< m_filename
+			<< filename
 			<< "\n";
 	}
-
-	m_data_loaded = true;
 }
 
-double Torsion_impl::score(const Peptide& p, bool verbose)
+double Torsion_impl::score(const Peptide& p, bool verbose,
+	const Move_Range *range /*= NULL*/)
 {
 	// (does nothing if data already loaded)
 	load_data();
 
 	double total = 0.0;
-	int phi_bin, psi_bin;
+
+	// if possible, reuse the values for residues whose torsion angles
+	// were not changed by the move
+	bool reuse = m_res_score.begin(p.start(), p.end(), p.full_length(),
+		range);
 
 	// (first and last residue are missing one torsion angle, so
 	// exclude them)
 
 	for (int n = p.start() + 1;n < p.end();n++)
 	{
-		if (p.res(n).amino().is_glycine())
-		{
-			// glycine torsion propensities cannot be calculated reliably,
-			// since it occupies regions of the Ramachandran plot that
-			// no other amino acid does
-			continue;
-		}
+		double &s = m_res_score[n];
 
-		if (Torsion::get_phi_psi_bin(p, n, &phi_bin, &psi_bin))
+		if (!reuse || verbose || range->angles_changed(n))
 		{
-			int a = p.res(n).amino().num();
-			total += m_data[phi_bin][psi_bin][a];
-
-			/*
-			double phi = rad2deg(p.conf().phi(n));
-			double psi = rad2deg(p.conf().psi(n));
-
-			std::cout 
-				<<  m_data[phi_bin][psi_bin][a] << " "
-				<< n << " " << p.res(n).amino().abbr()
-				<< Printf(" %.1f", phi)
-				<< Printf(" %.1f", psi)
-				<< "\n";
-			*/
-
-			if (verbose)
-			{
-				std::cout
-					<< m_data[phi_bin][psi_bin][a]
-					<< " tor ("
-					<< n << ") "
-					<< p.res(n).amino().abbr()
-					<< ' '
-					<< Printf("%6.1f", range_m180_180(rad2deg(p.conf().phi(n))))
-					<< ' '
-					<< Printf("%6.1f", range_m180_180(rad2deg(p.conf().psi(n))))
-					<< " [" << phi_bin << ' ' << psi_bin << "]\n";
-			}
+			s = residue_score(p, n, verbose);
 		}
+
+		total += s;
 	}
 
 #ifndef RAW_SCORE
@@ -172,3 +180,57 @@ double Torsion_impl::score(const Peptide& p, bool verbose)
 	return total;
 }
 
+double Torsion_impl::residue_score(const Peptide &p, int n,
+	bool verbose) const
+{
+	if (p.res(n).amino().is_glycine())
+	{
+		// glycine torsion propensities cannot be calculated reliably,
+		// since it occupies regions of the Ramachandran plot that
+		// no other amino acid does
+		return 0.0;
+	}
+
+	int phi_bin, psi_bin;
+
+	if (!Torsion::get_phi_psi_bin(p, n, &phi_bin, &psi_bin))
+	{
+		return 0.0;
+	}
+
+	int a = p.res(n).amino().num();
+
+	/*
+	double phi = rad2deg(p.conf().phi(n));
+	double psi = rad2deg(p.conf().psi(n));
+
+	std::cout 
+		<<  m_data[phi_bin][psi_bin][a] << " "
+		<< n << " " << p.res(n).amino().abbr()
+		<< Printf(" %.1f", phi)
+		<< Printf(" %.1f", psi)
+		<< "\n";
+	*/
+
+	if (verbose)
+	{
+		std::cout
+			<< m_data[phi_bin][psi_bin][a]
+			<< " tor ("
+			<< n << ") "
+			<< p.res(n).amino().abbr()
+			<< ' '
+			<< Printf("%6.1f", range_m180_180(rad2deg(p.conf().phi(n))))
+			<< ' '
+			<< Printf("%6.1f", range_m180_180(rad2deg(p.conf().psi(n))))
+			<< " [" << phi_bin << ' ' << psi_bin << "]\n";
+	}
+
+	return m_data[phi_bin][psi_bin][a];
+}
+
+void Torsion_impl::accept()
+{
+	m_res_score.accept();
+}
+
@@ -5,8 +5,11 @@
 #include <iostream>
 #include "torsion.h"
 #include "amino.h"
+#include "potential_file.h"
+#include "score_cache.h"
 
 class Peptide;
+struct Move_Range;
 
 class Torsion_impl
 {
@@ -18,17 +21,33 @@ public:
 	void set_data_file(const std::string &filename);
 
 	// score a peptide (low scores are better)
-	double score(const Peptide& peptide, bool verbose = false);
+	// (see Torsion::score())
+	double score(const Peptide& peptide, bool verbose = false,
+		const Move_Range *range = NULL);
+
+	// the peptide last scored is now the current conformation
+	void accept();
+
+	// read a torsion data file (exits with an error message if it is not
+	// valid). The table has dimensions
+	// [TORSION_BINS][TORSION_BINS][Amino::Num].
+	static void read_text(const std::string &filename, Potential_Table *table);
 
 private:
 	void load_data();
 
+	// the value for residue n (0 for glycine, or if its angles are unknown)
+	double residue_score(const Peptide &p, int n, bool verbose) const;
+
 private:
 	std::string m_filename;
 	bool m_data_loaded;
 
 	// (first two dimensions are phi and psi / TORSION_SIZE)
 	double m_data[TORSION_BINS][TORSION_BINS][Amino::Num];
+
+	// value for each residue
+	Score_Cache<double> m_res_score;
 };
 
 #endif	// TORSION_IMPL_H_INCLUDED
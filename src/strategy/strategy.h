@@ -11,6 +11,7 @@
 // In addition to the virtual functions in the base class, the new
 // class should contain static functions type() and print_template()
 
+#include <cmath>
 #include "common.h"
 #include "param_list.h"
 
@@ -46,6 +47,12 @@ public:
 	// a set of candidates to choose from)
 	virtual int num_candidates() = 0;
 
+	// called before the runs start, with prefilter true if the Runner
+	// ranks the candidates by a coarse score and only scores some of
+	// them in full (see Runner::choose_candidates())
+	virtual void set_prefilter(bool prefilter)
+	{ }
+
 	// returns the index of the candidate to select
 	// or -1 to select none of them
 	virtual int select(
@@ -55,6 +62,21 @@ public:
 									//      is num_candidates())
 	) = 0;
 
+	// Returns a score t such that a (single) candidate whose score is more
+	// than t will be rejected by the next call to select(), given that its
+	// score is known to be at least min_score. This lets the candidate be
+	// rejected before it has been completely scored (see Score_Limit in
+	// scorer.h). The default never rejects early.
+	virtual double reject_threshold(double old_score, double min_score)
+	{ return HUGE_VAL; }
+
+	// Sets *t to the value reject_threshold() would return, if that is
+	// known without changing the state of the strategy (eg. by drawing a
+	// random number); otherwise returns false.
+	virtual bool known_reject_threshold(double old_score, double min_score,
+		double *t)
+	{ *t = HUGE_VAL; return true; }
+
 	// called when a new run is about to start (before the first move)
 	virtual void start_run(Runner *runner) = 0;
 
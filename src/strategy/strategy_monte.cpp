@@ -1,5 +1,6 @@
 
 #include <cmath>
+#include <iostream>
 #include "config.h"
 #include "strategy_monte.h"
 #include "random.h"
@@ -13,7 +14,8 @@ const double Strategy_Monte::c_default_temp = 1.0;
 const int Strategy_Monte::c_default_candidates = 1;
 
 Strategy_Monte::Strategy_Monte()
-	: m_temp(c_default_temp), m_candidates(c_default_candidates)
+	: m_temp(c_default_temp), m_candidates(c_default_candidates),
+	  m_prefilter(false), m_rnd_drawn(false), m_rnd(0.0)
 {
 }
 
@@ -57,6 +59,21 @@ void Strategy_Monte::set_num_candidates(int num)
 	m_candidates = num;
 }
 
+void Strategy_Monte::set_prefilter(bool prefilter)
+{
+	// Monte Carlo used to ignore "number", so several candidates are only
+	// tried when they are prefiltered (otherwise the runs would be slower
+	// and could not stop scoring a candidate early)
+	if (!prefilter && m_candidates > 1 && !m_prefilter)
+	{
+		std::cerr << "Warning: ignoring " << Strategy::config_section()
+			<< " " << c_type << " " << c_param_candidates << " = "
+			<< m_candidates << " (only used with prefilter)\n";
+	}
+
+	m_prefilter = prefilter;
+}
+
 int Strategy_Monte::select(double old_score, const Double_Vec &new_score)
 {
 	double best_score = 0.0;
@@ -71,7 +88,7 @@ int Strategy_Monte::select(double old_score, const Double_Vec &new_score)
 
 		double change = new_score[n] - old_score;
 
-		if (change <= 0.0 || Random::rnd(1.0) < exp(-change / m_temp))
+		if (change <= 0.0 || next_rnd() < exp(-change / m_temp))
 		{
 			/*if (change > 0.0)
 				std::cout << "Accepted unfavourable change!\n" << "Change: " << change << "\nExponential: " << exp(-change / m_temp) << "\n";
@@ -85,9 +102,67 @@ int Strategy_Monte::select(double old_score, const Double_Vec &new_score)
 		}
 	}
 
+	m_rnd_drawn = false;
 	return best;
 }
 
+double Strategy_Monte::next_rnd()
+{
+	if (m_rnd_drawn)
+	{
+		m_rnd_drawn = false;
+		return m_rnd;
+	}
+
+	return Random::rnd(1.0);
+}
+
+double Strategy_Monte::reject_threshold(double old_score, double min_score)
+{
+	// the candidate can't be rejected unless the score gets worse
+	if (min_score <= old_score)
+	{
+		return old_score;
+	}
+
+	// Draw the random number that select() would use, so the candidate
+	// is rejected if
+	//
+	//	rnd >= exp(-change / temperature)
+	//
+	// ie. if change >= -temperature * log(rnd). The number is only drawn
+	// when select() is certain to need it, so the random number sequence
+	// is the same as when scoring is never stopped early.
+
+	if (!m_rnd_drawn)
+	{
+		m_rnd = Random::rnd(1.0);
+		m_rnd_drawn = true;
+	}
+
+	double t;
+	known_reject_threshold(old_score, min_score, &t);
+	return t;
+}
+
+bool Strategy_Monte::known_reject_threshold(double old_score,
+	double min_score, double *t)
+{
+	if (min_score <= old_score)
+	{
+		*t = old_score;
+		return true;
+	}
+
+	if (!m_rnd_drawn)
+	{
+		return false;
+	}
+
+	*t = (m_rnd <= 0.0 ? HUGE_VAL : old_score - m_temp * log(m_rnd));
+	return true;
+}
+
 void Strategy_Monte::start_run(Runner *runner)
 {
 }
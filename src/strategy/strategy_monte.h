@@ -36,17 +36,28 @@ public:
     // (otherwise exits with an error message)
     virtual void verify_parameters();
 
-	// get the number of candidate peptides required
+	// get the number of candidate peptides required (only one unless
+	// the candidates are prefiltered)
 	virtual int num_candidates()
-	{ return 1; }
+	{ return (m_prefilter ? m_candidates : 1); }
+
+	// (see Strategy::set_prefilter())
+	virtual void set_prefilter(bool prefilter);
 
 	// returns 0 to accept the peptide or -1 to reject it
 	virtual int select(
         double old_score,            // in - previous peptide's score
         const Double_Vec &new_score   // in - new peptide score
-                                    //      (vector is always length 1)
+                                    //      (vector is length num_candidates())
     );
 
+	// (see Strategy::reject_threshold())
+	virtual double reject_threshold(double old_score, double min_score);
+
+	// (see Strategy::known_reject_threshold())
+	virtual bool known_reject_threshold(double old_score, double min_score,
+		double *t);
+
 	// called when a new run is about to start (before the first move)
 	virtual void start_run(Runner *runner);
 
@@ -66,6 +77,11 @@ public:
 	static const char *type()
 	{ return c_type; }
 
+private:
+	// the random number for the Monte Carlo criterion (the one drawn by
+	// reject_threshold(), if any)
+	double next_rnd();
+
 private:
 	// config file parameters
     static const char *c_type;
@@ -76,6 +92,11 @@ private:
 
 	double m_temp;				// temperature
 	int m_candidates;			// number of candidate structures to try at once
+	bool m_prefilter;			// whether m_candidates is used
+
+	// random number drawn by reject_threshold() for the next select()
+	bool m_rnd_drawn;
+	double m_rnd;
 };
 
 #endif // STRATEGY_MONTE_H_INCLUDED